@@ -116,8 +116,8 @@ struct Matrix4x4 {
                 -elements[0][0] * elements[1][1] * elements[2][3] -
                 elements[0][1] * elements[1][3] * elements[2][0] -
                 elements[0][3] * elements[1][0] * elements[2][1] +
-                elements[0][3] * elements[1][1] * elements[1][0] +
-                elements[0][1] * elements[2][0] * elements[2][3] +
+                elements[0][3] * elements[1][1] * elements[2][0] +
+                elements[0][1] * elements[1][0] * elements[2][3] +
                 elements[0][0] * elements[1][3] * elements[2][1];
         inverse.elements[3][3] = elements[0][0] * elements[1][1] * elements[2][2] +
                                  elements[0][1] * elements[1][2] * elements[2][0] +
@@ -11,6 +11,10 @@
  * Default implementation of a hit shader. Shades light based on the Phong shading model. Considers textures.
  */
 class BasicHitShader : public HitShader {
+private:
+    // number of rays computed together by shadeBatch
+    static const uint64_t BATCH_SIZE = 64;
+
 public:
     BasicHitShader() {
 
@@ -130,6 +134,119 @@ public:
 
         return shaderOutput;
     }
+
+    void shadeBatch(uint64_t count, const uint64_t *ids, PipelineInfo *pipelineInfo, HitShaderInput *shaderInputs,
+                    std::vector<ShaderResource *> *shaderResource, RayResource **rayResources,
+                    RayGeneratorOutput *newRays, ShaderOutput *shaderOutputs) override {
+        double_t diffuse = 1, specular = 0.5, ambient = 0.1;
+
+        // the light is the same for every ray of the batch
+        Vector3D l = {-0.707107, 0.707107, 0};
+        double_t lightLength = sqrt(l.x * l.x + l.y * l.y + l.z * l.z);
+        l.x /= lightLength;
+        l.y /= lightLength;
+        l.z /= lightLength;
+
+        // per ray inputs of a block, gathered from the materials first, so that the lighting runs on plain arrays
+        double nx[BATCH_SIZE], ny[BATCH_SIZE], nz[BATCH_SIZE];
+        double vx[BATCH_SIZE], vy[BATCH_SIZE], vz[BATCH_SIZE];
+        double nl[BATCH_SIZE], dot[BATCH_SIZE];
+        double exponent[BATCH_SIZE];
+        Vector3D Ka[BATCH_SIZE], Kd[BATCH_SIZE], Ks[BATCH_SIZE];
+        uint8_t pix[BATCH_SIZE][3];
+
+        for (uint64_t first = 0; first < count; first += BATCH_SIZE) {
+            uint64_t size = count - first < BATCH_SIZE ? count - first : BATCH_SIZE;
+
+            for (uint64_t i = 0; i < size; i++) {
+                auto shaderInputInfo = shaderInputs[first + i].intersectionInfo;
+                unsigned char *image = shaderInputInfo->material->map_Kd.image;
+
+                Ka[i] = {1, 1, 1};
+                Kd[i] = {1, 1, 1};
+                Ks[i] = {1, 1, 1};
+                exponent[i] = 8;
+
+                if (image == nullptr) {
+                    if (shaderInputInfo->material->illum == 2) {
+                        exponent[i] = shaderInputInfo->material->Ns;
+                        Ka[i] = shaderInputInfo->material->Ka;
+                        Kd[i] = shaderInputInfo->material->Kd;
+                        Ks[i] = shaderInputInfo->material->Ks;
+                    }
+                    pix[i][0] = 255;
+                    pix[i][1] = 255;
+                    pix[i][2] = 255;
+                } else {
+                    int w = shaderInputInfo->material->map_Kd.w;
+                    int h = shaderInputInfo->material->map_Kd.h;
+                    double x = fmod(shaderInputInfo->texture.x, 1.0);
+                    double y = -fmod(shaderInputInfo->texture.y, 1.0);
+                    if (x < 0) x = 1 + x;
+                    if (y < 0) y = 1 + y;
+
+                    uint64_t pixelCoordinate = ((uint64_t) ((w - 1) * x)) + w * ((uint64_t) ((h - 1) * y));
+
+                    pix[i][0] = image[pixelCoordinate * 3];
+                    pix[i][1] = image[pixelCoordinate * 3 + 1];
+                    pix[i][2] = image[pixelCoordinate * 3 + 2];
+
+                    Ka[i] = shaderInputInfo->material->Ka;
+                    Kd[i] = shaderInputInfo->material->Kd;
+                    Ks[i] = shaderInputInfo->material->Ks;
+                }
+
+                nx[i] = shaderInputInfo->normal.x;
+                ny[i] = shaderInputInfo->normal.y;
+                nz[i] = shaderInputInfo->normal.z;
+                vx[i] = -1.0 * (shaderInputInfo->rayOrigin.x - pipelineInfo->cameraPosition.x);
+                vy[i] = -1.0 * (shaderInputInfo->rayOrigin.y - pipelineInfo->cameraPosition.y);
+                vz[i] = -1.0 * (shaderInputInfo->rayOrigin.z - pipelineInfo->cameraPosition.z);
+            }
+
+            // straight line arithmetic over the block, without branches on the materials, so that it can be vectorized
+            for (uint64_t i = 0; i < size; i++) {
+                double_t length = sqrt(nx[i] * nx[i] + ny[i] * ny[i] + nz[i] * nz[i]);
+                double_t x = nx[i] / length;
+                double_t y = ny[i] / length;
+                double_t z = nz[i] / length;
+
+                length = sqrt(vx[i] * vx[i] + vy[i] * vy[i] + vz[i] * vz[i]);
+                double_t viewX = vx[i] / length;
+                double_t viewY = vy[i] / length;
+                double_t viewZ = vz[i] / length;
+
+                nl[i] = fmax(x * l.x + y * l.y + z * l.z, 0);
+
+                double_t rx = (2 * nl[i] * x) - l.x;
+                double_t ry = (2 * nl[i] * y) - l.y;
+                double_t rz = (2 * nl[i] * z) - l.z;
+
+                length = sqrt(rx * rx + ry * ry + rz * rz);
+                rx /= length;
+                ry /= length;
+                rz /= length;
+
+                dot[i] = fmax(viewX * rx + viewY * ry + viewZ * rz, 0);
+            }
+
+            for (uint64_t i = 0; i < size; i++) {
+                ShaderOutput &shaderOutput = shaderOutputs[first + i];
+                if (shaderInputs[first + i].intersectionInfo->distance == std::numeric_limits<double_t>::max()) {
+                    shaderOutput = ShaderOutput{};
+                    continue;
+                }
+
+                double_t shine = specular * powf(dot[i], exponent[i]);
+                shaderOutput.color[0] = (uint8_t) fmin(
+                        (ambient * Ka[i].x + diffuse * nl[i] * Kd[i].x + shine * Ks[i].x) * pix[i][0], 255);
+                shaderOutput.color[1] = (uint8_t) fmin(
+                        (ambient * Ka[i].y + diffuse * nl[i] * Kd[i].y + shine * Ks[i].y) * pix[i][1], 255);
+                shaderOutput.color[2] = (uint8_t) fmin(
+                        (ambient * Ka[i].z + diffuse * nl[i] * Kd[i].z + shine * Ks[i].z) * pix[i][2], 255);
+            }
+        }
+    }
 };
 
 #endif //RAYTRACECORE_HITSHADER_H
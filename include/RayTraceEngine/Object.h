@@ -7,6 +7,7 @@
 
 #include <vector>
 #include <cstdint>
+#include <limits>
 #include "BasicStructures.h"
 
 struct ObjectId {
@@ -50,7 +51,7 @@ struct std::hash<InstanceId> {
 /**
  * Container outputted by the ray tracing engine.
  * hit:             Whether the ray intersected geometry.
- * distance:        Distance to the intersected geometry.
+ * distance:        Distance to the intersected geometry, in multiples of the ray direction.
  * rayOrigin:       Origin of the ray.
  * rayDirection:    Direction of the ray.
  * normal:          (Interpolated) normal vector of the intersected geometry.
@@ -122,6 +123,58 @@ public:
      */
     virtual bool intersectAll(std::vector<IntersectionInfo *> *intersectionInfo, Ray *ray) = 0;
 
+    /**
+     * Computes the first intersections of a packet of coherent rays with this object. Objects with an acceleration
+     * structure trace the whole packet at once, by default every ray is intersected on its own.
+     * @param intersectionInfo  One information container per ray, only overwritten if an intersection closer than its
+     *                          distance is found.
+     * @param rays              The rays of the packet, at most 64.
+     * @param rayMask           Mask of the rays that are intersected, bit i stands for rays[i].
+     * @return                  Mask of the rays for which a closer intersection was found.
+     */
+    virtual uint64_t intersectFirstPacket(IntersectionInfo *intersectionInfo, Ray *rays, uint64_t rayMask) {
+        uint64_t hit = 0;
+        for (uint64_t i = 0; i < 64; i++) {
+            if ((rayMask & (1ull << i)) == 0) continue;
+            IntersectionInfo intersectionInformationBuffer{};
+            intersectionInformationBuffer.hit = false;
+            intersectionInformationBuffer.distance = std::numeric_limits<double>::max();
+            intersectionInformationBuffer.position = {0, 0, 0};
+            intersectFirst(&intersectionInformationBuffer, &rays[i]);
+            if (intersectionInformationBuffer.hit &&
+                intersectionInformationBuffer.distance < intersectionInfo[i].distance) {
+                intersectionInfo[i] = intersectionInformationBuffer;
+                hit |= 1ull << i;
+            }
+        }
+        return hit;
+    }
+
+    /**
+     * Computes any intersection of a packet of coherent rays with this object. Objects with an acceleration structure
+     * trace the whole packet at once, by default every ray is intersected on its own.
+     * @param intersectionInfo  One information container per ray, filled with the found intersection.
+     * @param rays              The rays of the packet, at most 64.
+     * @param rayMask           Mask of the rays that are intersected, bit i stands for rays[i].
+     * @return                  Mask of the rays that intersect this object.
+     */
+    virtual uint64_t intersectAnyPacket(IntersectionInfo *intersectionInfo, Ray *rays, uint64_t rayMask) {
+        uint64_t hit = 0;
+        for (uint64_t i = 0; i < 64; i++) {
+            if ((rayMask & (1ull << i)) == 0) continue;
+            IntersectionInfo intersectionInformationBuffer{};
+            intersectionInformationBuffer.hit = false;
+            intersectionInformationBuffer.distance = std::numeric_limits<double>::max();
+            intersectionInformationBuffer.position = {0, 0, 0};
+            intersectAny(&intersectionInformationBuffer, &rays[i]);
+            if (intersectionInformationBuffer.hit) {
+                intersectionInfo[i] = intersectionInformationBuffer;
+                hit |= 1ull << i;
+            }
+        }
+        return hit;
+    }
+
     /**
      * Computes the effective surface area of this object.
      * @return The surface area of this object.
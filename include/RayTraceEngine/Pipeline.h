@@ -28,6 +28,28 @@ struct std::hash<PipelineId> {
     }
 };
 
+/**
+ * Handle of an asynchronous pipeline execution. A handle stays valid until the next execution of the same pipeline is
+ * started.
+ * pipelineId:  Id of the executed pipeline.
+ * execution:   Number of the execution among all executions of the pipeline.
+ */
+struct PipelineExecutionHandle {
+    PipelineId pipelineId;
+    uint64_t execution;
+};
+
+/**
+ * Order in which a pipeline traces and shades its rays.
+ * DEPTH_FIRST:     The primary rays of a tile are traced and shaded in batches, then every pixel is traced to
+ *                  completion, including all of its secondary rays, before the next pixel is started.
+ * WAVEFRONT:       The primary rays of many pixels are traced in bulk, then shaded in batches per shader, then the next
+ *                  generation of secondary rays is traced. Pays off for pipelines with multiple bounces.
+ */
+enum class PipelineMode {
+    DEPTH_FIRST, WAVEFRONT
+};
+
 /**
  * Description of a pipeline for initialization.
  * resolutionX:             Horizontal resolution.
@@ -44,6 +66,20 @@ struct std::hash<PipelineId> {
  * pierceShaderIDs:         Ids of the pierce shaders used in this pipeline.
  * missShaderIDs:           Ids of the miss shaders used in this pipeline.
  * objectInstanceIDs:       Will be filled with the ids of the resulting object instances.
+ * mode:                    Order in which the pipeline traces its rays.
+ * samplesPerRun:           Number of samples rendered for every pixel on each execution of the pipeline.
+ * accumulate:              Whether the samples of consecutive executions are averaged into the result, instead of
+ *                          starting over on every execution.
+ * priority:                When all pipelines are executed together, the tiles of pipelines with a higher priority are
+ *                          rendered first, those of pipelines with the same priority in turns.
+ * targetFrameTime:         If positive, the time in milliseconds an execution of the pipeline should take. The pipeline
+ *                          then renders at a lower resolution whenever it takes longer and upscales it to the requested
+ *                          one, zero always renders at the requested resolution.
+ * rayPayloadSize:          Size in bytes of a payload stored inline with every ray, zero for none. Shaders access it
+ *                          through the rayPayload field of their input and may change it, child rays start with a copy
+ *                          of the payload of their parent after all shaders of the parent ran. Unlike RayResource the
+ *                          payload is copied bytewise, so it has to be trivially copyable.
+ * rayPayloadAlignment:     Alignment of the payload in bytes, a power of two of at most 64.
  */
 struct PipelineDescription {
     int resolutionX;
@@ -61,6 +97,14 @@ struct PipelineDescription {
     std::vector<MissShaderResourcePackage> missShaders;
 
     std::vector<InstanceId> *objectInstanceIDs;
+
+    PipelineMode mode = PipelineMode::DEPTH_FIRST;
+    int samplesPerRun = 1;
+    bool accumulate = false;
+    int priority = 0;
+    double targetFrameTime = 0;
+    uint64_t rayPayloadSize = 0;
+    uint64_t rayPayloadAlignment = 8;
 };
 
 #endif //RAYTRACECORE_PIPELINE_H
@@ -56,6 +56,51 @@ public:
     updatePipelineCamera(PipelineId id, int resolutionX, int resolutionY, Vector3D cameraPosition, Vector3D cameraDirection,
                          Vector3D cameraUp);
 
+    /**
+     * Changes the order in which a pipeline traces its rays, takes effect on the next execution.
+     * @param id    The id of the pipeline to be updated.
+     * @param mode  New mode of the pipeline.
+     */
+    void updatePipelineMode(PipelineId id, PipelineMode mode);
+
+    /**
+     * Changes how many samples a pipeline renders per pixel and whether they are accumulated over consecutive
+     * executions. The result is the average of all samples accumulated so far. Changing the camera, the geometry or the
+     * shaders of the pipeline starts the accumulation over.
+     * @param id            The id of the pipeline to be updated.
+     * @param samplesPerRun Number of samples rendered for every pixel on each execution, at least one.
+     * @param accumulate    Whether the samples of consecutive executions are averaged into the result.
+     */
+    void updatePipelineSampling(PipelineId id, int samplesPerRun, bool accumulate);
+
+    /**
+     * Changes the priority of a pipeline when all pipelines are executed together with runAll.
+     * @param id        The id of the pipeline to be updated.
+     * @param priority  New priority of the pipeline, see PipelineDescription.
+     */
+    void updatePipelinePriority(PipelineId id, int priority);
+
+    /**
+     * Lets a pipeline adapt the resolution it renders at to meet a target frame time. After every execution the
+     * duration is measured and the resolution of the next one lowered or raised accordingly, down to a quarter of the
+     * requested resolution along each axis. The result is always upscaled to the requested resolution.
+     * @param id                The id of the pipeline to be updated.
+     * @param targetFrameTime   Time in milliseconds an execution should take, zero disables the adaption.
+     */
+    void updatePipelineFrameTime(PipelineId id, double targetFrameTime);
+
+    /**
+     * Discards the samples a pipeline accumulated so far, the next execution starts with an empty image.
+     * @param id    The id of the pipeline.
+     */
+    void resetPipelineAccumulation(PipelineId id);
+
+    /**
+     * @param id    The id of the pipeline.
+     * @return      Returns the number of samples per pixel that make up the pipelines current result.
+     */
+    uint64_t getPipelineSampleCount(PipelineId id);
+
     /**
      * Waits on pipeline execution to finish, then returns with the result.
      * @param id    Id of the pipeline.
@@ -78,11 +123,63 @@ public:
     int runPipeline(PipelineId id);
 
     /**
-     * Executes all pipelines in the pool.
+     * Executes a pipeline progressively. Samples are rendered until the time budget is used up or the target sample
+     * count is reached, the result then holds the average of all samples so far. The next call continues the
+     * refinement, until the camera, the geometry or the shaders of the pipeline change. The budget is checked after
+     * every few tiles, at least one batch of tiles is rendered per call.
+     * @param id                    Id of the pipeline to be executed.
+     * @param timeBudget            Time in milliseconds after which the execution returns.
+     * @param targetSampleCount     Number of samples per pixel after which the refinement stops, 0 for no limit.
+     * @return                      Returns 1 once the target sample count is reached, 0 while the result is still
+     *                              being refined.
+     */
+    int runPipeline(PipelineId id, double timeBudget, uint64_t targetSampleCount);
+
+    /**
+     * Starts the execution of a pipeline and returns without waiting for it. Executions of different pipelines overlap,
+     * a pipeline that is still executing finishes its previous execution first. Any other call that accesses the
+     * pipeline waits for the execution to finish.
+     * @param id    Id of the pipeline to be executed.
+     * @return      Returns a handle to wait on, poll or cancel the execution.
+     */
+    PipelineExecutionHandle runPipelineAsync(PipelineId id);
+
+    /**
+     * Waits until an asynchronous execution is finished.
+     * @param handle    Handle of the execution.
+     * @return          Status identifier of the execution, -1 if it was cancelled.
+     */
+    int waitPipelineExecution(PipelineExecutionHandle handle);
+
+    /**
+     * Checks whether an asynchronous execution is finished, without waiting for it.
+     * @param handle    Handle of the execution.
+     * @return          True if the execution is finished.
+     */
+    bool isPipelineExecutionFinished(PipelineExecutionHandle handle);
+
+    /**
+     * Requests an asynchronous execution to stop. The execution stops after the tiles that are currently being rendered,
+     * or after the current wave in wavefront mode. The result of the pipeline then keeps its previous image and
+     * accumulated samples are discarded.
+     * @param handle    Handle of the execution.
+     */
+    void cancelPipelineExecution(PipelineExecutionHandle handle);
+
+    /**
+     * Executes all pipelines in the pool. The tiles of all pipelines are rendered at the same time, tiles of pipelines
+     * with a higher priority first and tiles of pipelines with the same priority in turns.
      * @return      Status identifier including error codes.
      */
     int runAll();
 
+    /**
+     * Sets the number of threads used to execute pipelines. Pipelines are rendered in tiles that are distributed over
+     * these threads, so shaders may be called concurrently.
+     * @param threadCount   Number of threads including the calling thread, 0 uses all available hardware threads.
+     */
+    void setThreadCount(unsigned int threadCount);
+
     /**
      * Binds a list of objects by id to a pipeline by id. These object will be instanced and used as geometry in the ray
      * trace stage of the pipeline on execution.
@@ -142,6 +239,25 @@ public:
      */
     bool removePipelineObject(PipelineId pipelineId, InstanceId objectInstanceId);
 
+    /**
+     * Opens a transaction on a pipeline to gather the instance changes of a frame. Until the transaction is committed,
+     * bindGeometryToPipeline, updatePipelineObjects and removePipelineObject only record their changes, instance ids
+     * are still handed out right away. Executing the pipeline in the meantime renders the scene as it was before the
+     * transaction.
+     * @param pipelineId    Id of the pipeline.
+     * @return              True if the transaction could be opened, false if the pipeline does not exist or already
+     *                      has an open transaction.
+     */
+    bool beginPipelineTransaction(PipelineId pipelineId);
+
+    /**
+     * Applies all changes gathered by the open transaction of a pipeline at once. Small changes are inserted and refit
+     * incrementally, once a large share of the instances changed the acceleration structure is rebuilt in parallel.
+     * @param pipelineId    Id of the pipeline.
+     * @return              True if the transaction could be committed, false if the pipeline has no open transaction.
+     */
+    bool commitPipelineTransaction(PipelineId pipelineId);
+
     /**
      * Removes a shader from a pipeline.
      * @param pipelineId        Id of the pipeline.
@@ -12,6 +12,28 @@
  * Default implementation of a ray generator shader. It generates a view frustum given a camera position and resolution.
  */
 class BasicRayGeneratorShader : public RayGeneratorShader {
+private:
+    // number of rays computed together by shadeBatch
+    static const uint64_t BATCH_SIZE = 64;
+
+    static Vector3D getCameraRight(PipelineInfo *pipelineInfo) {
+        Vector3D camRight = {pipelineInfo->cameraUp.y * pipelineInfo->cameraDirection.z -
+                             pipelineInfo->cameraUp.z * pipelineInfo->cameraDirection.y,
+                             pipelineInfo->cameraUp.z * pipelineInfo->cameraDirection.x -
+                             pipelineInfo->cameraUp.x * pipelineInfo->cameraDirection.z,
+                             pipelineInfo->cameraUp.x * pipelineInfo->cameraDirection.y -
+                             pipelineInfo->cameraUp.y * pipelineInfo->cameraDirection.x};
+
+        double camRightLength = std::sqrt(
+                camRight.x * camRight.x + camRight.y * camRight.y + camRight.z * camRight.z);
+
+        camRight.x /= camRightLength;
+        camRight.y /= camRightLength;
+        camRight.z /= camRightLength;
+
+        return camRight;
+    }
+
 public:
     BasicRayGeneratorShader() {
 
@@ -33,21 +55,7 @@ public:
         Vector3D rayOrigin{};
         Vector3D rayDirection{};
 
-        Vector3D camRight{};
-
-        camRight = {pipelineInfo->cameraUp.y * pipelineInfo->cameraDirection.z -
-                    pipelineInfo->cameraUp.z * pipelineInfo->cameraDirection.y,
-                    pipelineInfo->cameraUp.z * pipelineInfo->cameraDirection.x -
-                    pipelineInfo->cameraUp.x * pipelineInfo->cameraDirection.z,
-                    pipelineInfo->cameraUp.x * pipelineInfo->cameraDirection.y -
-                    pipelineInfo->cameraUp.y * pipelineInfo->cameraDirection.x};
-
-        double camRightLength = std::sqrt(
-                camRight.x * camRight.x + camRight.y * camRight.y + camRight.z * camRight.z);
-
-        camRight.x /= camRightLength;
-        camRight.y /= camRightLength;
-        camRight.z /= camRightLength;
+        Vector3D camRight = getCameraRight(pipelineInfo);
 
         rayOrigin = pipelineInfo->cameraPosition;
         rayDirection.x =
@@ -76,6 +84,47 @@ public:
         rayGeneratorOutput->rays.push_back(generatorRay);
     }
 
+    void
+    shadeBatch(uint64_t count, const uint64_t *ids, PipelineInfo *pipelineInfo,
+               std::vector<ShaderResource *> *shaderResource, RayGeneratorOutput *rayGeneratorOutputs) override {
+        // the camera is the same for every ray of the batch
+        Vector3D camRight = getCameraRight(pipelineInfo);
+        Vector3D camDirection = pipelineInfo->cameraDirection;
+        Vector3D camUp = pipelineInfo->cameraUp;
+        double width = pipelineInfo->width + 0.0;
+        double height = pipelineInfo->height + 0.0;
+
+        double u[BATCH_SIZE], v[BATCH_SIZE];
+        double directionX[BATCH_SIZE], directionY[BATCH_SIZE], directionZ[BATCH_SIZE];
+
+        for (uint64_t first = 0; first < count; first += BATCH_SIZE) {
+            uint64_t size = count - first < BATCH_SIZE ? count - first : BATCH_SIZE;
+
+            for (uint64_t i = 0; i < size; i++) {
+                int64_t x = (((int64_t) ids[first + i]) % pipelineInfo->width) - (pipelineInfo->width) / 2;
+                int64_t y = -(((int64_t) ids[first + i]) / pipelineInfo->height) + (pipelineInfo->height) / 2;
+                u[i] = x / width;
+                v[i] = y / height;
+            }
+
+            // straight line arithmetic over the block, without branches or calls, so that it can be vectorized
+            for (uint64_t i = 0; i < size; i++) {
+                double x = camDirection.x + (camRight.x * u[i] + (camUp.x * v[i]));
+                double y = camDirection.y + (camRight.y * u[i] + (camUp.y * v[i]));
+                double z = camDirection.z + (camRight.z * u[i] + (camUp.z * v[i]));
+                double length = std::sqrt(x * x + y * y + z * z);
+                directionX[i] = x / length;
+                directionY[i] = y / length;
+                directionZ[i] = z / length;
+            }
+
+            for (uint64_t i = 0; i < size; i++) {
+                GeneratorRay generatorRay = {pipelineInfo->cameraPosition, {directionX[i], directionY[i], directionZ[i]}};
+                rayGeneratorOutputs[first + i].rays.push_back(generatorRay);
+            }
+        }
+    }
+
     void *getAssociatedData() {
         return nullptr;
     }
@@ -153,9 +153,31 @@ public:
     virtual ShaderResource *clone() = 0;
 };
 
+/**
+ * Data attached to a ray by the shaders and passed on to its child rays. The pipeline owns the resource of every ray,
+ * once the ray is shaded its last child ray takes the resource over and all other child rays receive copies of it. The
+ * resource of a ray without children is released. A shader that replaces the resource of a ray takes over the
+ * ownership of the replaced one.
+ */
 class RayResource {
 public:
     virtual RayResource *clone() = 0;
+
+    /**
+     * Copies the state of another resource into this one, lets the pipeline reuse released resources instead of
+     * cloning new ones. It is only called with resources of the same type. The default implementation does not support
+     * reuse, released resources are deleted then.
+     * @param other     The resource to be copied.
+     * @return          True if the state was copied, false if the resource cannot be reused.
+     */
+    virtual bool copyFrom(RayResource * /*other*/) {
+        return false;
+    }
+
+    /**
+     * Destructor.
+     */
+    virtual ~RayResource() = default;
 };
 
 /**
@@ -165,12 +187,15 @@ public:
  * cameraPosition:  Position of the virtual camera.
  * cameraDirection: Direction of the virtual camera facing forwards.
  * cameraUp:        Direction of the virtual camera facing upwards.
+ * sampleIndex:     Index of the sample that is currently rendered, counted since the pipelines accumulated image was
+ *                  last reset. Ray generator shaders can use it to place the rays of every sample differently.
  */
 struct PipelineInfo {
     int width{}, height{};
     Vector3D cameraPosition{};
     Vector3D cameraDirection{};
     Vector3D cameraUp{};
+    uint64_t sampleIndex{};
 };
 
 /**
@@ -178,45 +203,56 @@ struct PipelineInfo {
  * id:              Original id of the ray, this will be passed to potential child rays. This is equivalent to the pixel id.
  * rayOrigin:       Vector of origins of rays.
  * rayDirection:    Vector of directions of rays.
+ * rayPayload:      Initial payload of the generated rays, filled with zeros before the ray generator shader is called.
+ *                  Only set for ray generator shaders of pipelines that declare a payload, nullptr otherwise.
  */
 struct RayGeneratorOutput {
     std::vector<GeneratorRay> rays;
+    void *rayPayload{};
 };
 
 /**
  * Container used as input by the occlusion shader.
  * rayOrigin:       The origin of the ray.
  * rayDirection:    The direction of the ray.
+ * rayPayload:      Payload of the ray, see PipelineDescription, nullptr if the pipeline declares none.
  */
 struct OcclusionShaderInput {
     Vector3D rayOrigin;
     Vector3D rayDirection;
+    void *rayPayload{};
 };
 
 /**
  * Container used as input by the hit shader.
  * intersectionInfo:    Contains details about the intersection.
+ * rayPayload:          Payload of the ray, see PipelineDescription, nullptr if the pipeline declares none.
  */
 struct HitShaderInput {
     IntersectionInfo *intersectionInfo;
+    void *rayPayload{};
 };
 
 /**
  * Container used as input by the miss shader.
  * rayOrigin:       The origin of the ray.
  * rayDirection:    The direction of the ray.
+ * rayPayload:      Payload of the ray, see PipelineDescription, nullptr if the pipeline declares none.
  */
 struct MissShaderInput {
     Vector3D rayOrigin;
     Vector3D rayDirection;
+    void *rayPayload{};
 };
 
 /**
  * Container used as input by the pierce shader.
  * intersectionInfo:    Vector of intersection information containers, one for each intersection.
+ * rayPayload:          Payload of the ray, see PipelineDescription, nullptr if the pipeline declares none.
  */
 struct PierceShaderInput {
     std::vector<IntersectionInfo *> intersectionInfo;
+    void *rayPayload{};
 };
 
 /**
@@ -255,6 +291,24 @@ public:
     shade(uint64_t id, PipelineInfo *pipelineInfo, std::vector<ShaderResource *> *shaderResource,
           RayGeneratorOutput *rayGeneratorOutput) = 0;
 
+    /**
+     * Batched shading method, generates the rays of several ray families in a single call. The pipeline prefers it over
+     * shade, the default implementation falls back to calling shade for every id. Override it to share work between the
+     * ray families of a batch.
+     * @param count                 Number of ray families in the batch.
+     * @param ids                   Ids of the ray families, count entries.
+     * @param pipelineInfo          Contains details about the pipeline this shader is executed in.
+     * @param shaderResource        Resources bound to the shader.
+     * @param rayGeneratorOutputs   Receives the rays of every ray family, count entries.
+     */
+    virtual void
+    shadeBatch(uint64_t count, const uint64_t *ids, PipelineInfo *pipelineInfo,
+               std::vector<ShaderResource *> *shaderResource, RayGeneratorOutput *rayGeneratorOutputs) {
+        for (uint64_t i = 0; i < count; i++) {
+            shade(ids[i], pipelineInfo, shaderResource, &rayGeneratorOutputs[i]);
+        }
+    }
+
     /**
      * Destructor.
      */
@@ -281,6 +335,29 @@ public:
           std::vector<ShaderResource *> *shaderResource,
           RayResource **rayResource, RayGeneratorOutput *newRays) = 0;
 
+    /**
+     * Batched shading method, shades several rays in a single call. Wavefront mode shades every generation of rays
+     * through it, depth first mode the rays generated for every tile. Secondary rays of depth first mode are passed to
+     * shade one by one. The default implementation falls back to calling shade for every ray.
+     * @param count           Number of rays in the batch.
+     * @param ids             Ids of the rays, count entries.
+     * @param pipelineInfo    Contains details about the pipeline this shader is executed in.
+     * @param shaderInputs    Input of every ray, count entries.
+     * @param shaderResource  Resources bound to the shader.
+     * @param rayResources    Data attached to every ray, count entries.
+     * @param newRays         Optional child rays of every ray, count entries.
+     * @param shaderOutputs   Receives the colour of every ray, count entries.
+     */
+    virtual void
+    shadeBatch(uint64_t count, const uint64_t *ids, PipelineInfo *pipelineInfo, OcclusionShaderInput *shaderInputs,
+               std::vector<ShaderResource *> *shaderResource, RayResource **rayResources,
+               RayGeneratorOutput *newRays, ShaderOutput *shaderOutputs) {
+        for (uint64_t i = 0; i < count; i++) {
+            shaderOutputs[i] = shade(ids[i], pipelineInfo, &shaderInputs[i], shaderResource, &rayResources[i],
+                                     &newRays[i]);
+        }
+    }
+
     /**
      * Destructor.
      */
@@ -307,6 +384,29 @@ public:
           std::vector<ShaderResource *> *shaderResource,
           RayResource **rayResource, RayGeneratorOutput *newRays) = 0;
 
+    /**
+     * Batched shading method, shades several rays in a single call. Wavefront mode shades every generation of rays
+     * through it, depth first mode the rays generated for every tile. Secondary rays of depth first mode are passed to
+     * shade one by one. The default implementation falls back to calling shade for every ray.
+     * @param count           Number of rays in the batch.
+     * @param ids             Ids of the rays, count entries.
+     * @param pipelineInfo    Contains details about the pipeline this shader is executed in.
+     * @param shaderInputs    Input of every ray, count entries.
+     * @param shaderResource  Resources bound to the shader.
+     * @param rayResources    Data attached to every ray, count entries.
+     * @param newRays         Optional child rays of every ray, count entries.
+     * @param shaderOutputs   Receives the colour of every ray, count entries.
+     */
+    virtual void
+    shadeBatch(uint64_t count, const uint64_t *ids, PipelineInfo *pipelineInfo, PierceShaderInput *shaderInputs,
+               std::vector<ShaderResource *> *shaderResource, RayResource **rayResources,
+               RayGeneratorOutput *newRays, ShaderOutput *shaderOutputs) {
+        for (uint64_t i = 0; i < count; i++) {
+            shaderOutputs[i] = shade(ids[i], pipelineInfo, &shaderInputs[i], shaderResource, &rayResources[i],
+                                     &newRays[i]);
+        }
+    }
+
     /**
      * Destructor.
      */
@@ -333,6 +433,29 @@ public:
           std::vector<ShaderResource *> *shaderResource,
           RayResource **rayResource, RayGeneratorOutput *newRays) = 0;
 
+    /**
+     * Batched shading method, shades several rays in a single call. Wavefront mode shades every generation of rays
+     * through it, depth first mode the rays generated for every tile. Secondary rays of depth first mode are passed to
+     * shade one by one. The default implementation falls back to calling shade for every ray.
+     * @param count           Number of rays in the batch.
+     * @param ids             Ids of the rays, count entries.
+     * @param pipelineInfo    Contains details about the pipeline this shader is executed in.
+     * @param shaderInputs    Input of every ray, count entries.
+     * @param shaderResource  Resources bound to the shader.
+     * @param rayResources    Data attached to every ray, count entries.
+     * @param newRays         Optional child rays of every ray, count entries.
+     * @param shaderOutputs   Receives the colour of every ray, count entries.
+     */
+    virtual void
+    shadeBatch(uint64_t count, const uint64_t *ids, PipelineInfo *pipelineInfo, HitShaderInput *shaderInputs,
+               std::vector<ShaderResource *> *shaderResource, RayResource **rayResources,
+               RayGeneratorOutput *newRays, ShaderOutput *shaderOutputs) {
+        for (uint64_t i = 0; i < count; i++) {
+            shaderOutputs[i] = shade(ids[i], pipelineInfo, &shaderInputs[i], shaderResource, &rayResources[i],
+                                     &newRays[i]);
+        }
+    }
+
     /**
      * Destructor.
      */
@@ -359,6 +482,29 @@ public:
           std::vector<ShaderResource *> *shaderResource,
           RayResource **rayResource, RayGeneratorOutput *newRays) = 0;
 
+    /**
+     * Batched shading method, shades several rays in a single call. Wavefront mode shades every generation of rays
+     * through it, depth first mode the rays generated for every tile. Secondary rays of depth first mode are passed to
+     * shade one by one. The default implementation falls back to calling shade for every ray.
+     * @param count           Number of rays in the batch.
+     * @param ids             Ids of the rays, count entries.
+     * @param pipelineInfo    Contains details about the pipeline this shader is executed in.
+     * @param shaderInputs    Input of every ray, count entries.
+     * @param shaderResource  Resources bound to the shader.
+     * @param rayResources    Data attached to every ray, count entries.
+     * @param newRays         Optional child rays of every ray, count entries.
+     * @param shaderOutputs   Receives the colour of every ray, count entries.
+     */
+    virtual void
+    shadeBatch(uint64_t count, const uint64_t *ids, PipelineInfo *pipelineInfo, MissShaderInput *shaderInputs,
+               std::vector<ShaderResource *> *shaderResource, RayResource **rayResources,
+               RayGeneratorOutput *newRays, ShaderOutput *shaderOutputs) {
+        for (uint64_t i = 0; i < count; i++) {
+            shaderOutputs[i] = shade(ids[i], pipelineInfo, &shaderInputs[i], shaderResource, &rayResources[i],
+                                     &newRays[i]);
+        }
+    }
+
     /**
      * Destructor.
      */
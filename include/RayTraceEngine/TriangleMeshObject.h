@@ -7,7 +7,9 @@
 
 #include "Object.h"
 
-struct DBVHNode;
+class MeshBVH;
+
+struct TriangleHit;
 
 /**
  * Contains all the information required to construct a 3d model based on a 3d triangle mesh.
@@ -15,8 +17,7 @@ struct DBVHNode;
  * vertices:        a list of coordinates for position, normal and texture data
  * indices:         a list of indices for the vertices where every 3 define one triangle
  * material:        contains information about an objects surface properties, like texture, reflectiveness, etc.
- * triangles:       object form of every triangle defined by vertices and indices
- * structure:       an intersection acceleration data structure
+ * structure:       an intersection acceleration data structure holding packed copies of the triangles
  */
 class TriangleMeshObject : public Object {
 public:
@@ -27,14 +28,16 @@ public:
     };
 
 private:
-    friend class Triangle;
-
     std::vector<Vertex> vertices;
     std::vector<uint64_t> indices;
     Material material;
 
-    std::vector<Object *> triangles;
-    DBVHNode *structure;
+    MeshBVH *structure;
+
+    /**
+     * Resolves position, distance, normal, texture coordinates and material of a triangle hit.
+     */
+    void fillIntersectionInfo(IntersectionInfo *intersectionInfo, const TriangleHit *hit, Ray *ray);
 
 public:
     /**
@@ -82,6 +85,25 @@ public:
      */
     bool intersectAll(std::vector<IntersectionInfo *> *intersectionInfo, Ray *ray) override;
 
+    /**
+     * Computes the first intersections of a packet of coherent rays with this object, the rays share one traversal.
+     * @param intersectionInfo  One information container per ray, only overwritten if an intersection closer than its
+     *                          distance is found.
+     * @param rays              The rays of the packet, at most 64.
+     * @param rayMask           Mask of the rays that are intersected, bit i stands for rays[i].
+     * @return                  Mask of the rays for which a closer intersection was found.
+     */
+    uint64_t intersectFirstPacket(IntersectionInfo *intersectionInfo, Ray *rays, uint64_t rayMask) override;
+
+    /**
+     * Computes any intersection of a packet of coherent rays with this object, the rays share one traversal.
+     * @param intersectionInfo  One information container per ray, filled with the found intersection.
+     * @param rays              The rays of the packet, at most 64.
+     * @param rayMask           Mask of the rays that are intersected, bit i stands for rays[i].
+     * @return                  Mask of the rays that intersect this object.
+     */
+    uint64_t intersectAnyPacket(IntersectionInfo *intersectionInfo, Ray *rays, uint64_t rayMask) override;
+
     /**
      * Makes a perfect clone of this object.
      * @return  Pointer to the new clone.
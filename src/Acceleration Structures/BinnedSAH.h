@@ -0,0 +1,117 @@
+//
+// Created by Sebastian on 18.10.2026.
+//
+
+#ifndef RAYTRACEENGINE_BINNEDSAH_H
+#define RAYTRACEENGINE_BINNEDSAH_H
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <vector>
+#include "RayTraceEngine/BasicStructures.h"
+
+// number of candidate split planes per axis is one less than this
+static const int SAH_BIN_COUNT = 16;
+
+static inline BoundingBox emptyBoundingBox() {
+    return {std::numeric_limits<double>::max(), std::numeric_limits<double>::max(),
+            std::numeric_limits<double>::max(), -std::numeric_limits<double>::max(),
+            -std::numeric_limits<double>::max(), -std::numeric_limits<double>::max()};
+}
+
+static inline void expandBoundingBox(BoundingBox &box, const Vector3D &point) {
+    box.minCorner.x = std::min(box.minCorner.x, point.x);
+    box.minCorner.y = std::min(box.minCorner.y, point.y);
+    box.minCorner.z = std::min(box.minCorner.z, point.z);
+    box.maxCorner.x = std::max(box.maxCorner.x, point.x);
+    box.maxCorner.y = std::max(box.maxCorner.y, point.y);
+    box.maxCorner.z = std::max(box.maxCorner.z, point.z);
+}
+
+static inline void expandBoundingBox(BoundingBox &box, const BoundingBox &other) {
+    expandBoundingBox(box, other.minCorner);
+    expandBoundingBox(box, other.maxCorner);
+}
+
+static inline double getAxis(const Vector3D &vector, int axis) {
+    return axis == 0 ? vector.x : axis == 1 ? vector.y : vector.z;
+}
+
+static inline int getBin(const Vector3D &centroid, int axis, double minimum, double scale) {
+    return std::min(SAH_BIN_COUNT - 1, (int) ((getAxis(centroid, axis) - minimum) * scale));
+}
+
+/**
+ * Splits a range of primitives in two using the surface area heuristic, evaluated on SAH_BIN_COUNT equally sized bins
+ * of the centroid bounds per axis. Falls back to a median split if all centroids fall into the same bin.
+ * @tparam Primitive    Type providing the members boundingBox and centroid.
+ * @param primitives    The primitives, the range is reordered so that the left side comes first.
+ * @param begin         First primitive of the range.
+ * @param end           One past the last primitive of the range, the range has to hold at least 2 primitives.
+ * @return              Index of the first primitive of the right side, always within (begin, end).
+ */
+template<class Primitive>
+static uint64_t partitionBinnedSAH(std::vector<Primitive> &primitives, uint64_t begin, uint64_t end) {
+    BoundingBox centroidBox = emptyBoundingBox();
+    for (uint64_t i = begin; i < end; i++) {
+        expandBoundingBox(centroidBox, primitives[i].centroid);
+    }
+
+    int bestAxis = -1;
+    int bestBin = 0;
+    double bestCost = std::numeric_limits<double>::max();
+
+    for (int axis = 0; axis < 3; axis++) {
+        double minimum = getAxis(centroidBox.minCorner, axis);
+        double extent = getAxis(centroidBox.maxCorner, axis) - minimum;
+        if (!(extent > 0)) continue;
+        double scale = SAH_BIN_COUNT / extent;
+
+        BoundingBox binBoxes[SAH_BIN_COUNT];
+        uint64_t binCounts[SAH_BIN_COUNT] = {};
+        for (auto &binBox: binBoxes) binBox = emptyBoundingBox();
+
+        for (uint64_t i = begin; i < end; i++) {
+            int bin = getBin(primitives[i].centroid, axis, minimum, scale);
+            binCounts[bin]++;
+            expandBoundingBox(binBoxes[bin], primitives[i].boundingBox);
+        }
+
+        // sweep from the right to get the cost of every right side, then from the left to combine both sides
+        double rightCosts[SAH_BIN_COUNT];
+        BoundingBox rightBox = emptyBoundingBox();
+        uint64_t rightCount = 0;
+        for (int bin = SAH_BIN_COUNT - 1; bin > 0; bin--) {
+            expandBoundingBox(rightBox, binBoxes[bin]);
+            rightCount += binCounts[bin];
+            rightCosts[bin] = rightCount == 0 ? 0 : rightBox.getSA() * (double) rightCount;
+        }
+
+        BoundingBox leftBox = emptyBoundingBox();
+        uint64_t leftCount = 0;
+        for (int bin = 1; bin < SAH_BIN_COUNT; bin++) {
+            expandBoundingBox(leftBox, binBoxes[bin - 1]);
+            leftCount += binCounts[bin - 1];
+            if (leftCount == 0 || leftCount == end - begin) continue;
+            double cost = leftBox.getSA() * (double) leftCount + rightCosts[bin];
+            if (cost < bestCost) {
+                bestCost = cost;
+                bestAxis = axis;
+                bestBin = bin;
+            }
+        }
+    }
+
+    if (bestAxis == -1) return begin + (end - begin) / 2;
+
+    double minimum = getAxis(centroidBox.minCorner, bestAxis);
+    double scale = SAH_BIN_COUNT / (getAxis(centroidBox.maxCorner, bestAxis) - minimum);
+    auto middle = std::partition(primitives.begin() + (int64_t) begin, primitives.begin() + (int64_t) end,
+                                 [bestAxis, bestBin, minimum, scale](const Primitive &primitive) {
+                                     return getBin(primitive.centroid, bestAxis, minimum, scale) < bestBin;
+                                 });
+    return (uint64_t) (middle - primitives.begin());
+}
+
+#endif //RAYTRACEENGINE_BINNEDSAH_H
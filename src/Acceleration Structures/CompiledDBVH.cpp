@@ -0,0 +1,302 @@
+//
+// Created by Sebastian on 18.10.2026.
+//
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include "CompiledDBVH.h"
+#include "DBVHv2.h"
+
+/**
+ * Child of a node during the collapse of the binary tree.
+ */
+struct CollapseEntry {
+    BoundingBox boundingBox;
+    DBVHNode *node;
+    Object *leaf;
+};
+
+static bool intersectLeafFirst(Object *leaf, IntersectionInfo *intersectionInfo, Ray *ray) {
+    IntersectionInfo intersectionInformationBuffer{};
+    intersectionInformationBuffer.hit = false;
+    intersectionInformationBuffer.distance = std::numeric_limits<double>::max();
+    intersectionInformationBuffer.position = {0, 0, 0};
+    leaf->intersectFirst(&intersectionInformationBuffer, ray);
+    if (intersectionInformationBuffer.hit && intersectionInformationBuffer.distance < intersectionInfo->distance) {
+        *intersectionInfo = intersectionInformationBuffer;
+        return true;
+    }
+    return false;
+}
+
+static bool intersectLeafAny(Object *leaf, IntersectionInfo *intersectionInfo, Ray *ray) {
+    IntersectionInfo intersectionInformationBuffer{};
+    intersectionInformationBuffer.hit = false;
+    intersectionInformationBuffer.distance = std::numeric_limits<double>::max();
+    intersectionInformationBuffer.position = {0, 0, 0};
+    leaf->intersectAny(&intersectionInformationBuffer, ray);
+    if (intersectionInformationBuffer.hit) {
+        *intersectionInfo = intersectionInformationBuffer;
+        return true;
+    }
+    return false;
+}
+
+static bool intersectLeafAll(Object *leaf, std::vector<IntersectionInfo *> *intersectionInfo,
+                             BlockArena<IntersectionInfo> *arena, Ray *ray) {
+    IntersectionInfo intersectionInformationBuffer{};
+    intersectionInformationBuffer.hit = false;
+    intersectionInformationBuffer.distance = std::numeric_limits<double>::max();
+    intersectionInformationBuffer.position = {0, 0, 0};
+    leaf->intersectFirst(&intersectionInformationBuffer, ray);
+    if (intersectionInformationBuffer.hit) {
+        auto *entry = arena->allocate();
+        *entry = intersectionInformationBuffer;
+        intersectionInfo->push_back(entry);
+        return true;
+    }
+    return false;
+}
+
+/**
+ * Intersects the objects referenced by the leaves of the compiled tree.
+ */
+class ObjectLeafIntersector {
+private:
+    Object *const *leaves;
+    IntersectionInfo *intersectionInfo;
+    std::vector<IntersectionInfo *> *intersectionInfos;
+    BlockArena<IntersectionInfo> *arena;
+    Ray *ray;
+
+public:
+    ObjectLeafIntersector(Object *const *leaves, IntersectionInfo *intersectionInfo,
+                          std::vector<IntersectionInfo *> *intersectionInfos, BlockArena<IntersectionInfo> *arena,
+                          Ray *ray)
+            : leaves(leaves), intersectionInfo(intersectionInfo), intersectionInfos(intersectionInfos), arena(arena),
+              ray(ray) {}
+
+    [[nodiscard]] double getClosest() const {
+        return intersectionInfo->distance;
+    }
+
+    bool intersectFirst(uint32_t leaf, float distance) {
+        return intersectLeafFirst(leaves[leaf], intersectionInfo, ray);
+    }
+
+    bool intersectAny(uint32_t leaf) {
+        return intersectLeafAny(leaves[leaf], intersectionInfo, ray);
+    }
+
+    bool intersectAll(uint32_t leaf) {
+        return intersectLeafAll(leaves[leaf], intersectionInfos, arena, ray);
+    }
+};
+
+/**
+ * Intersects the objects referenced by the leaves of the compiled tree with the rays of a packet.
+ */
+class ObjectPacketLeafIntersector {
+private:
+    Object *const *leaves;
+    IntersectionInfo *intersectionInfo;
+    Ray *rays;
+
+public:
+    ObjectPacketLeafIntersector(Object *const *leaves, IntersectionInfo *intersectionInfo, Ray *rays)
+            : leaves(leaves), intersectionInfo(intersectionInfo), rays(rays) {}
+
+    [[nodiscard]] double getClosest(uint32_t ray) const {
+        return intersectionInfo[ray].distance;
+    }
+
+    uint64_t intersectFirst(uint32_t leaf, uint64_t rayMask) {
+        return leaves[leaf]->intersectFirstPacket(intersectionInfo, rays, rayMask);
+    }
+
+    uint64_t intersectAny(uint32_t leaf, uint64_t rayMask) {
+        return leaves[leaf]->intersectAnyPacket(intersectionInfo, rays, rayMask);
+    }
+};
+
+static void addCollapseEntries(std::vector<CollapseEntry> &entries, DBVHNode *node) {
+    if (node->maxDepthLeft > 1) {
+        entries.push_back({node->leftChild->boundingBox, node->leftChild, nullptr});
+    } else if (node->maxDepthLeft == 1) {
+        entries.push_back({node->leftLeaf->object->getBoundaries(), nullptr, node->leftLeaf->object});
+    }
+    if (node->maxDepthRight > 1) {
+        entries.push_back({node->rightChild->boundingBox, node->rightChild, nullptr});
+    } else if (node->maxDepthRight == 1) {
+        entries.push_back({node->rightLeaf->object->getBoundaries(), nullptr, node->rightLeaf->object});
+    }
+}
+
+CompiledDBVH::CompiledDBVH(DBVHNode *root) {
+    width = supportsAVX2() ? 8 : 4;
+    rootLeaf = nullptr;
+    maxDepth = 0;
+
+    if (root == nullptr || root->maxDepthLeft == 0) return;
+
+    if (root->maxDepthLeft == 1 && root->maxDepthRight == 0) {
+        // a root holding a single object has no inner node
+        rootLeaf = root->leftLeaf->object;
+    } else if (width == 8) {
+        collapse<8>(root, 1, nodes8);
+    } else {
+        collapse<4>(root, 1, nodes4);
+    }
+}
+
+template<int Width, class NodeVector>
+uint32_t CompiledDBVH::collapse(DBVHNode *node, uint32_t depth, NodeVector &nodes) {
+    maxDepth = std::max(maxDepth, depth);
+
+    // open the inner child with the largest surface area until the node is full
+    std::vector<CollapseEntry> entries;
+    addCollapseEntries(entries, node);
+    while (entries.size() < Width) {
+        int largest = -1;
+        double largestArea = -1;
+        for (int i = 0; i < (int) entries.size(); i++) {
+            if (entries[i].node != nullptr && entries[i].boundingBox.getSA() > largestArea) {
+                largestArea = entries[i].boundingBox.getSA();
+                largest = i;
+            }
+        }
+        if (largest == -1) break;
+
+        DBVHNode *opened = entries[largest].node;
+        entries.erase(entries.begin() + largest);
+        addCollapseEntries(entries, opened);
+    }
+
+    auto index = (uint32_t) nodes.size();
+    nodes.emplace_back();
+
+    clearNode<Width>(&nodes[index]);
+
+    for (int i = 0; i < (int) entries.size(); i++) {
+        setChildBox<Width>(&nodes[index], i, entries[i].boundingBox);
+
+        if (entries[i].node == nullptr) {
+            nodes[index].children[i] = WIDE_BVH_LEAF_FLAG | (uint32_t) leaves.size();
+            leaves.push_back(entries[i].leaf);
+        } else {
+            // the node vector may grow during the recursion, so the child is written by index afterwards
+            uint32_t child = collapse<Width>(entries[i].node, depth + 1, nodes);
+            nodes[index].children[i] = child;
+        }
+    }
+
+    return index;
+}
+
+int CompiledDBVH::getWidth() const {
+    return width;
+}
+
+bool CompiledDBVH::intersectFirst(IntersectionInfo *intersectionInfo, Ray *ray) const {
+    if (rootLeaf != nullptr) return rootLeaf->intersectFirst(intersectionInfo, ray);
+    if (maxDepth == 0) return false;
+
+    uint32_t stackSize = (width - 1) * maxDepth + 1;
+    WideTraversalContainer localStack[WIDE_BVH_STACK_SIZE];
+    auto *stack = stackSize <= WIDE_BVH_STACK_SIZE ? localStack : new WideTraversalContainer[stackSize];
+
+    ObjectLeafIntersector leafIntersector(leaves.data(), intersectionInfo, nullptr, nullptr, ray);
+    bool hit = width == 8 ? traverseFirst<8>(nodes8.data(), stack, ray, leafIntersector)
+                          : traverseFirst<4>(nodes4.data(), stack, ray, leafIntersector);
+
+    if (stack != localStack) delete[] stack;
+    return hit;
+}
+
+bool CompiledDBVH::intersectAny(IntersectionInfo *intersectionInfo, Ray *ray) const {
+    if (rootLeaf != nullptr) return rootLeaf->intersectAny(intersectionInfo, ray);
+    if (maxDepth == 0) return false;
+
+    uint32_t stackSize = (width - 1) * maxDepth + 1;
+    uint32_t localStack[WIDE_BVH_STACK_SIZE];
+    auto *stack = stackSize <= WIDE_BVH_STACK_SIZE ? localStack : new uint32_t[stackSize];
+
+    ObjectLeafIntersector leafIntersector(leaves.data(), intersectionInfo, nullptr, nullptr, ray);
+    bool hit = width == 8 ? traverseAny<8>(nodes8.data(), stack, ray, leafIntersector)
+                          : traverseAny<4>(nodes4.data(), stack, ray, leafIntersector);
+
+    if (stack != localStack) delete[] stack;
+    return hit;
+}
+
+bool CompiledDBVH::intersectAll(std::vector<IntersectionInfo *> *intersectionInfo, BlockArena<IntersectionInfo> *arena,
+                                Ray *ray) const {
+    if (rootLeaf != nullptr) {
+        // objects allocate the entries of all their intersections themselves, they are moved into the arena so that the
+        // caller owns every entry the same way
+        uint64_t first = intersectionInfo->size();
+        bool hit = rootLeaf->intersectAll(intersectionInfo, ray);
+        for (uint64_t i = first; i < intersectionInfo->size(); i++) {
+            auto *entry = arena->allocate();
+            *entry = *(*intersectionInfo)[i];
+            delete (*intersectionInfo)[i];
+            (*intersectionInfo)[i] = entry;
+        }
+        return hit;
+    }
+    if (maxDepth == 0) return false;
+
+    uint32_t stackSize = (width - 1) * maxDepth + 1;
+    uint32_t localStack[WIDE_BVH_STACK_SIZE];
+    auto *stack = stackSize <= WIDE_BVH_STACK_SIZE ? localStack : new uint32_t[stackSize];
+
+    ObjectLeafIntersector leafIntersector(leaves.data(), nullptr, intersectionInfo, arena, ray);
+    bool hit = width == 8 ? traverseAll<8>(nodes8.data(), stack, ray, leafIntersector)
+                          : traverseAll<4>(nodes4.data(), stack, ray, leafIntersector);
+
+    if (stack != localStack) delete[] stack;
+    return hit;
+}
+
+uint64_t CompiledDBVH::intersectFirstPacket(IntersectionInfo *intersectionInfo, Ray *rays, uint64_t rayMask) const {
+    if (rootLeaf != nullptr) return rootLeaf->intersectFirstPacket(intersectionInfo, rays, rayMask);
+    if (maxDepth == 0) return 0;
+
+    uint32_t stackSize = (width - 1) * maxDepth + 1;
+    WidePacketContainer localStack[WIDE_BVH_STACK_SIZE];
+    auto *stack = stackSize <= WIDE_BVH_STACK_SIZE ? localStack : new WidePacketContainer[stackSize];
+
+    FloatPacket packet;
+    ObjectPacketLeafIntersector leafIntersector(leaves.data(), intersectionInfo, rays);
+    uint64_t hit = tracePackets(rays, rayMask, &packet, [&](const FloatPacket *rayPacket, uint64_t packetMask) {
+        return width == 8 ? traversePacketFirst<8>(nodes8.data(), stack, rayPacket, packetMask, leafIntersector)
+                          : traversePacketFirst<4>(nodes4.data(), stack, rayPacket, packetMask, leafIntersector);
+    }, [&](uint32_t ray) {
+        return intersectFirst(&intersectionInfo[ray], &rays[ray]);
+    });
+
+    if (stack != localStack) delete[] stack;
+    return hit;
+}
+
+uint64_t CompiledDBVH::intersectAnyPacket(IntersectionInfo *intersectionInfo, Ray *rays, uint64_t rayMask) const {
+    if (rootLeaf != nullptr) return rootLeaf->intersectAnyPacket(intersectionInfo, rays, rayMask);
+    if (maxDepth == 0) return 0;
+
+    uint32_t stackSize = (width - 1) * maxDepth + 1;
+    WidePacketContainer localStack[WIDE_BVH_STACK_SIZE];
+    auto *stack = stackSize <= WIDE_BVH_STACK_SIZE ? localStack : new WidePacketContainer[stackSize];
+
+    FloatPacket packet;
+    ObjectPacketLeafIntersector leafIntersector(leaves.data(), intersectionInfo, rays);
+    uint64_t hit = tracePackets(rays, rayMask, &packet, [&](const FloatPacket *rayPacket, uint64_t packetMask) {
+        return width == 8 ? traversePacketAny<8>(nodes8.data(), stack, rayPacket, packetMask, leafIntersector)
+                          : traversePacketAny<4>(nodes4.data(), stack, rayPacket, packetMask, leafIntersector);
+    }, [&](uint32_t ray) {
+        return intersectAny(&intersectionInfo[ray], &rays[ray]);
+    });
+
+    if (stack != localStack) delete[] stack;
+    return hit;
+}
@@ -0,0 +1,96 @@
+//
+// Created by Sebastian on 18.10.2026.
+//
+
+#ifndef RAYTRACEENGINE_COMPILEDDBVH_H
+#define RAYTRACEENGINE_COMPILEDDBVH_H
+
+#include <vector>
+#include "RayTraceEngine/Object.h"
+#include "Utils/Allocator/AlignedAllocator.h"
+#include "Utils/Allocator/BlockArena.h"
+#include "WideBVH.h"
+
+struct DBVHNode;
+
+/**
+ * Read only snapshot of a DBVHNode tree. The binary tree is collapsed into a 4 or 8 wide tree, depending on the widest
+ * SIMD instruction set supported by the CPU, and stored as one contiguous array in depth first order. The snapshot has
+ * to be recompiled whenever the dynamic tree changes.
+ * width:       Number of children per node, either 4 or 8.
+ * nodes4:      The compiled nodes if the width is 4, the root is at index 0.
+ * nodes8:      The compiled nodes if the width is 8, the root is at index 0.
+ * leaves:      The objects referenced by the leaf children.
+ * rootLeaf:    The only object of a tree without inner nodes.
+ * maxDepth:    Number of nodes on the longest path from the root to a leaf, used to size the traversal stack.
+ */
+class CompiledDBVH {
+private:
+    int width;
+    std::vector<WideBVHNode<4>, AlignedAllocator<WideBVHNode<4>, 64>> nodes4;
+    std::vector<WideBVHNode<8>, AlignedAllocator<WideBVHNode<8>, 64>> nodes8;
+    std::vector<Object *> leaves;
+    Object *rootLeaf;
+    uint32_t maxDepth;
+
+    template<int Width, class NodeVector>
+    uint32_t collapse(DBVHNode *node, uint32_t depth, NodeVector &nodes);
+
+public:
+    /**
+     * Compiles a dynamic tree.
+     * @param root  Root of the tree, the tree is not modified.
+     */
+    explicit CompiledDBVH(DBVHNode *root);
+
+    /**
+     * @return  Number of children per node, 8 if the CPU supports AVX2, 4 otherwise.
+     */
+    [[nodiscard]] int getWidth() const;
+
+    /**
+     * Finds the closest intersection of a ray with the objects of the tree.
+     * @param intersectionInfo  Filled with the closest intersection, its distance bounds the search.
+     * @param ray               The ray.
+     * @return                  True if an object was hit, false otherwise.
+     */
+    bool intersectFirst(IntersectionInfo *intersectionInfo, Ray *ray) const;
+
+    /**
+     * Finds any intersection of a ray with the objects of the tree.
+     * @param intersectionInfo  Filled with the found intersection.
+     * @param ray               The ray.
+     * @return                  True if an object was hit, false otherwise.
+     */
+    bool intersectAny(IntersectionInfo *intersectionInfo, Ray *ray) const;
+
+    /**
+     * Finds the intersections of a ray with every object of the tree.
+     * @param intersectionInfo  Receives one entry per object that was hit.
+     * @param arena             Storage of the entries, they stay valid until the arena is reset.
+     * @param ray               The ray.
+     * @return                  True if an object was hit, false otherwise.
+     */
+    bool intersectAll(std::vector<IntersectionInfo *> *intersectionInfo, BlockArena<IntersectionInfo> *arena,
+                      Ray *ray) const;
+
+    /**
+     * Finds the closest intersections of a packet of rays, coherent rays share one traversal.
+     * @param intersectionInfo  One entry per ray, filled with the closest intersection, its distance bounds the search.
+     * @param rays              The rays, at most WIDE_BVH_PACKET_SIZE.
+     * @param rayMask           Mask of the rays to intersect.
+     * @return                  Mask of the rays that hit an object.
+     */
+    uint64_t intersectFirstPacket(IntersectionInfo *intersectionInfo, Ray *rays, uint64_t rayMask) const;
+
+    /**
+     * Finds any intersection of every ray of a packet, coherent rays share one traversal.
+     * @param intersectionInfo  One entry per ray, filled with the found intersection.
+     * @param rays              The rays, at most WIDE_BVH_PACKET_SIZE.
+     * @param rayMask           Mask of the rays to intersect.
+     * @return                  Mask of the rays that hit an object.
+     */
+    uint64_t intersectAnyPacket(IntersectionInfo *intersectionInfo, Ray *rays, uint64_t rayMask) const;
+};
+
+#endif //RAYTRACEENGINE_COMPILEDDBVH_H
@@ -4,7 +4,30 @@
 
 #include <algorithm>
 #include <limits>
+#include <unordered_set>
 #include "DBVHv2.h"
+#include "BinnedSAH.h"
+#include "Utils/ThreadPool/TaskScheduler.h"
+
+// minimum number of objects below a node for its subtrees to be built as separate tasks
+static const uint64_t PARALLEL_BUILD_THRESHOLD = 1024;
+
+// number of objects whose boundaries are computed by one task of a bulk build
+static const uint64_t BULK_BUILD_CHUNK_SIZE = 256;
+
+/**
+ * Object during a bulk build, so that its virtual methods are called once instead of once per evaluated split.
+ * boundingBox: Boundaries of the object.
+ * centroid:    Center of the boundaries.
+ * surfaceArea: Surface area of the object.
+ * leaf:        Handle of the object.
+ */
+struct BuildObject {
+    BoundingBox boundingBox;
+    Vector3D centroid;
+    double surfaceArea;
+    DBVHLeaf *leaf;
+};
 
 static void refit(BoundingBox *target, BoundingBox resizeBy) {
     target->minCorner.x = std::min(target->minCorner.x, resizeBy.minCorner.x);
@@ -15,14 +38,14 @@ static void refit(BoundingBox *target, BoundingBox resizeBy) {
     target->maxCorner.z = std::max(target->maxCorner.z, resizeBy.maxCorner.z);
 }
 
-static void refit(BoundingBox &aabb, Object *object) {
-    refit(&aabb, object->getBoundaries());
+static void refit(BoundingBox &aabb, DBVHLeaf *leaf) {
+    refit(&aabb, leaf->object->getBoundaries());
 }
 
-static void refit(BoundingBox &aabb, std::vector<Object *> *objects, double looseness) {
+static void refit(BoundingBox &aabb, std::vector<DBVHLeaf *> *objects, double looseness) {
     // refit box to fit all objects
-    for (auto &object: *objects) {
-        refit(aabb, object);
+    for (auto &leaf: *objects) {
+        refit(aabb, leaf);
     }
 
     // increase box size by looseness factor
@@ -40,7 +63,7 @@ static void refit(BoundingBox &aabb, std::vector<Object *> *objects, double loos
 }
 
 static double evaluateBucket(BoundingBox *leftChildBox, BoundingBox *rightChildBox, double leftSAH, double rightSAH,
-                             std::vector<Object *> *objects, Vector3D splittingPlane, uint8_t *newParent) {
+                             std::vector<DBVHLeaf *> *objects, Vector3D splittingPlane, uint8_t *newParent) {
     // initialize both bucket boxes
     BoundingBox aabbLeft = {std::numeric_limits<double>::max(), std::numeric_limits<double>::max(),
                             std::numeric_limits<double>::max(), -std::numeric_limits<double>::max(),
@@ -56,35 +79,35 @@ static double evaluateBucket(BoundingBox *leftChildBox, BoundingBox *rightChildB
 
     // sort all objects into their bucket, then update the buckets bounding box
     if (splittingPlane.x != 0) {
-        for (auto &object: *objects) {
-            if ((object->getBoundaries().maxCorner.x + object->getBoundaries().minCorner.x) / 2 <
+        for (auto &leaf: *objects) {
+            if ((leaf->object->getBoundaries().maxCorner.x + leaf->object->getBoundaries().minCorner.x) / 2 <
                 splittingPlane.x) {
-                refit(aabbLeft, object);
+                refit(aabbLeft, leaf);
                 leftCount += 1;
             } else {
-                refit(aabbRight, object);
+                refit(aabbRight, leaf);
                 rightCount += 1;
             }
         }
     } else if (splittingPlane.y != 0) {
-        for (auto &object: *objects) {
-            if ((object->getBoundaries().maxCorner.y + object->getBoundaries().minCorner.y) / 2 <
+        for (auto &leaf: *objects) {
+            if ((leaf->object->getBoundaries().maxCorner.y + leaf->object->getBoundaries().minCorner.y) / 2 <
                 splittingPlane.y) {
-                refit(aabbLeft, object);
+                refit(aabbLeft, leaf);
                 leftCount += 1;
             } else {
-                refit(aabbRight, object);
+                refit(aabbRight, leaf);
                 rightCount += 1;
             }
         }
     } else {
-        for (auto &object: *objects) {
-            if ((object->getBoundaries().maxCorner.z + object->getBoundaries().minCorner.z) / 2 <
+        for (auto &leaf: *objects) {
+            if ((leaf->object->getBoundaries().maxCorner.z + leaf->object->getBoundaries().minCorner.z) / 2 <
                 splittingPlane.z) {
-                refit(aabbLeft, object);
+                refit(aabbLeft, leaf);
                 leftCount += 1;
             } else {
-                refit(aabbRight, object);
+                refit(aabbRight, leaf);
                 rightCount += 1;
             }
         }
@@ -151,47 +174,38 @@ static double evaluateBucket(BoundingBox *leftChildBox, BoundingBox *rightChildB
     }
 }
 
-static void split(std::vector<Object *> *leftChild, std::vector<Object *> *rightChild, std::vector<Object *> *objects,
+static void split(std::vector<DBVHLeaf *> *leftChild, std::vector<DBVHLeaf *> *rightChild, std::vector<DBVHLeaf *> *objects,
                   Vector3D splittingPlane) {
     if (splittingPlane.x != 0) {
-        for (auto &object: *objects) {
-            if ((object->getBoundaries().maxCorner.x + object->getBoundaries().minCorner.x) / 2 <
+        for (auto &leaf: *objects) {
+            if ((leaf->object->getBoundaries().maxCorner.x + leaf->object->getBoundaries().minCorner.x) / 2 <
                 splittingPlane.x) {
-                leftChild->push_back(object);
+                leftChild->push_back(leaf);
             } else {
-                rightChild->push_back(object);
+                rightChild->push_back(leaf);
             }
         }
     } else if (splittingPlane.y != 0) {
-        for (auto &object: *objects) {
-            if ((object->getBoundaries().maxCorner.y + object->getBoundaries().minCorner.y) / 2 <
+        for (auto &leaf: *objects) {
+            if ((leaf->object->getBoundaries().maxCorner.y + leaf->object->getBoundaries().minCorner.y) / 2 <
                 splittingPlane.y) {
-                leftChild->push_back(object);
+                leftChild->push_back(leaf);
             } else {
-                rightChild->push_back(object);
+                rightChild->push_back(leaf);
             }
         }
     } else {
-        for (auto &object: *objects) {
-            if ((object->getBoundaries().maxCorner.z + object->getBoundaries().minCorner.z) / 2 <
+        for (auto &leaf: *objects) {
+            if ((leaf->object->getBoundaries().maxCorner.z + leaf->object->getBoundaries().minCorner.z) / 2 <
                 splittingPlane.z) {
-                leftChild->push_back(object);
+                leftChild->push_back(leaf);
             } else {
-                rightChild->push_back(object);
+                rightChild->push_back(leaf);
             }
         }
     }
 }
 
-static bool contains(BoundingBox aabb1, BoundingBox aabb2) {
-    return aabb1.minCorner.x <= aabb2.minCorner.x &&
-           aabb1.maxCorner.x >= aabb2.maxCorner.x &&
-           aabb1.minCorner.y <= aabb2.minCorner.y &&
-           aabb1.maxCorner.y >= aabb2.maxCorner.y &&
-           aabb1.minCorner.z <= aabb2.minCorner.z &&
-           aabb1.maxCorner.z >= aabb2.maxCorner.z;
-}
-
 static bool rayBoxIntersection(Vector3D *min, Vector3D *max, Ray *ray, double *distance) {
     double t1 = (min->x - ray->origin.x) * ray->dirfrac.x;
     double t2 = (max->x - ray->origin.x) * ray->dirfrac.x;
@@ -218,20 +232,37 @@ static void refit(DBVHNode *node) {
         refit(&node->boundingBox, (node->rightChild)->boundingBox);
         node->surfaceArea = (node->rightChild)->surfaceArea;
     } else {
-        refit(&node->boundingBox, (node->rightLeaf)->getBoundaries());
-        node->surfaceArea = (node->rightLeaf)->getSurfaceArea();
+        refit(&node->boundingBox, (node->rightLeaf)->object->getBoundaries());
+        node->surfaceArea = (node->rightLeaf)->object->getSurfaceArea();
     }
     if (node->maxDepthLeft > 1) {
         refit(&node->boundingBox, (node->leftChild)->boundingBox);
         node->surfaceArea += (node->leftChild)->surfaceArea;
         node->surfaceArea += node->boundingBox.getSA();
     } else {
-        refit(&node->boundingBox, (node->leftLeaf)->getBoundaries());
-        node->surfaceArea += (node->leftLeaf)->getSurfaceArea();
+        refit(&node->boundingBox, (node->leftLeaf)->object->getBoundaries());
+        node->surfaceArea += (node->leftLeaf)->object->getSurfaceArea();
         node->surfaceArea += node->boundingBox.getSA();
     }
 }
 
+/**
+ * Points the parent links of the children and the handles of the leaves of a node back at the node. Needed whenever
+ * children or leaves were moved into the node.
+ */
+static void relink(DBVHNode *node) {
+    if (node->maxDepthLeft > 1) {
+        node->leftChild->parent = node;
+    } else if (node->maxDepthLeft == 1) {
+        node->leftLeaf->node = node;
+    }
+    if (node->maxDepthRight > 1) {
+        node->rightChild->parent = node;
+    } else if (node->maxDepthRight == 1) {
+        node->rightLeaf->node = node;
+    }
+}
+
 bool optimizeSAH(DBVHNode *node) {
     int bestSAH = 0;
     double SAHs[5];
@@ -251,15 +282,15 @@ bool optimizeSAH(DBVHNode *node) {
             leftLeftBox = (leftNode->leftChild)->boundingBox;
             leftLeftSA = (leftNode->leftChild)->surfaceArea;
         } else {
-            leftLeftBox = (leftNode->leftLeaf)->getBoundaries();
-            leftLeftSA = (leftNode->leftLeaf)->getSurfaceArea();
+            leftLeftBox = (leftNode->leftLeaf)->object->getBoundaries();
+            leftLeftSA = (leftNode->leftLeaf)->object->getSurfaceArea();
         }
         if (leftNode->maxDepthRight > 1) {
             leftRightBox = (leftNode->rightChild)->boundingBox;
             leftRightSA = (leftNode->rightChild)->surfaceArea;
         } else {
-            leftRightBox = (leftNode->rightLeaf)->getBoundaries();
-            leftRightSA = (leftNode->rightLeaf)->getSurfaceArea();
+            leftRightBox = (leftNode->rightLeaf)->object->getBoundaries();
+            leftRightSA = (leftNode->rightLeaf)->object->getSurfaceArea();
         }
 
         if (node->maxDepthRight > 1) {
@@ -270,15 +301,15 @@ bool optimizeSAH(DBVHNode *node) {
                 rightLeftBox = (rightNode->leftChild)->boundingBox;
                 rightLeftSA = (rightNode->leftChild)->surfaceArea;
             } else {
-                rightLeftBox = (rightNode->leftLeaf)->getBoundaries();
-                rightLeftSA = (rightNode->leftLeaf)->getSurfaceArea();
+                rightLeftBox = (rightNode->leftLeaf)->object->getBoundaries();
+                rightLeftSA = (rightNode->leftLeaf)->object->getSurfaceArea();
             }
             if (rightNode->maxDepthRight > 1) {
                 rightRightBox = (rightNode->rightChild)->boundingBox;
                 rightRightSA = (rightNode->rightChild)->surfaceArea;
             } else {
-                rightRightBox = (rightNode->rightLeaf)->getBoundaries();
-                rightRightSA = (rightNode->rightLeaf)->getSurfaceArea();
+                rightRightBox = (rightNode->rightLeaf)->object->getBoundaries();
+                rightRightSA = (rightNode->rightLeaf)->object->getSurfaceArea();
             }
 
             swapLeftLeftToRight = {std::min(rightBox.minCorner.x, leftRightBox.minCorner.x),
@@ -316,8 +347,8 @@ bool optimizeSAH(DBVHNode *node) {
                       swapRightRightToLeft.getSA();
         } else {
             auto *rightNode = node->rightLeaf;
-            rightBox = rightNode->getBoundaries();
-            rightSA = rightNode->getSurfaceArea();
+            rightBox = rightNode->object->getBoundaries();
+            rightSA = rightNode->object->getSurfaceArea();
 
             swapLeftLeftToRight = {std::min(rightBox.minCorner.x, leftRightBox.minCorner.x),
                                    std::min(rightBox.minCorner.y, leftRightBox.minCorner.y),
@@ -341,8 +372,8 @@ bool optimizeSAH(DBVHNode *node) {
         }
     } else {
         auto *leftNode = node->leftLeaf;
-        leftBox = leftNode->getBoundaries();
-        leftSA = leftNode->getSurfaceArea();
+        leftBox = leftNode->object->getBoundaries();
+        leftSA = leftNode->object->getSurfaceArea();
 
         if (node->maxDepthRight > 1) {
             auto *rightNode = node->rightChild;
@@ -352,15 +383,15 @@ bool optimizeSAH(DBVHNode *node) {
                 rightLeftBox = (rightNode->leftChild)->boundingBox;
                 rightLeftSA = (rightNode->leftChild)->surfaceArea;
             } else {
-                rightLeftBox = (rightNode->leftLeaf)->getBoundaries();
-                rightLeftSA = (rightNode->leftLeaf)->getSurfaceArea();
+                rightLeftBox = (rightNode->leftLeaf)->object->getBoundaries();
+                rightLeftSA = (rightNode->leftLeaf)->object->getSurfaceArea();
             }
             if (rightNode->maxDepthRight > 1) {
                 rightRightBox = (rightNode->rightChild)->boundingBox;
                 rightRightSA = (rightNode->rightChild)->surfaceArea;
             } else {
-                rightRightBox = (rightNode->rightLeaf)->getBoundaries();
-                rightRightSA = (rightNode->rightLeaf)->getSurfaceArea();
+                rightRightBox = (rightNode->rightLeaf)->object->getBoundaries();
+                rightRightSA = (rightNode->rightLeaf)->object->getSurfaceArea();
             }
 
             swapRightLeftToLeft = {std::min(leftBox.minCorner.x, rightRightBox.minCorner.x),
@@ -418,7 +449,8 @@ bool optimizeSAH(DBVHNode *node) {
 
                 node->surfaceArea = SAHs[1];
                 (node->leftChild)->surfaceArea = rightSA + leftRightSA + swapLeftLeftToRight.getSA();
-                return true;
+                node->maxDepthLeft = std::max(node->leftChild->maxDepthLeft, node->leftChild->maxDepthRight) + 1;
+                break;
             } else {
                 auto buffer = node->rightLeaf;
                 if (node->leftChild->maxDepthLeft > 1) {
@@ -434,7 +466,8 @@ bool optimizeSAH(DBVHNode *node) {
 
                 node->surfaceArea = SAHs[1];
                 (node->leftChild)->surfaceArea = rightSA + leftRightSA + swapLeftLeftToRight.getSA();
-                return true;
+                node->maxDepthLeft = std::max(node->leftChild->maxDepthLeft, node->leftChild->maxDepthRight) + 1;
+                break;
             }
         }
         case 2: {
@@ -453,7 +486,8 @@ bool optimizeSAH(DBVHNode *node) {
 
                 node->surfaceArea = SAHs[2];
                 (node->leftChild)->surfaceArea = rightSA + leftLeftSA + swapLeftRightToRight.getSA();
-                return true;
+                node->maxDepthLeft = std::max(node->leftChild->maxDepthLeft, node->leftChild->maxDepthRight) + 1;
+                break;
             } else {
                 auto buffer = node->rightLeaf;
                 if (node->leftChild->maxDepthRight > 1) {
@@ -469,7 +503,8 @@ bool optimizeSAH(DBVHNode *node) {
 
                 node->surfaceArea = SAHs[2];
                 (node->leftChild)->surfaceArea = rightSA + leftLeftSA + swapLeftRightToRight.getSA();
-                return true;
+                node->maxDepthLeft = std::max(node->leftChild->maxDepthLeft, node->leftChild->maxDepthRight) + 1;
+                break;
             }
         }
         case 3: {
@@ -488,7 +523,8 @@ bool optimizeSAH(DBVHNode *node) {
 
                 node->surfaceArea = SAHs[3];
                 (node->rightChild)->surfaceArea = leftSA + rightRightSA + swapRightLeftToLeft.getSA();
-                return true;
+                node->maxDepthRight = std::max(node->rightChild->maxDepthLeft, node->rightChild->maxDepthRight) + 1;
+                break;
             } else {
                 auto buffer = node->leftLeaf;
                 if (node->rightChild->maxDepthLeft > 1) {
@@ -504,7 +540,8 @@ bool optimizeSAH(DBVHNode *node) {
 
                 node->surfaceArea = SAHs[3];
                 (node->rightChild)->surfaceArea = leftSA + rightRightSA + swapRightLeftToLeft.getSA();
-                return true;
+                node->maxDepthRight = std::max(node->rightChild->maxDepthLeft, node->rightChild->maxDepthRight) + 1;
+                break;
             }
         }
         case 4: {
@@ -523,7 +560,8 @@ bool optimizeSAH(DBVHNode *node) {
 
                 node->surfaceArea = SAHs[4];
                 (node->rightChild)->surfaceArea = leftSA + rightLeftSA + swapRightRightToLeft.getSA();
-                return true;
+                node->maxDepthRight = std::max(node->rightChild->maxDepthLeft, node->rightChild->maxDepthRight) + 1;
+                break;
             } else {
                 auto buffer = node->leftLeaf;
                 if (node->rightChild->maxDepthRight > 1) {
@@ -539,16 +577,24 @@ bool optimizeSAH(DBVHNode *node) {
 
                 node->surfaceArea = SAHs[4];
                 (node->rightChild)->surfaceArea = leftSA + rightLeftSA + swapRightRightToLeft.getSA();
-                return true;
+                node->maxDepthRight = std::max(node->rightChild->maxDepthLeft, node->rightChild->maxDepthRight) + 1;
+                break;
             }
         }
         default:
             node->surfaceArea = SAHs[0];
             return false;
     }
+
+    // the rotation moved a grandchild up into node and a child down into one of its children
+    relink(node);
+    if (node->maxDepthLeft > 1) relink(node->leftChild);
+    if (node->maxDepthRight > 1) relink(node->rightChild);
+    return true;
 }
 
-static void add(DBVHNode *currentNode, std::vector<Object *> *objects, uint8_t depth) {
+static void
+add(DBVHNode *currentNode, std::vector<DBVHLeaf *> *objects, uint8_t depth, TaskScheduler *taskScheduler) {
     // refit current node to objects
     auto *node = currentNode;
     refit(node->boundingBox, objects, 0);
@@ -588,16 +634,16 @@ static void add(DBVHNode *currentNode, std::vector<Object *> *objects, uint8_t d
             leftBox = (node->leftChild)->boundingBox;
             leftSA = (node->leftChild)->surfaceArea / leftBox.getSA();
         } else {
-            leftBox = (node->leftLeaf)->getBoundaries();
-            leftSA = (node->leftLeaf)->getSurfaceArea() / leftBox.getSA();
+            leftBox = (node->leftLeaf)->object->getBoundaries();
+            leftSA = (node->leftLeaf)->object->getSurfaceArea() / leftBox.getSA();
         }
         if (node->maxDepthRight != 0) {
             if (node->maxDepthRight > 1) {
                 rightBox = (node->rightChild)->boundingBox;
                 rightSA = (node->rightChild)->surfaceArea / rightBox.getSA();
             } else {
-                rightBox = (node->rightLeaf)->getBoundaries();
-                rightSA = (node->rightLeaf)->getSurfaceArea() / rightBox.getSA();
+                rightBox = (node->rightLeaf)->object->getBoundaries();
+                rightSA = (node->rightLeaf)->object->getSurfaceArea() / rightBox.getSA();
             }
             for (int i = 0; i < 9; i++) {
                 SAH[i] = evaluateBucket(&leftBox, &rightBox, leftSA, rightSA, objects, splittingPlanes[i],
@@ -615,8 +661,8 @@ static void add(DBVHNode *currentNode, std::vector<Object *> *objects, uint8_t d
     }
 
     // choose best split bucket and split node accordingly
-    auto *leftObjects = new std::vector<Object *>();
-    auto *rightObjects = new std::vector<Object *>();
+    auto *leftObjects = new std::vector<DBVHLeaf *>();
+    auto *rightObjects = new std::vector<DBVHLeaf *>();
 
     double bestSAH = std::numeric_limits<double>::max();
     int bestSplittingPlane = -1;
@@ -671,7 +717,7 @@ static void add(DBVHNode *currentNode, std::vector<Object *> *objects, uint8_t d
                 } else {
                     newNode->rightLeaf = node->rightLeaf;
                     newNode->maxDepthRight = 1;
-                    refit(&newNode->boundingBox, node->rightLeaf->getBoundaries());
+                    refit(&newNode->boundingBox, node->rightLeaf->object->getBoundaries());
                 }
                 if (node->maxDepthLeft > 1) {
                     newNode->leftChild = node->leftChild;
@@ -680,9 +726,10 @@ static void add(DBVHNode *currentNode, std::vector<Object *> *objects, uint8_t d
                 } else {
                     newNode->leftLeaf = node->leftLeaf;
                     newNode->maxDepthLeft = 1;
-                    refit(&newNode->boundingBox, node->leftLeaf->getBoundaries());
+                    refit(&newNode->boundingBox, node->leftLeaf->object->getBoundaries());
                 }
                 newNode->surfaceArea = node->surfaceArea;
+                relink(newNode);
                 node->leftChild = newNode;
                 node->maxDepthLeft = std::max(newNode->maxDepthLeft, newNode->maxDepthRight) + 1;
                 node->rightChild = nullptr;
@@ -701,7 +748,7 @@ static void add(DBVHNode *currentNode, std::vector<Object *> *objects, uint8_t d
                 } else {
                     newNode->rightLeaf = node->rightLeaf;
                     newNode->maxDepthRight = 1;
-                    refit(&newNode->boundingBox, node->rightLeaf->getBoundaries());
+                    refit(&newNode->boundingBox, node->rightLeaf->object->getBoundaries());
                 }
                 if (node->maxDepthLeft > 1) {
                     newNode->leftChild = node->leftChild;
@@ -710,9 +757,10 @@ static void add(DBVHNode *currentNode, std::vector<Object *> *objects, uint8_t d
                 } else {
                     newNode->leftLeaf = node->leftLeaf;
                     newNode->maxDepthLeft = 1;
-                    refit(&newNode->boundingBox, node->leftLeaf->getBoundaries());
+                    refit(&newNode->boundingBox, node->leftLeaf->object->getBoundaries());
                 }
                 newNode->surfaceArea = node->surfaceArea;
+                relink(newNode);
                 node->leftChild = newNode;
                 node->maxDepthLeft = std::max(newNode->maxDepthLeft, newNode->maxDepthRight) + 1;
                 node->rightChild = nullptr;
@@ -733,7 +781,7 @@ static void add(DBVHNode *currentNode, std::vector<Object *> *objects, uint8_t d
                 } else {
                     newNode->rightLeaf = node->rightLeaf;
                     newNode->maxDepthRight = 1;
-                    refit(&newNode->boundingBox, node->rightLeaf->getBoundaries());
+                    refit(&newNode->boundingBox, node->rightLeaf->object->getBoundaries());
                 }
                 if (node->maxDepthLeft > 1) {
                     newNode->leftChild = node->leftChild;
@@ -742,9 +790,10 @@ static void add(DBVHNode *currentNode, std::vector<Object *> *objects, uint8_t d
                 } else {
                     newNode->leftLeaf = node->leftLeaf;
                     newNode->maxDepthLeft = 1;
-                    refit(&newNode->boundingBox, node->leftLeaf->getBoundaries());
+                    refit(&newNode->boundingBox, node->leftLeaf->object->getBoundaries());
                 }
                 newNode->surfaceArea = node->surfaceArea;
+                relink(newNode);
                 node->leftChild = newNode;
                 node->maxDepthLeft = std::max(newNode->maxDepthLeft, newNode->maxDepthRight) + 1;
                 node->rightChild = nullptr;
@@ -758,6 +807,9 @@ static void add(DBVHNode *currentNode, std::vector<Object *> *objects, uint8_t d
     }
 
     // pass objects to children
+    DBVHNode *leftTarget = nullptr;
+    DBVHNode *rightTarget = nullptr;
+
     if (leftObjects->size() == 1) {
         if (node->maxDepthLeft == 0) {
             // create new child
@@ -767,16 +819,17 @@ static void add(DBVHNode *currentNode, std::vector<Object *> *objects, uint8_t d
             // create new parent for both children
             auto buffer = node->leftLeaf;
             auto parent = new DBVHNode();
-            parent->boundingBox = buffer->getBoundaries();
+            parent->boundingBox = buffer->object->getBoundaries();
             refit(parent->boundingBox, leftObjects, 0);
             parent->leftLeaf = buffer;
             parent->rightLeaf = leftObjects->at(0);
             parent->maxDepthLeft = 1;
             parent->maxDepthRight = 1;
             node->leftChild = parent;
+            relink(parent);
             node->maxDepthLeft = 2;
         } else {
-            add(node->leftChild, leftObjects, depth + 1);
+            leftTarget = node->leftChild;
         }
     } else if (!leftObjects->empty()) {
         if (node->maxDepthLeft == 0) {
@@ -784,20 +837,21 @@ static void add(DBVHNode *currentNode, std::vector<Object *> *objects, uint8_t d
             auto child = new DBVHNode();
             node->leftChild = child;
             node->maxDepthLeft = 2;
-            add(node->leftChild, leftObjects, depth + 1);
+            leftTarget = node->leftChild;
         } else if (node->maxDepthLeft == 1) {
             // create new parent for both children
             auto buffer = node->leftLeaf;
             auto parent = new DBVHNode();
             parent->leftLeaf = buffer;
-            parent->boundingBox = buffer->getBoundaries();
+            parent->boundingBox = buffer->object->getBoundaries();
             parent->surfaceArea = parent->boundingBox.getSA() * 2;
             parent->maxDepthLeft = 1;
             node->leftChild = parent;
+            relink(parent);
             node->maxDepthLeft = 2;
-            add(node->leftChild, leftObjects, depth + 1);
+            leftTarget = node->leftChild;
         } else {
-            add(node->leftChild, leftObjects, depth + 1);
+            leftTarget = node->leftChild;
         }
     }
 
@@ -810,16 +864,17 @@ static void add(DBVHNode *currentNode, std::vector<Object *> *objects, uint8_t d
             // create new parent for both children
             auto buffer = node->rightLeaf;
             auto parent = new DBVHNode();
-            parent->boundingBox = buffer->getBoundaries();
+            parent->boundingBox = buffer->object->getBoundaries();
             refit(parent->boundingBox, rightObjects, 0);
             parent->leftLeaf = buffer;
             parent->rightLeaf = rightObjects->at(0);
             parent->maxDepthLeft = 1;
             parent->maxDepthRight = 1;
             node->rightChild = parent;
+            relink(parent);
             node->maxDepthRight = 2;
         } else {
-            add(node->rightChild, rightObjects, depth + 1);
+            rightTarget = node->rightChild;
         }
     } else if (!rightObjects->empty()) {
         if (node->maxDepthRight == 0) {
@@ -827,23 +882,38 @@ static void add(DBVHNode *currentNode, std::vector<Object *> *objects, uint8_t d
             auto child = new DBVHNode();
             node->rightChild = child;
             node->maxDepthRight = 2;
-            add(node->rightChild, rightObjects, depth + 1);
+            rightTarget = node->rightChild;
         } else if (node->maxDepthRight == 1) {
             // create new parent for both children
             auto buffer = node->rightLeaf;
             auto parent = new DBVHNode();
             parent->rightLeaf = buffer;
-            parent->boundingBox = buffer->getBoundaries();
+            parent->boundingBox = buffer->object->getBoundaries();
             parent->surfaceArea = parent->boundingBox.getSA() * 2;
             parent->maxDepthRight = 1;
             node->rightChild = parent;
+            relink(parent);
             node->maxDepthRight = 2;
-            add(node->rightChild, rightObjects, depth + 1);
+            rightTarget = node->rightChild;
         } else {
-            add(node->rightChild, rightObjects, depth + 1);
+            rightTarget = node->rightChild;
         }
     }
 
+    if (taskScheduler != nullptr && leftTarget != nullptr && rightTarget != nullptr &&
+        leftObjects->size() + rightObjects->size() >= PARALLEL_BUILD_THRESHOLD) {
+        // the subtrees are disjoint, so they can be built concurrently
+        TaskGroup taskGroup;
+        taskScheduler->spawn(&taskGroup, [leftTarget, leftObjects, depth, taskScheduler] {
+            add(leftTarget, leftObjects, depth + 1, taskScheduler);
+        });
+        add(rightTarget, rightObjects, depth + 1, taskScheduler);
+        taskScheduler->wait(&taskGroup);
+    } else {
+        if (leftTarget != nullptr) add(leftTarget, leftObjects, depth + 1, taskScheduler);
+        if (rightTarget != nullptr) add(rightTarget, rightObjects, depth + 1, taskScheduler);
+    }
+
     delete leftObjects;
     delete rightObjects;
 
@@ -852,92 +922,208 @@ static void add(DBVHNode *currentNode, std::vector<Object *> *objects, uint8_t d
         node->surfaceArea += (node->leftChild)->surfaceArea;
         node->maxDepthLeft = std::max(node->leftChild->maxDepthLeft, node->leftChild->maxDepthRight) + 1;
     } else {
-        node->surfaceArea += (node->leftLeaf)->getSurfaceArea();
+        node->surfaceArea += (node->leftLeaf)->object->getSurfaceArea();
     }
     if (node->maxDepthRight > 1) {
         node->surfaceArea += (node->rightChild)->surfaceArea;
         node->maxDepthRight = std::max(node->rightChild->maxDepthLeft, node->rightChild->maxDepthRight) + 1;
     } else {
-        node->surfaceArea += (node->rightLeaf)->getSurfaceArea();
+        node->surfaceArea += (node->rightLeaf)->object->getSurfaceArea();
     }
 
+    relink(node);
+
     // use tree rotations going the tree back up to optimize SAH
     optimizeSAH(node);
 }
 
-static void remove(DBVHNode *currentNode, Object *object) {
-    if (contains(currentNode->boundingBox, object->getBoundaries())) {
-        if (currentNode->maxDepthLeft > 1) {
-            auto child = currentNode->leftChild;
-            if (contains(child->boundingBox, object->getBoundaries())) {
-                if (child->maxDepthLeft == 1) {
-                    auto grandChild = child->leftLeaf;
-                    if (grandChild->operator==(object)) {
-                        if (child->maxDepthRight == 1) {
-                            currentNode->leftLeaf = child->rightLeaf;
-                        } else {
-                            currentNode->leftChild = child->rightChild;
-                        }
-                        delete child;
-                        refit(currentNode);
-                        return;
-                    }
-                }
-                if (child->maxDepthRight == 1) {
-                    auto grandChild = child->rightLeaf;
-                    if (grandChild->operator==(object)) {
-                        if (child->maxDepthLeft == 1) {
-                            currentNode->leftLeaf = child->leftLeaf;
-                        } else {
-                            currentNode->leftChild = child->leftChild;
-                        }
-                        delete child;
-                        refit(currentNode);
-                        return;
-                    }
-                }
-            }
-            remove(currentNode->leftChild, object);
-        }
-        if (currentNode->maxDepthRight > 1) {
-            auto child = currentNode->rightChild;
-            if (contains(child->boundingBox, object->getBoundaries())) {
-                if (child->maxDepthLeft == 1) {
-                    auto grandChild = child->leftLeaf;
-                    if (grandChild->operator==(object)) {
-                        if (child->maxDepthRight == 1) {
-                            currentNode->rightLeaf = child->rightLeaf;
-                        } else {
-                            currentNode->rightChild = child->rightChild;
-                        }
-                        delete child;
-                        refit(currentNode);
-                        return;
-                    }
-                }
-                if (child->maxDepthRight == 1) {
-                    auto grandChild = child->rightLeaf;
-                    if (grandChild->operator==(object)) {
-                        if (child->maxDepthLeft == 1) {
-                            currentNode->rightLeaf = child->leftLeaf;
-                        } else {
-                            currentNode->rightChild = child->leftChild;
-                        }
-                        delete child;
-                        refit(currentNode);
-                        return;
-                    }
-                }
-            }
-            remove(currentNode->rightChild, object);
+static void build(DBVHNode *node, std::vector<BuildObject> *objects, uint64_t begin, uint64_t end,
+                  TaskScheduler *taskScheduler) {
+    node->boundingBox = emptyBoundingBox();
+    for (uint64_t i = begin; i < end; i++) {
+        expandBoundingBox(node->boundingBox, (*objects)[i].boundingBox);
+    }
+
+    uint64_t middle = partitionBinnedSAH(*objects, begin, end);
+
+    DBVHNode *leftTarget = nullptr;
+    DBVHNode *rightTarget = nullptr;
+
+    if (middle - begin == 1) {
+        node->leftLeaf = (*objects)[begin].leaf;
+        node->maxDepthLeft = 1;
+    } else {
+        node->leftChild = new DBVHNode();
+        node->maxDepthLeft = 2;
+        leftTarget = node->leftChild;
+    }
+
+    if (end - middle == 1) {
+        node->rightLeaf = (*objects)[middle].leaf;
+        node->maxDepthRight = 1;
+    } else {
+        node->rightChild = new DBVHNode();
+        node->maxDepthRight = 2;
+        rightTarget = node->rightChild;
+    }
+
+    if (taskScheduler != nullptr && leftTarget != nullptr && rightTarget != nullptr &&
+        end - begin >= PARALLEL_BUILD_THRESHOLD) {
+        // both sides are disjoint ranges of the object list, so they can be built concurrently
+        TaskGroup taskGroup;
+        taskScheduler->spawn(&taskGroup, [leftTarget, objects, begin, middle, taskScheduler] {
+            build(leftTarget, objects, begin, middle, taskScheduler);
+        });
+        build(rightTarget, objects, middle, end, taskScheduler);
+        taskScheduler->wait(&taskGroup);
+    } else {
+        if (leftTarget != nullptr) build(leftTarget, objects, begin, middle, taskScheduler);
+        if (rightTarget != nullptr) build(rightTarget, objects, middle, end, taskScheduler);
+    }
+
+    node->surfaceArea = node->boundingBox.getSA();
+    if (node->maxDepthLeft > 1) {
+        node->surfaceArea += (node->leftChild)->surfaceArea;
+        node->maxDepthLeft = std::max(node->leftChild->maxDepthLeft, node->leftChild->maxDepthRight) + 1;
+    } else {
+        node->surfaceArea += (*objects)[begin].surfaceArea;
+    }
+    if (node->maxDepthRight > 1) {
+        node->surfaceArea += (node->rightChild)->surfaceArea;
+        node->maxDepthRight = std::max(node->rightChild->maxDepthLeft, node->rightChild->maxDepthRight) + 1;
+    } else {
+        node->surfaceArea += (*objects)[middle].surfaceArea;
+    }
+
+    relink(node);
+}
+
+/**
+ * Builds a tree from scratch with a binned SAH, top down. Used instead of inserting one object after another whenever
+ * objects are added to an empty tree.
+ */
+static void buildBulk(DBVHNode *root, std::vector<DBVHLeaf *> *objects, TaskScheduler *taskScheduler) {
+    std::vector<BuildObject> buildObjects(objects->size());
+
+    auto prepare = [objects, &buildObjects](uint64_t first, uint64_t last) {
+        for (uint64_t i = first; i < last; i++) {
+            DBVHLeaf *leaf = (*objects)[i];
+            BoundingBox boundingBox = leaf->object->getBoundaries();
+            buildObjects[i] = {boundingBox, {(boundingBox.minCorner.x + boundingBox.maxCorner.x) / 2,
+                                             (boundingBox.minCorner.y + boundingBox.maxCorner.y) / 2,
+                                             (boundingBox.minCorner.z + boundingBox.maxCorner.z) / 2},
+                               leaf->object->getSurfaceArea(), leaf};
         }
+    };
+
+    if (taskScheduler != nullptr) {
+        uint64_t chunkCount = (objects->size() + BULK_BUILD_CHUNK_SIZE - 1) / BULK_BUILD_CHUNK_SIZE;
+        taskScheduler->parallelFor(chunkCount, [&prepare, objects](uint64_t chunk, unsigned int workerId) {
+            prepare(chunk * BULK_BUILD_CHUNK_SIZE, std::min(objects->size(), (chunk + 1) * BULK_BUILD_CHUNK_SIZE));
+        });
+    } else {
+        prepare(0, objects->size());
+    }
 
-        refit(currentNode);
+    build(root, &buildObjects, 0, buildObjects.size(), taskScheduler);
+}
 
-        optimizeSAH(currentNode);
+/**
+ * Marks a node and all of its ancestors, stops at the first ancestor that is already marked.
+ */
+static void markPath(DBVHNode *node, std::unordered_set<DBVHNode *> *marked) {
+    while (node != nullptr && marked->insert(node).second) {
+        node = node->parent;
     }
 }
 
+static void refitMarked(DBVHNode *node, const std::unordered_set<DBVHNode *> *marked, bool optimize) {
+    if (node->maxDepthLeft > 1 && marked->count(node->leftChild) != 0) {
+        refitMarked(node->leftChild, marked, optimize);
+    }
+    if (node->maxDepthRight > 1 && marked->count(node->rightChild) != 0) {
+        refitMarked(node->rightChild, marked, optimize);
+    }
+
+    // the children are already refit, so the rotations see their current boxes, rotations below may change the depth
+    if (node->maxDepthLeft > 1) {
+        node->maxDepthLeft = std::max(node->leftChild->maxDepthLeft, node->leftChild->maxDepthRight) + 1;
+    }
+    if (node->maxDepthRight > 1) {
+        node->maxDepthRight = std::max(node->rightChild->maxDepthLeft, node->rightChild->maxDepthRight) + 1;
+    }
+    refit(node);
+    if (optimize) optimizeSAH(node);
+}
+
+static void refitRoot(DBVHNode *root, const std::unordered_set<DBVHNode *> *marked, bool optimize) {
+    if (root->maxDepthLeft == 0) return;
+    if (root->maxDepthRight == 0) {
+        // a root holding a single object only stores its box
+        root->boundingBox = root->leftLeaf->object->getBoundaries();
+        root->surfaceArea = root->leftLeaf->object->getSurfaceArea();
+        return;
+    }
+    if (marked->count(root) != 0) refitMarked(root, marked, optimize);
+}
+
+/**
+ * Unlinks an object from the tree. The node holding the object is replaced by the sibling of the object, the root is
+ * kept and takes over the sibling instead. Nodes whose boxes have to be refit afterwards are marked.
+ */
+static void unlink(DBVHNode *root, DBVHLeaf *leaf, std::unordered_set<DBVHNode *> *marked) {
+    DBVHNode *node = leaf->node;
+
+    uint8_t siblingDepth;
+    DBVHNode *siblingChild = nullptr;
+    DBVHLeaf *siblingLeaf = nullptr;
+    if (node->maxDepthLeft == 1 && node->leftLeaf == leaf) {
+        siblingDepth = node->maxDepthRight;
+        if (siblingDepth > 1) siblingChild = node->rightChild; else siblingLeaf = node->rightLeaf;
+    } else {
+        siblingDepth = node->maxDepthLeft;
+        if (siblingDepth > 1) siblingChild = node->leftChild; else siblingLeaf = node->leftLeaf;
+    }
+
+    if (node == root) {
+        if (siblingDepth == 0) {
+            root->leftLeaf = nullptr;
+            root->maxDepthLeft = 0;
+            root->boundingBox = emptyBoundingBox();
+            root->surfaceArea = 0;
+        } else if (siblingDepth == 1) {
+            root->leftLeaf = siblingLeaf;
+            root->maxDepthLeft = 1;
+            root->rightLeaf = nullptr;
+            root->maxDepthRight = 0;
+            relink(root);
+        } else {
+            root->leftChild = siblingChild->leftChild;
+            root->maxDepthLeft = siblingChild->maxDepthLeft;
+            root->rightChild = siblingChild->rightChild;
+            root->maxDepthRight = siblingChild->maxDepthRight;
+            relink(root);
+            marked->erase(siblingChild);
+            delete siblingChild;
+            marked->insert(root);
+        }
+        return;
+    }
+
+    DBVHNode *parent = node->parent;
+    if (parent->maxDepthLeft > 1 && parent->leftChild == node) {
+        if (siblingDepth > 1) parent->leftChild = siblingChild; else parent->leftLeaf = siblingLeaf;
+        parent->maxDepthLeft = siblingDepth;
+    } else {
+        if (siblingDepth > 1) parent->rightChild = siblingChild; else parent->rightLeaf = siblingLeaf;
+        parent->maxDepthRight = siblingDepth;
+    }
+    relink(parent);
+    marked->erase(node);
+    delete node;
+    markPath(parent, marked);
+}
+
 static bool traverseALl(DBVHNode *root, std::vector<IntersectionInfo *> *intersectionInfo, Ray *ray) {
     if(root->maxDepthRight >= 64 || root->maxDepthLeft >= 64) {
         auto **stack = new DBVHNode *[root->maxDepthRight > root->maxDepthLeft ? root->maxDepthRight + 1 :
@@ -966,7 +1152,7 @@ static bool traverseALl(DBVHNode *root, std::vector<IntersectionInfo *> *interse
                 intersectionInformationBuffer->distance = std::numeric_limits<double>::max();
                 intersectionInformationBuffer->position = {0, 0, 0};
                 auto *rightLeaf = node->rightLeaf;
-                rightLeaf->intersectFirst(intersectionInformationBuffer, ray);
+                rightLeaf->object->intersectFirst(intersectionInformationBuffer, ray);
                 if (intersectionInformationBuffer->hit) {
                     intersectionInfo->push_back(intersectionInformationBuffer);
                 } else {
@@ -987,7 +1173,7 @@ static bool traverseALl(DBVHNode *root, std::vector<IntersectionInfo *> *interse
                 intersectionInformationBuffer->distance = std::numeric_limits<double>::max();
                 intersectionInformationBuffer->position = {0, 0, 0};
                 auto *leftLeaf = node->leftLeaf;
-                leftLeaf->intersectFirst(intersectionInformationBuffer, ray);
+                leftLeaf->object->intersectFirst(intersectionInformationBuffer, ray);
                 if (intersectionInformationBuffer->hit) {
                     intersectionInfo->push_back(intersectionInformationBuffer);
                 } else {
@@ -1024,7 +1210,7 @@ static bool traverseALl(DBVHNode *root, std::vector<IntersectionInfo *> *interse
                 intersectionInformationBuffer->distance = std::numeric_limits<double>::max();
                 intersectionInformationBuffer->position = {0, 0, 0};
                 auto *rightLeaf = node->rightLeaf;
-                rightLeaf->intersectFirst(intersectionInformationBuffer, ray);
+                rightLeaf->object->intersectFirst(intersectionInformationBuffer, ray);
                 if (intersectionInformationBuffer->hit) {
                     intersectionInfo->push_back(intersectionInformationBuffer);
                 } else {
@@ -1045,7 +1231,7 @@ static bool traverseALl(DBVHNode *root, std::vector<IntersectionInfo *> *interse
                 intersectionInformationBuffer->distance = std::numeric_limits<double>::max();
                 intersectionInformationBuffer->position = {0, 0, 0};
                 auto *leftLeaf = node->leftLeaf;
-                leftLeaf->intersectFirst(intersectionInformationBuffer, ray);
+                leftLeaf->object->intersectFirst(intersectionInformationBuffer, ray);
                 if (intersectionInformationBuffer->hit) {
                     intersectionInfo->push_back(intersectionInformationBuffer);
                 } else {
@@ -1097,7 +1283,7 @@ static bool traverseFirst(DBVHNode *root, IntersectionInfo *intersectionInfo, Ra
                 intersectionInformationBuffer.distance = std::numeric_limits<double>::max();
                 intersectionInformationBuffer.position = {0, 0, 0};
                 auto *rightLeaf = node->rightLeaf;
-                rightLeaf->intersectFirst(&intersectionInformationBuffer, ray);
+                rightLeaf->object->intersectFirst(&intersectionInformationBuffer, ray);
                 if (intersectionInformationBuffer.hit) {
                     if (intersectionInformationBuffer.distance < intersectionInfo->distance) {
                         *intersectionInfo = intersectionInformationBuffer;
@@ -1117,7 +1303,7 @@ static bool traverseFirst(DBVHNode *root, IntersectionInfo *intersectionInfo, Ra
                 intersectionInformationBuffer.distance = std::numeric_limits<double>::max();
                 intersectionInformationBuffer.position = {0, 0, 0};
                 auto *leftLeaf = node->leftLeaf;
-                leftLeaf->intersectFirst(&intersectionInformationBuffer, ray);
+                leftLeaf->object->intersectFirst(&intersectionInformationBuffer, ray);
                 if (intersectionInformationBuffer.hit) {
                     if (intersectionInformationBuffer.distance < intersectionInfo->distance) {
                         *intersectionInfo = intersectionInformationBuffer;
@@ -1175,7 +1361,7 @@ static bool traverseFirst(DBVHNode *root, IntersectionInfo *intersectionInfo, Ra
                 intersectionInformationBuffer.distance = std::numeric_limits<double>::max();
                 intersectionInformationBuffer.position = {0, 0, 0};
                 auto *rightLeaf = node->rightLeaf;
-                rightLeaf->intersectFirst(&intersectionInformationBuffer, ray);
+                rightLeaf->object->intersectFirst(&intersectionInformationBuffer, ray);
                 if (intersectionInformationBuffer.hit) {
                     if (intersectionInformationBuffer.distance < intersectionInfo->distance) {
                         *intersectionInfo = intersectionInformationBuffer;
@@ -1195,7 +1381,7 @@ static bool traverseFirst(DBVHNode *root, IntersectionInfo *intersectionInfo, Ra
                 intersectionInformationBuffer.distance = std::numeric_limits<double>::max();
                 intersectionInformationBuffer.position = {0, 0, 0};
                 auto *leftLeaf = node->leftLeaf;
-                leftLeaf->intersectFirst(&intersectionInformationBuffer, ray);
+                leftLeaf->object->intersectFirst(&intersectionInformationBuffer, ray);
                 if (intersectionInformationBuffer.hit) {
                     if (intersectionInformationBuffer.distance < intersectionInfo->distance) {
                         *intersectionInfo = intersectionInformationBuffer;
@@ -1251,7 +1437,7 @@ static bool traverseAny(DBVHNode *root, IntersectionInfo *intersectionInfo, Ray
                 intersectionInformationBuffer.distance = std::numeric_limits<double>::max();
                 intersectionInformationBuffer.position = {0, 0, 0};
                 auto *rightLeaf = node->rightLeaf;
-                rightLeaf->intersectAny(&intersectionInformationBuffer, ray);
+                rightLeaf->object->intersectAny(&intersectionInformationBuffer, ray);
                 if (intersectionInformationBuffer.hit) {
                     *intersectionInfo = intersectionInformationBuffer;
                     delete[] stack;
@@ -1272,7 +1458,7 @@ static bool traverseAny(DBVHNode *root, IntersectionInfo *intersectionInfo, Ray
                 intersectionInformationBuffer.distance = std::numeric_limits<double>::max();
                 intersectionInformationBuffer.position = {0, 0, 0};
                 auto *leftLeaf = node->leftLeaf;
-                leftLeaf->intersectAny(&intersectionInformationBuffer, ray);
+                leftLeaf->object->intersectAny(&intersectionInformationBuffer, ray);
                 if (intersectionInformationBuffer.hit) {
                     *intersectionInfo = intersectionInformationBuffer;
                     delete[] stack;
@@ -1309,7 +1495,7 @@ static bool traverseAny(DBVHNode *root, IntersectionInfo *intersectionInfo, Ray
                 intersectionInformationBuffer.distance = std::numeric_limits<double>::max();
                 intersectionInformationBuffer.position = {0, 0, 0};
                 auto *rightLeaf = node->rightLeaf;
-                rightLeaf->intersectAny(&intersectionInformationBuffer, ray);
+                rightLeaf->object->intersectAny(&intersectionInformationBuffer, ray);
                 if (intersectionInformationBuffer.hit) {
                     *intersectionInfo = intersectionInformationBuffer;
                     return true;
@@ -1329,7 +1515,7 @@ static bool traverseAny(DBVHNode *root, IntersectionInfo *intersectionInfo, Ray
                 intersectionInformationBuffer.distance = std::numeric_limits<double>::max();
                 intersectionInformationBuffer.position = {0, 0, 0};
                 auto *leftLeaf = node->leftLeaf;
-                leftLeaf->intersectAny(&intersectionInformationBuffer, ray);
+                leftLeaf->object->intersectAny(&intersectionInformationBuffer, ray);
                 if (intersectionInformationBuffer.hit) {
                     *intersectionInfo = intersectionInformationBuffer;
                     return true;
@@ -1341,70 +1527,117 @@ static bool traverseAny(DBVHNode *root, IntersectionInfo *intersectionInfo, Ray
     }
 }
 
-void DBVHv2::addObjects(DBVHNode *root, std::vector<Object *> *objects) {
+void DBVHv2::addObjects(DBVHNode *root, std::vector<Object *> *objects, std::vector<DBVHLeaf *> *leaves) {
+    addObjects(root, objects, leaves, nullptr);
+}
+
+void DBVHv2::addObjects(DBVHNode *root, std::vector<Object *> *objects, std::vector<DBVHLeaf *> *leaves,
+                        TaskScheduler *taskScheduler) {
     if (objects->empty()) return;
     if (root == nullptr) {
         // TODO error handling (should never happen)
         return;
     }
+
+    std::vector<DBVHLeaf *> newLeaves;
+    newLeaves.reserve(objects->size() + 1);
+    for (auto &object: *objects) {
+        newLeaves.push_back(new DBVHLeaf{object, nullptr});
+    }
+    if (leaves != nullptr) leaves->insert(leaves->end(), newLeaves.begin(), newLeaves.end());
+
     if (root->maxDepthLeft == 0) {
-        if (objects->size() == 1) {
-            refit(root->boundingBox, objects, 0);
-            root->leftLeaf = objects->back();
+        if (newLeaves.size() == 1) {
+            refit(root->boundingBox, &newLeaves, 0);
+            root->leftLeaf = newLeaves.back();
             root->maxDepthLeft = 1;
+            relink(root);
             return;
         }
     } else if (root->maxDepthRight == 0) {
-        objects->push_back(root->leftLeaf);
+        newLeaves.push_back(root->leftLeaf);
         root->maxDepthLeft = 0;
     }
 
-    add(root, objects, 1);
+    if (root->maxDepthLeft == 0) {
+        buildBulk(root, &newLeaves, taskScheduler);
+    } else {
+        add(root, &newLeaves, 1, taskScheduler);
+    }
+}
+
+void DBVHv2::removeObjects(DBVHNode *root, std::vector<DBVHLeaf *> *leaves) {
+    if (root == nullptr || leaves->empty()) return;
+
+    // unlink every object first, so that nodes shared by several removed objects are refit only once
+    std::unordered_set<DBVHNode *> marked;
+    for (auto &leaf: *leaves) {
+        unlink(root, leaf, &marked);
+        delete leaf;
+    }
+
+    refitRoot(root, &marked, true);
 }
 
-void DBVHv2::removeObjects(DBVHNode *root, std::vector<Object *> *objects) {
+void DBVHv2::refitObjects(DBVHNode *root, std::vector<DBVHLeaf *> *leaves, bool optimize) {
+    if (root == nullptr || root->maxDepthLeft == 0 || leaves->empty()) return;
+
+    std::unordered_set<DBVHNode *> marked;
+    for (auto &leaf: *leaves) {
+        markPath(leaf->node, &marked);
+    }
+
+    refitRoot(root, &marked, optimize);
+}
+
+/**
+ * Collects the handles below a node and deletes all nodes below it, the node itself is kept.
+ */
+static void releaseLeaves(DBVHNode *node, std::vector<DBVHLeaf *> *leaves) {
+    if (node->maxDepthLeft > 1) {
+        releaseLeaves(node->leftChild, leaves);
+        delete node->leftChild;
+    } else if (node->maxDepthLeft == 1) {
+        leaves->push_back(node->leftLeaf);
+    }
+    if (node->maxDepthRight > 1) {
+        releaseLeaves(node->rightChild, leaves);
+        delete node->rightChild;
+    } else if (node->maxDepthRight == 1) {
+        leaves->push_back(node->rightLeaf);
+    }
+}
+
+void DBVHv2::rebuild(DBVHNode *root, std::vector<Object *> *objects, std::vector<DBVHLeaf *> *leaves,
+                     TaskScheduler *taskScheduler) {
     if (root == nullptr) return;
-    // find object in tree by insertion
-    // remove object and refit nodes going the tree back up
+
+    std::vector<DBVHLeaf *> allLeaves;
+    allLeaves.reserve(objects->size());
+    releaseLeaves(root, &allLeaves);
     for (auto &object: *objects) {
-        if (root->maxDepthLeft == 0) return;
-        if (root->maxDepthRight == 0) {
-            if (root->leftLeaf->operator==(object)) {
-                root->maxDepthLeft = 0;
-                root->surfaceArea = 0;
-                root->leftLeaf = nullptr;
-                return;
-            }
-            continue;
-        }
-        if (root->maxDepthLeft == 1) {
-            if (root->leftLeaf->operator==(object)) {
-                if (root->maxDepthRight == 1) {
-                    root->leftLeaf = root->rightLeaf;
-                    root->rightLeaf = nullptr;
-                    root->maxDepthRight = 0;
-                    root->boundingBox = root->leftLeaf->getBoundaries();
-                    root->surfaceArea = root->leftLeaf->getSurfaceArea();
-                } else {
-                    root->leftLeaf = nullptr;
-                    root->maxDepthLeft = 0;
-                    root->surfaceArea = 0;
-                    return;
-                }
-                continue;
-            }
-        }
-        if (root->maxDepthRight == 1) {
-            if (root->rightLeaf->operator==(object)) {
-                root->rightLeaf = nullptr;
-                root->maxDepthRight = 0;
-                root->boundingBox = root->leftLeaf->getBoundaries();
-                root->surfaceArea = root->leftLeaf->getSurfaceArea();
-                continue;
-            }
-        }
-        remove(root, object);
+        auto leaf = new DBVHLeaf{object, nullptr};
+        allLeaves.push_back(leaf);
+        if (leaves != nullptr) leaves->push_back(leaf);
+    }
+
+    root->leftChild = nullptr;
+    root->maxDepthLeft = 0;
+    root->rightChild = nullptr;
+    root->maxDepthRight = 0;
+    root->boundingBox = emptyBoundingBox();
+    root->surfaceArea = 0;
+
+    if (allLeaves.empty()) return;
+    if (allLeaves.size() == 1) {
+        refit(root->boundingBox, &allLeaves, 0);
+        root->leftLeaf = allLeaves.back();
+        root->maxDepthLeft = 1;
+        relink(root);
+        return;
     }
+
+    buildBulk(root, &allLeaves, taskScheduler);
 }
 
 bool DBVHv2::intersectFirst(DBVHNode *root, IntersectionInfo *intersectionInfo, Ray *ray) {
@@ -1416,7 +1649,7 @@ bool DBVHv2::intersectFirst(DBVHNode *root, IntersectionInfo *intersectionInfo,
         return false;
     } else {
         if (root->maxDepthRight == 0) {
-            hit = root->leftLeaf->intersectFirst(intersectionInfo, ray);
+            hit = root->leftLeaf->object->intersectFirst(intersectionInfo, ray);
         } else {
             hit = traverseFirst(root, intersectionInfo, ray);
         }
@@ -1434,7 +1667,7 @@ bool DBVHv2::intersectAny(DBVHNode *root, IntersectionInfo *intersectionInfo, Ra
         return false;
     } else {
         if (root->maxDepthRight == 0) {
-            hit = root->leftLeaf->intersectAny(intersectionInfo, ray);
+            hit = root->leftLeaf->object->intersectAny(intersectionInfo, ray);
         } else {
             hit = traverseAny(root, intersectionInfo, ray);
         }
@@ -1452,7 +1685,7 @@ bool DBVHv2::intersectAll(DBVHNode *root, std::vector<IntersectionInfo *> *inter
         return false;
     } else {
         if (root->maxDepthRight == 0) {
-            hit = root->leftLeaf->intersectAll(intersectionInfo, ray);
+            hit = root->leftLeaf->object->intersectAll(intersectionInfo, ray);
         } else {
             hit = traverseALl(root, intersectionInfo, ray);
         }
@@ -1462,15 +1695,15 @@ bool DBVHv2::intersectAll(DBVHNode *root, std::vector<IntersectionInfo *> *inter
 }
 
 void DBVHv2::deleteTree(DBVHNode *root) {
-    if (root->maxDepthLeft == 1 && root->maxDepthRight == 1) {
-        delete root;
-        return;
-    }
     if (root->maxDepthLeft > 1) {
         deleteTree(root->leftChild);
+    } else if (root->maxDepthLeft == 1) {
+        delete root->leftLeaf;
     }
     if (root->maxDepthRight > 1) {
         deleteTree(root->rightChild);
+    } else if (root->maxDepthRight == 1) {
+        delete root->rightLeaf;
     }
     delete root;
 }
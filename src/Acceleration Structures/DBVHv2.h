@@ -7,17 +7,34 @@
 
 #include "RayTraceEngine/Object.h"
 
+class TaskScheduler;
+
+struct DBVHNode;
+
+/**
+ * Handle of an object stored in a tree, handed out when the object is added and valid until it is removed. The tree
+ * keeps node pointing at the node holding the object, no matter how often it is moved by rotations and insertions.
+ * object:  The stored object.
+ * node:    Node holding the object as its left or right leaf.
+ */
+struct DBVHLeaf {
+    Object *object;
+    DBVHNode *node;
+};
+
 struct DBVHNode {
+    DBVHNode *parent{};
+
     uint8_t maxDepthLeft = 0;
     union {
         DBVHNode *leftChild{};
-        Object *leftLeaf;
+        DBVHLeaf *leftLeaf;
     };
 
     uint8_t maxDepthRight = 0;
     union {
         DBVHNode *rightChild{};
-        Object *rightLeaf;
+        DBVHLeaf *rightLeaf;
     };
 
     BoundingBox boundingBox{std::numeric_limits<double>::max(), std::numeric_limits<double>::max(),
@@ -28,9 +45,46 @@ struct DBVHNode {
 
 class DBVHv2 {
 public:
-    static void addObjects(DBVHNode *root, std::vector<Object *> *objects);
+    static void addObjects(DBVHNode *root, std::vector<Object *> *objects, std::vector<DBVHLeaf *> *leaves);
+
+    /**
+     * Adds objects to the tree, disjoint subtrees are built in parallel by the task scheduler.
+     * @param root          Root of the tree.
+     * @param objects       Objects to be added.
+     * @param leaves        Receives the handles of the added objects in the order of objects, may be nullptr.
+     * @param taskScheduler Scheduler executing the build tasks, nullptr builds on the calling thread.
+     */
+    static void addObjects(DBVHNode *root, std::vector<Object *> *objects, std::vector<DBVHLeaf *> *leaves,
+                           TaskScheduler *taskScheduler);
+
+    /**
+     * Removes objects by their handles, no search is involved. Each object is unlinked from its node, the nodes above
+     * are refit bottom up in a single pass afterwards. The handles are deleted.
+     * @param root      Root of the tree.
+     * @param leaves    Handles of the objects to be removed, each handle must belong to this tree.
+     */
+    static void removeObjects(DBVHNode *root, std::vector<DBVHLeaf *> *leaves);
+
+    /**
+     * Refits the tree after the boundaries of some of its objects changed, the tree structure is kept. Only nodes above
+     * changed objects are recomputed, bottom up in a single pass.
+     * @param root      Root of the tree.
+     * @param leaves    Handles of the objects whose boundaries changed.
+     * @param optimize  Applies tree rotations to the refit nodes to restore the quality of the tree.
+     */
+    static void refitObjects(DBVHNode *root, std::vector<DBVHLeaf *> *leaves, bool optimize);
 
-    static void removeObjects(DBVHNode *root, std::vector<Object *> *objects);
+    /**
+     * Rebuilds the whole tree top down with a binned SAH, together with newly added objects. Cheaper than inserting and
+     * refitting object by object once a large part of the tree changed, and it restores the tree quality that rotations
+     * can only approximate. The handles of the stored objects stay valid.
+     * @param root          Root of the tree.
+     * @param objects       Objects to be added, may be empty.
+     * @param leaves        Receives the handles of the added objects in the order of objects, may be nullptr.
+     * @param taskScheduler Scheduler executing the build tasks, nullptr builds on the calling thread.
+     */
+    static void rebuild(DBVHNode *root, std::vector<Object *> *objects, std::vector<DBVHLeaf *> *leaves,
+                        TaskScheduler *taskScheduler);
 
     static bool intersectFirst(DBVHNode *root, IntersectionInfo *intersectionInfo, Ray *ray);
 
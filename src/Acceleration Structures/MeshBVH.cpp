@@ -0,0 +1,750 @@
+//
+// Created by Sebastian on 18.10.2026.
+//
+
+#include <algorithm>
+#include <cmath>
+#include "MeshBVH.h"
+#include "BinnedSAH.h"
+
+/**
+ * Triangle during the construction of the tree.
+ */
+struct MeshBVH::BuildTriangle {
+    BoundingBox boundingBox;
+    Vector3D centroid;
+    uint32_t triangle;
+};
+
+#if defined(WIDE_BVH_AVX2) && !defined(RAYTRACEENGINE_SINGLE_PRECISION)
+// AVX-512 code is compiled for single functions only and selected at runtime, like the AVX2 code
+#define MESH_BVH_AVX512
+#define TARGET_AVX512 __attribute__((target("avx512f")))
+#endif
+
+// a triangle is missed if the ray is closer to parallel than this, or if the hit is closer to the origin than this
+static const Real TRIANGLE_EPSILON = 0.000001f;
+
+/**
+ * Result of intersecting a ray with all lanes of a triangle block, only lanes set in the hit mask are valid.
+ * t:       Ray parameter of the intersection per lane.
+ * u, v:    Barycentric coordinates of the intersection per lane.
+ */
+struct alignas(64) BlockHits {
+    Real t[TRIANGLE_BLOCK_SIZE];
+    Real u[TRIANGLE_BLOCK_SIZE];
+    Real v[TRIANGLE_BLOCK_SIZE];
+};
+
+/**
+ * Intersects a ray with every triangle of a block.
+ * @return  Bit mask of the lanes that were hit.
+ */
+typedef uint32_t (*BlockKernel)(const TriangleBlock *block, Ray *ray, BlockHits *hits);
+
+#ifdef RAYTRACEENGINE_SCALAR_KERNELS
+static const bool FORCE_SCALAR_KERNEL = true;
+#else
+static const bool FORCE_SCALAR_KERNEL = false;
+#endif
+
+/**
+ * Intersects a ray with one lane of a triangle block using the Moeller-Trumbore algorithm. The SIMD kernels perform the
+ * exact same operations in the same order, so that all kernels give bit identical results.
+ */
+static bool intersectTriangle(const TriangleBlock *block, uint32_t lane, Ray *ray, BlockHits *hits) {
+    auto originX = (Real) ray->origin.x;
+    auto originY = (Real) ray->origin.y;
+    auto originZ = (Real) ray->origin.z;
+    auto directionX = (Real) ray->direction.x;
+    auto directionY = (Real) ray->direction.y;
+    auto directionZ = (Real) ray->direction.z;
+
+    Real pvecX = directionY * block->e2z[lane] - directionZ * block->e2y[lane];
+    Real pvecY = directionZ * block->e2x[lane] - directionX * block->e2z[lane];
+    Real pvecZ = directionX * block->e2y[lane] - directionY * block->e2x[lane];
+
+    Real det = pvecX * block->e1x[lane] + pvecY * block->e1y[lane] + pvecZ * block->e1z[lane];
+
+    if (det < TRIANGLE_EPSILON && det > -TRIANGLE_EPSILON) return false;
+
+    Real invDet = (Real) 1.0 / det;
+
+    Real tvecX = originX - block->v0x[lane];
+    Real tvecY = originY - block->v0y[lane];
+    Real tvecZ = originZ - block->v0z[lane];
+
+    Real u = invDet * (tvecX * pvecX + tvecY * pvecY + tvecZ * pvecZ);
+
+    if (u < 0 || u > 1) return false;
+
+    Real qvecX = tvecY * block->e1z[lane] - tvecZ * block->e1y[lane];
+    Real qvecY = tvecZ * block->e1x[lane] - tvecX * block->e1z[lane];
+    Real qvecZ = tvecX * block->e1y[lane] - tvecY * block->e1x[lane];
+
+    Real v = invDet * (qvecX * directionX + qvecY * directionY + qvecZ * directionZ);
+
+    if (v < 0 || u + v > 1) return false;
+
+    Real t = invDet * (block->e2x[lane] * qvecX + block->e2y[lane] * qvecY + block->e2z[lane] * qvecZ);
+
+    if (t <= TRIANGLE_EPSILON) return false;
+
+    hits->t[lane] = t;
+    hits->u[lane] = u;
+    hits->v[lane] = v;
+    return true;
+}
+
+static uint32_t intersectBlockScalar(const TriangleBlock *block, Ray *ray, BlockHits *hits) {
+    uint32_t mask = 0;
+    for (uint32_t lane = 0; lane < block->count; lane++) {
+        if (intersectTriangle(block, lane, ray, hits)) mask |= 1u << lane;
+    }
+    return mask;
+}
+
+#if defined(WIDE_BVH_SSE) && !defined(RAYTRACEENGINE_SINGLE_PRECISION)
+
+static uint32_t intersectBlockSSE(const TriangleBlock *block, Ray *ray, BlockHits *hits) {
+    __m128d originX = _mm_set1_pd(ray->origin.x);
+    __m128d originY = _mm_set1_pd(ray->origin.y);
+    __m128d originZ = _mm_set1_pd(ray->origin.z);
+    __m128d directionX = _mm_set1_pd(ray->direction.x);
+    __m128d directionY = _mm_set1_pd(ray->direction.y);
+    __m128d directionZ = _mm_set1_pd(ray->direction.z);
+    __m128d epsilon = _mm_set1_pd(TRIANGLE_EPSILON);
+    __m128d negativeEpsilon = _mm_set1_pd(-TRIANGLE_EPSILON);
+    __m128d zero = _mm_setzero_pd();
+    __m128d one = _mm_set1_pd(1.0);
+
+    uint32_t mask = 0;
+    for (uint32_t lane = 0; lane < block->count; lane += 2) {
+        __m128d e1x = _mm_load_pd(block->e1x + lane);
+        __m128d e1y = _mm_load_pd(block->e1y + lane);
+        __m128d e1z = _mm_load_pd(block->e1z + lane);
+        __m128d e2x = _mm_load_pd(block->e2x + lane);
+        __m128d e2y = _mm_load_pd(block->e2y + lane);
+        __m128d e2z = _mm_load_pd(block->e2z + lane);
+
+        __m128d pvecX = _mm_sub_pd(_mm_mul_pd(directionY, e2z), _mm_mul_pd(directionZ, e2y));
+        __m128d pvecY = _mm_sub_pd(_mm_mul_pd(directionZ, e2x), _mm_mul_pd(directionX, e2z));
+        __m128d pvecZ = _mm_sub_pd(_mm_mul_pd(directionX, e2y), _mm_mul_pd(directionY, e2x));
+
+        __m128d det = _mm_add_pd(_mm_add_pd(_mm_mul_pd(pvecX, e1x), _mm_mul_pd(pvecY, e1y)), _mm_mul_pd(pvecZ, e1z));
+        __m128d invDet = _mm_div_pd(one, det);
+
+        __m128d tvecX = _mm_sub_pd(originX, _mm_load_pd(block->v0x + lane));
+        __m128d tvecY = _mm_sub_pd(originY, _mm_load_pd(block->v0y + lane));
+        __m128d tvecZ = _mm_sub_pd(originZ, _mm_load_pd(block->v0z + lane));
+
+        __m128d u = _mm_mul_pd(invDet, _mm_add_pd(_mm_add_pd(_mm_mul_pd(tvecX, pvecX), _mm_mul_pd(tvecY, pvecY)),
+                                                  _mm_mul_pd(tvecZ, pvecZ)));
+
+        __m128d qvecX = _mm_sub_pd(_mm_mul_pd(tvecY, e1z), _mm_mul_pd(tvecZ, e1y));
+        __m128d qvecY = _mm_sub_pd(_mm_mul_pd(tvecZ, e1x), _mm_mul_pd(tvecX, e1z));
+        __m128d qvecZ = _mm_sub_pd(_mm_mul_pd(tvecX, e1y), _mm_mul_pd(tvecY, e1x));
+
+        __m128d v = _mm_mul_pd(invDet, _mm_add_pd(
+                _mm_add_pd(_mm_mul_pd(qvecX, directionX), _mm_mul_pd(qvecY, directionY)), _mm_mul_pd(qvecZ, directionZ)));
+        __m128d t = _mm_mul_pd(invDet, _mm_add_pd(_mm_add_pd(_mm_mul_pd(e2x, qvecX), _mm_mul_pd(e2y, qvecY)),
+                                                  _mm_mul_pd(e2z, qvecZ)));
+
+        // ordered comparisons are false for NaN, exactly like the branches of the scalar test
+        __m128d miss = _mm_and_pd(_mm_cmplt_pd(det, epsilon), _mm_cmpgt_pd(det, negativeEpsilon));
+        miss = _mm_or_pd(miss, _mm_or_pd(_mm_cmplt_pd(u, zero), _mm_cmpgt_pd(u, one)));
+        miss = _mm_or_pd(miss, _mm_or_pd(_mm_cmplt_pd(v, zero), _mm_cmpgt_pd(_mm_add_pd(u, v), one)));
+        miss = _mm_or_pd(miss, _mm_cmple_pd(t, epsilon));
+
+        _mm_store_pd(hits->t + lane, t);
+        _mm_store_pd(hits->u + lane, u);
+        _mm_store_pd(hits->v + lane, v);
+        mask |= (~(uint32_t) _mm_movemask_pd(miss) & 0x3u) << lane;
+    }
+    return mask;
+}
+
+#endif
+
+#if defined(WIDE_BVH_AVX2) && !defined(RAYTRACEENGINE_SINGLE_PRECISION)
+
+TARGET_AVX2
+static uint32_t intersectBlockAVX2(const TriangleBlock *block, Ray *ray, BlockHits *hits) {
+    __m256d originX = _mm256_set1_pd(ray->origin.x);
+    __m256d originY = _mm256_set1_pd(ray->origin.y);
+    __m256d originZ = _mm256_set1_pd(ray->origin.z);
+    __m256d directionX = _mm256_set1_pd(ray->direction.x);
+    __m256d directionY = _mm256_set1_pd(ray->direction.y);
+    __m256d directionZ = _mm256_set1_pd(ray->direction.z);
+    __m256d epsilon = _mm256_set1_pd(TRIANGLE_EPSILON);
+    __m256d negativeEpsilon = _mm256_set1_pd(-TRIANGLE_EPSILON);
+    __m256d zero = _mm256_setzero_pd();
+    __m256d one = _mm256_set1_pd(1.0);
+
+    uint32_t mask = 0;
+    for (uint32_t lane = 0; lane < block->count; lane += 4) {
+        __m256d e1x = _mm256_load_pd(block->e1x + lane);
+        __m256d e1y = _mm256_load_pd(block->e1y + lane);
+        __m256d e1z = _mm256_load_pd(block->e1z + lane);
+        __m256d e2x = _mm256_load_pd(block->e2x + lane);
+        __m256d e2y = _mm256_load_pd(block->e2y + lane);
+        __m256d e2z = _mm256_load_pd(block->e2z + lane);
+
+        __m256d pvecX = _mm256_sub_pd(_mm256_mul_pd(directionY, e2z), _mm256_mul_pd(directionZ, e2y));
+        __m256d pvecY = _mm256_sub_pd(_mm256_mul_pd(directionZ, e2x), _mm256_mul_pd(directionX, e2z));
+        __m256d pvecZ = _mm256_sub_pd(_mm256_mul_pd(directionX, e2y), _mm256_mul_pd(directionY, e2x));
+
+        __m256d det = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(pvecX, e1x), _mm256_mul_pd(pvecY, e1y)),
+                                    _mm256_mul_pd(pvecZ, e1z));
+        __m256d invDet = _mm256_div_pd(one, det);
+
+        __m256d tvecX = _mm256_sub_pd(originX, _mm256_load_pd(block->v0x + lane));
+        __m256d tvecY = _mm256_sub_pd(originY, _mm256_load_pd(block->v0y + lane));
+        __m256d tvecZ = _mm256_sub_pd(originZ, _mm256_load_pd(block->v0z + lane));
+
+        __m256d u = _mm256_mul_pd(invDet, _mm256_add_pd(
+                _mm256_add_pd(_mm256_mul_pd(tvecX, pvecX), _mm256_mul_pd(tvecY, pvecY)), _mm256_mul_pd(tvecZ, pvecZ)));
+
+        __m256d qvecX = _mm256_sub_pd(_mm256_mul_pd(tvecY, e1z), _mm256_mul_pd(tvecZ, e1y));
+        __m256d qvecY = _mm256_sub_pd(_mm256_mul_pd(tvecZ, e1x), _mm256_mul_pd(tvecX, e1z));
+        __m256d qvecZ = _mm256_sub_pd(_mm256_mul_pd(tvecX, e1y), _mm256_mul_pd(tvecY, e1x));
+
+        __m256d v = _mm256_mul_pd(invDet, _mm256_add_pd(
+                _mm256_add_pd(_mm256_mul_pd(qvecX, directionX), _mm256_mul_pd(qvecY, directionY)),
+                _mm256_mul_pd(qvecZ, directionZ)));
+        __m256d t = _mm256_mul_pd(invDet, _mm256_add_pd(
+                _mm256_add_pd(_mm256_mul_pd(e2x, qvecX), _mm256_mul_pd(e2y, qvecY)), _mm256_mul_pd(e2z, qvecZ)));
+
+        __m256d miss = _mm256_and_pd(_mm256_cmp_pd(det, epsilon, _CMP_LT_OQ),
+                                     _mm256_cmp_pd(det, negativeEpsilon, _CMP_GT_OQ));
+        miss = _mm256_or_pd(miss, _mm256_or_pd(_mm256_cmp_pd(u, zero, _CMP_LT_OQ), _mm256_cmp_pd(u, one, _CMP_GT_OQ)));
+        miss = _mm256_or_pd(miss, _mm256_or_pd(_mm256_cmp_pd(v, zero, _CMP_LT_OQ),
+                                               _mm256_cmp_pd(_mm256_add_pd(u, v), one, _CMP_GT_OQ)));
+        miss = _mm256_or_pd(miss, _mm256_cmp_pd(t, epsilon, _CMP_LE_OQ));
+
+        _mm256_store_pd(hits->t + lane, t);
+        _mm256_store_pd(hits->u + lane, u);
+        _mm256_store_pd(hits->v + lane, v);
+        mask |= (~(uint32_t) _mm256_movemask_pd(miss) & 0xFu) << lane;
+    }
+    return mask;
+}
+
+#endif
+
+#ifdef MESH_BVH_AVX512
+
+TARGET_AVX512
+static uint32_t intersectBlockAVX512(const TriangleBlock *block, Ray *ray, BlockHits *hits) {
+    __m512d e1x = _mm512_load_pd(block->e1x);
+    __m512d e1y = _mm512_load_pd(block->e1y);
+    __m512d e1z = _mm512_load_pd(block->e1z);
+    __m512d e2x = _mm512_load_pd(block->e2x);
+    __m512d e2y = _mm512_load_pd(block->e2y);
+    __m512d e2z = _mm512_load_pd(block->e2z);
+    __m512d directionX = _mm512_set1_pd(ray->direction.x);
+    __m512d directionY = _mm512_set1_pd(ray->direction.y);
+    __m512d directionZ = _mm512_set1_pd(ray->direction.z);
+    __m512d epsilon = _mm512_set1_pd(TRIANGLE_EPSILON);
+    __m512d zero = _mm512_setzero_pd();
+    __m512d one = _mm512_set1_pd(1.0);
+
+    __m512d pvecX = _mm512_sub_pd(_mm512_mul_pd(directionY, e2z), _mm512_mul_pd(directionZ, e2y));
+    __m512d pvecY = _mm512_sub_pd(_mm512_mul_pd(directionZ, e2x), _mm512_mul_pd(directionX, e2z));
+    __m512d pvecZ = _mm512_sub_pd(_mm512_mul_pd(directionX, e2y), _mm512_mul_pd(directionY, e2x));
+
+    __m512d det = _mm512_add_pd(_mm512_add_pd(_mm512_mul_pd(pvecX, e1x), _mm512_mul_pd(pvecY, e1y)),
+                                _mm512_mul_pd(pvecZ, e1z));
+    __m512d invDet = _mm512_div_pd(one, det);
+
+    __m512d tvecX = _mm512_sub_pd(_mm512_set1_pd(ray->origin.x), _mm512_load_pd(block->v0x));
+    __m512d tvecY = _mm512_sub_pd(_mm512_set1_pd(ray->origin.y), _mm512_load_pd(block->v0y));
+    __m512d tvecZ = _mm512_sub_pd(_mm512_set1_pd(ray->origin.z), _mm512_load_pd(block->v0z));
+
+    __m512d u = _mm512_mul_pd(invDet, _mm512_add_pd(
+            _mm512_add_pd(_mm512_mul_pd(tvecX, pvecX), _mm512_mul_pd(tvecY, pvecY)), _mm512_mul_pd(tvecZ, pvecZ)));
+
+    __m512d qvecX = _mm512_sub_pd(_mm512_mul_pd(tvecY, e1z), _mm512_mul_pd(tvecZ, e1y));
+    __m512d qvecY = _mm512_sub_pd(_mm512_mul_pd(tvecZ, e1x), _mm512_mul_pd(tvecX, e1z));
+    __m512d qvecZ = _mm512_sub_pd(_mm512_mul_pd(tvecX, e1y), _mm512_mul_pd(tvecY, e1x));
+
+    __m512d v = _mm512_mul_pd(invDet, _mm512_add_pd(
+            _mm512_add_pd(_mm512_mul_pd(qvecX, directionX), _mm512_mul_pd(qvecY, directionY)),
+            _mm512_mul_pd(qvecZ, directionZ)));
+    __m512d t = _mm512_mul_pd(invDet, _mm512_add_pd(
+            _mm512_add_pd(_mm512_mul_pd(e2x, qvecX), _mm512_mul_pd(e2y, qvecY)), _mm512_mul_pd(e2z, qvecZ)));
+
+    __mmask8 miss = _mm512_cmp_pd_mask(det, epsilon, _CMP_LT_OQ) &
+                    _mm512_cmp_pd_mask(det, _mm512_set1_pd(-TRIANGLE_EPSILON), _CMP_GT_OQ);
+    miss |= _mm512_cmp_pd_mask(u, zero, _CMP_LT_OQ) | _mm512_cmp_pd_mask(u, one, _CMP_GT_OQ);
+    miss |= _mm512_cmp_pd_mask(v, zero, _CMP_LT_OQ) | _mm512_cmp_pd_mask(_mm512_add_pd(u, v), one, _CMP_GT_OQ);
+    miss |= _mm512_cmp_pd_mask(t, epsilon, _CMP_LE_OQ);
+
+    _mm512_store_pd(hits->t, t);
+    _mm512_store_pd(hits->u, u);
+    _mm512_store_pd(hits->v, v);
+    return ~(uint32_t) miss & 0xFFu;
+}
+
+#endif
+
+#if defined(WIDE_BVH_SSE) && defined(RAYTRACEENGINE_SINGLE_PRECISION)
+
+static uint32_t intersectBlockSSE(const TriangleBlock *block, Ray *ray, BlockHits *hits) {
+    __m128 originX = _mm_set1_ps((float) ray->origin.x);
+    __m128 originY = _mm_set1_ps((float) ray->origin.y);
+    __m128 originZ = _mm_set1_ps((float) ray->origin.z);
+    __m128 directionX = _mm_set1_ps((float) ray->direction.x);
+    __m128 directionY = _mm_set1_ps((float) ray->direction.y);
+    __m128 directionZ = _mm_set1_ps((float) ray->direction.z);
+    __m128 epsilon = _mm_set1_ps(TRIANGLE_EPSILON);
+    __m128 negativeEpsilon = _mm_set1_ps(-TRIANGLE_EPSILON);
+    __m128 zero = _mm_setzero_ps();
+    __m128 one = _mm_set1_ps(1.0f);
+
+    uint32_t mask = 0;
+    for (uint32_t lane = 0; lane < block->count; lane += 4) {
+        __m128 e1x = _mm_load_ps(block->e1x + lane);
+        __m128 e1y = _mm_load_ps(block->e1y + lane);
+        __m128 e1z = _mm_load_ps(block->e1z + lane);
+        __m128 e2x = _mm_load_ps(block->e2x + lane);
+        __m128 e2y = _mm_load_ps(block->e2y + lane);
+        __m128 e2z = _mm_load_ps(block->e2z + lane);
+
+        __m128 pvecX = _mm_sub_ps(_mm_mul_ps(directionY, e2z), _mm_mul_ps(directionZ, e2y));
+        __m128 pvecY = _mm_sub_ps(_mm_mul_ps(directionZ, e2x), _mm_mul_ps(directionX, e2z));
+        __m128 pvecZ = _mm_sub_ps(_mm_mul_ps(directionX, e2y), _mm_mul_ps(directionY, e2x));
+
+        __m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(pvecX, e1x), _mm_mul_ps(pvecY, e1y)), _mm_mul_ps(pvecZ, e1z));
+        __m128 invDet = _mm_div_ps(one, det);
+
+        __m128 tvecX = _mm_sub_ps(originX, _mm_load_ps(block->v0x + lane));
+        __m128 tvecY = _mm_sub_ps(originY, _mm_load_ps(block->v0y + lane));
+        __m128 tvecZ = _mm_sub_ps(originZ, _mm_load_ps(block->v0z + lane));
+
+        __m128 u = _mm_mul_ps(invDet, _mm_add_ps(_mm_add_ps(_mm_mul_ps(tvecX, pvecX), _mm_mul_ps(tvecY, pvecY)),
+                                                 _mm_mul_ps(tvecZ, pvecZ)));
+
+        __m128 qvecX = _mm_sub_ps(_mm_mul_ps(tvecY, e1z), _mm_mul_ps(tvecZ, e1y));
+        __m128 qvecY = _mm_sub_ps(_mm_mul_ps(tvecZ, e1x), _mm_mul_ps(tvecX, e1z));
+        __m128 qvecZ = _mm_sub_ps(_mm_mul_ps(tvecX, e1y), _mm_mul_ps(tvecY, e1x));
+
+        __m128 v = _mm_mul_ps(invDet, _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(qvecX, directionX), _mm_mul_ps(qvecY, directionY)), _mm_mul_ps(qvecZ, directionZ)));
+        __m128 t = _mm_mul_ps(invDet, _mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qvecX), _mm_mul_ps(e2y, qvecY)),
+                                                 _mm_mul_ps(e2z, qvecZ)));
+
+        __m128 miss = _mm_and_ps(_mm_cmplt_ps(det, epsilon), _mm_cmpgt_ps(det, negativeEpsilon));
+        miss = _mm_or_ps(miss, _mm_or_ps(_mm_cmplt_ps(u, zero), _mm_cmpgt_ps(u, one)));
+        miss = _mm_or_ps(miss, _mm_or_ps(_mm_cmplt_ps(v, zero), _mm_cmpgt_ps(_mm_add_ps(u, v), one)));
+        miss = _mm_or_ps(miss, _mm_cmple_ps(t, epsilon));
+
+        _mm_store_ps(hits->t + lane, t);
+        _mm_store_ps(hits->u + lane, u);
+        _mm_store_ps(hits->v + lane, v);
+        mask |= (~(uint32_t) _mm_movemask_ps(miss) & 0xFu) << lane;
+    }
+    return mask;
+}
+
+#endif
+
+#if defined(WIDE_BVH_AVX2) && defined(RAYTRACEENGINE_SINGLE_PRECISION)
+
+TARGET_AVX2
+static uint32_t intersectBlockAVX2(const TriangleBlock *block, Ray *ray, BlockHits *hits) {
+    __m256 e1x = _mm256_load_ps(block->e1x);
+    __m256 e1y = _mm256_load_ps(block->e1y);
+    __m256 e1z = _mm256_load_ps(block->e1z);
+    __m256 e2x = _mm256_load_ps(block->e2x);
+    __m256 e2y = _mm256_load_ps(block->e2y);
+    __m256 e2z = _mm256_load_ps(block->e2z);
+    __m256 directionX = _mm256_set1_ps((float) ray->direction.x);
+    __m256 directionY = _mm256_set1_ps((float) ray->direction.y);
+    __m256 directionZ = _mm256_set1_ps((float) ray->direction.z);
+    __m256 epsilon = _mm256_set1_ps(TRIANGLE_EPSILON);
+    __m256 zero = _mm256_setzero_ps();
+    __m256 one = _mm256_set1_ps(1.0f);
+
+    __m256 pvecX = _mm256_sub_ps(_mm256_mul_ps(directionY, e2z), _mm256_mul_ps(directionZ, e2y));
+    __m256 pvecY = _mm256_sub_ps(_mm256_mul_ps(directionZ, e2x), _mm256_mul_ps(directionX, e2z));
+    __m256 pvecZ = _mm256_sub_ps(_mm256_mul_ps(directionX, e2y), _mm256_mul_ps(directionY, e2x));
+
+    __m256 det = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(pvecX, e1x), _mm256_mul_ps(pvecY, e1y)),
+                               _mm256_mul_ps(pvecZ, e1z));
+    __m256 invDet = _mm256_div_ps(one, det);
+
+    __m256 tvecX = _mm256_sub_ps(_mm256_set1_ps((float) ray->origin.x), _mm256_load_ps(block->v0x));
+    __m256 tvecY = _mm256_sub_ps(_mm256_set1_ps((float) ray->origin.y), _mm256_load_ps(block->v0y));
+    __m256 tvecZ = _mm256_sub_ps(_mm256_set1_ps((float) ray->origin.z), _mm256_load_ps(block->v0z));
+
+    __m256 u = _mm256_mul_ps(invDet, _mm256_add_ps(
+            _mm256_add_ps(_mm256_mul_ps(tvecX, pvecX), _mm256_mul_ps(tvecY, pvecY)), _mm256_mul_ps(tvecZ, pvecZ)));
+
+    __m256 qvecX = _mm256_sub_ps(_mm256_mul_ps(tvecY, e1z), _mm256_mul_ps(tvecZ, e1y));
+    __m256 qvecY = _mm256_sub_ps(_mm256_mul_ps(tvecZ, e1x), _mm256_mul_ps(tvecX, e1z));
+    __m256 qvecZ = _mm256_sub_ps(_mm256_mul_ps(tvecX, e1y), _mm256_mul_ps(tvecY, e1x));
+
+    __m256 v = _mm256_mul_ps(invDet, _mm256_add_ps(
+            _mm256_add_ps(_mm256_mul_ps(qvecX, directionX), _mm256_mul_ps(qvecY, directionY)),
+            _mm256_mul_ps(qvecZ, directionZ)));
+    __m256 t = _mm256_mul_ps(invDet, _mm256_add_ps(
+            _mm256_add_ps(_mm256_mul_ps(e2x, qvecX), _mm256_mul_ps(e2y, qvecY)), _mm256_mul_ps(e2z, qvecZ)));
+
+    __m256 miss = _mm256_and_ps(_mm256_cmp_ps(det, epsilon, _CMP_LT_OQ),
+                                _mm256_cmp_ps(det, _mm256_set1_ps(-TRIANGLE_EPSILON), _CMP_GT_OQ));
+    miss = _mm256_or_ps(miss, _mm256_or_ps(_mm256_cmp_ps(u, zero, _CMP_LT_OQ), _mm256_cmp_ps(u, one, _CMP_GT_OQ)));
+    miss = _mm256_or_ps(miss, _mm256_or_ps(_mm256_cmp_ps(v, zero, _CMP_LT_OQ),
+                                           _mm256_cmp_ps(_mm256_add_ps(u, v), one, _CMP_GT_OQ)));
+    miss = _mm256_or_ps(miss, _mm256_cmp_ps(t, epsilon, _CMP_LE_OQ));
+
+    _mm256_store_ps(hits->t, t);
+    _mm256_store_ps(hits->u, u);
+    _mm256_store_ps(hits->v, v);
+    return ~(uint32_t) _mm256_movemask_ps(miss) & 0xFFu;
+}
+
+#endif
+
+/**
+ * Selects the kernel for the widest instruction set supported by the CPU, unless the scalar reference kernel is forced
+ * to check the SIMD kernels against it.
+ */
+static BlockKernel selectBlockKernel() {
+    if (FORCE_SCALAR_KERNEL) return intersectBlockScalar;
+#ifdef MESH_BVH_AVX512
+    if (__builtin_cpu_supports("avx512f")) return intersectBlockAVX512;
+#endif
+#ifdef WIDE_BVH_AVX2
+    if (supportsAVX2()) return intersectBlockAVX2;
+#endif
+#ifdef WIDE_BVH_SSE
+    return intersectBlockSSE;
+#else
+    return intersectBlockScalar;
+#endif
+}
+
+static BlockKernel getBlockKernel() {
+    static const BlockKernel kernel = selectBlockKernel();
+    return kernel;
+}
+
+/**
+ * Intersects the triangle blocks referenced by the leaves of a mesh tree.
+ */
+class MeshLeafIntersector {
+private:
+    const TriangleBlock *blocks;
+    TriangleHit *hit;
+    std::vector<TriangleHit> *hits;
+    Ray *ray;
+    BlockKernel intersectBlock;
+
+public:
+    MeshLeafIntersector(const TriangleBlock *blocks, TriangleHit *hit, std::vector<TriangleHit> *hits, Ray *ray)
+            : blocks(blocks), hit(hit), hits(hits), ray(ray), intersectBlock(getBlockKernel()) {}
+
+    [[nodiscard]] double getClosest() const {
+        return hit->t;
+    }
+
+    bool intersectFirst(uint32_t leaf, float distance) {
+        const TriangleBlock *block = &blocks[leaf];
+        BlockHits blockHits;
+        uint32_t mask = intersectBlock(block, ray, &blockHits);
+        if (mask == 0) return false;
+
+        // lanes are visited in order, so that ties are resolved like in the scalar kernel
+        bool closer = false;
+        for (uint32_t i = 0; i < block->count; i++) {
+            if ((mask & (1u << i)) && blockHits.t[i] < hit->t) {
+                *hit = {block->triangles[i], blockHits.t[i], blockHits.u[i], blockHits.v[i]};
+                closer = true;
+            }
+        }
+        return closer;
+    }
+
+    bool intersectAny(uint32_t leaf) {
+        const TriangleBlock *block = &blocks[leaf];
+        BlockHits blockHits;
+        uint32_t mask = intersectBlock(block, ray, &blockHits);
+        for (uint32_t i = 0; i < block->count; i++) {
+            if (mask & (1u << i)) {
+                *hit = {block->triangles[i], blockHits.t[i], blockHits.u[i], blockHits.v[i]};
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool intersectAll(uint32_t leaf) {
+        const TriangleBlock *block = &blocks[leaf];
+        BlockHits blockHits;
+        uint32_t mask = intersectBlock(block, ray, &blockHits);
+        for (uint32_t i = 0; i < block->count; i++) {
+            if (mask & (1u << i)) hits->push_back({block->triangles[i], blockHits.t[i], blockHits.u[i], blockHits.v[i]});
+        }
+        return mask != 0;
+    }
+};
+
+/**
+ * Intersects the triangle blocks referenced by the leaves of a mesh tree with the rays of a packet.
+ */
+class MeshPacketLeafIntersector {
+private:
+    const TriangleBlock *blocks;
+    TriangleHit *hits;
+    Ray *rays;
+    BlockKernel intersectBlock;
+
+public:
+    MeshPacketLeafIntersector(const TriangleBlock *blocks, TriangleHit *hits, Ray *rays)
+            : blocks(blocks), hits(hits), rays(rays), intersectBlock(getBlockKernel()) {}
+
+    [[nodiscard]] double getClosest(uint32_t ray) const {
+        return hits[ray].t;
+    }
+
+    uint64_t intersectFirst(uint32_t leaf, uint64_t rayMask) {
+        const TriangleBlock *block = &blocks[leaf];
+        uint64_t closer = 0;
+        for (; rayMask != 0; rayMask &= rayMask - 1) {
+            uint32_t ray = lowestBit(rayMask);
+            BlockHits blockHits;
+            uint32_t mask = intersectBlock(block, &rays[ray], &blockHits);
+            if (mask == 0) continue;
+
+            // lanes are visited in order, so that ties are resolved like in the scalar kernel
+            TriangleHit *hit = &hits[ray];
+            for (uint32_t i = 0; i < block->count; i++) {
+                if ((mask & (1u << i)) && blockHits.t[i] < hit->t) {
+                    *hit = {block->triangles[i], blockHits.t[i], blockHits.u[i], blockHits.v[i]};
+                    closer |= 1ull << ray;
+                }
+            }
+        }
+        return closer;
+    }
+
+    uint64_t intersectAny(uint32_t leaf, uint64_t rayMask) {
+        const TriangleBlock *block = &blocks[leaf];
+        uint64_t hit = 0;
+        for (; rayMask != 0; rayMask &= rayMask - 1) {
+            uint32_t ray = lowestBit(rayMask);
+            BlockHits blockHits;
+            uint32_t mask = intersectBlock(block, &rays[ray], &blockHits);
+            for (uint32_t i = 0; i < block->count; i++) {
+                if (mask & (1u << i)) {
+                    hits[ray] = {block->triangles[i], blockHits.t[i], blockHits.u[i], blockHits.v[i]};
+                    hit |= 1ull << ray;
+                    break;
+                }
+            }
+        }
+        return hit;
+    }
+};
+
+MeshBVH::MeshBVH(const std::vector<TriangleMeshObject::Vertex> *vertices, const std::vector<uint64_t> *indices) {
+    width = supportsAVX2() ? 8 : 4;
+    boundingBox = emptyBoundingBox();
+    surfaceArea = 0;
+    maxDepth = 0;
+
+    uint64_t triangleCount = indices->size() / 3;
+    std::vector<BuildTriangle> triangles(triangleCount);
+    for (uint64_t i = 0; i < triangleCount; i++) {
+        BoundingBox box = emptyBoundingBox();
+        for (uint64_t j = 0; j < 3; j++) {
+            expandBoundingBox(box, (*vertices)[(*indices)[i * 3 + j]].position);
+        }
+        triangles[i] = {box, {(box.minCorner.x + box.maxCorner.x) / 2, (box.minCorner.y + box.maxCorner.y) / 2,
+                              (box.minCorner.z + box.maxCorner.z) / 2}, (uint32_t) i};
+        expandBoundingBox(boundingBox, box);
+        surfaceArea += box.getSA();
+    }
+
+    if (triangleCount == 0) return;
+    surfaceArea += boundingBox.getSA();
+
+    if (width == 8) {
+        build<8>(triangles, 0, triangleCount, 1, nodes8, vertices, indices);
+    } else {
+        build<4>(triangles, 0, triangleCount, 1, nodes4, vertices, indices);
+    }
+}
+
+template<int Width, class NodeVector>
+uint32_t MeshBVH::build(std::vector<BuildTriangle> &triangles, uint64_t begin, uint64_t end, uint32_t depth,
+                        NodeVector &nodes, const std::vector<TriangleMeshObject::Vertex> *vertices,
+                        const std::vector<uint64_t> *indices) {
+    maxDepth = std::max(maxDepth, depth);
+
+    // split the largest range until the node is full or every range fits into a leaf
+    std::vector<std::pair<uint64_t, uint64_t>> ranges{{begin, end}};
+    while (ranges.size() < Width) {
+        int largest = -1;
+        uint64_t largestCount = TRIANGLE_BLOCK_SIZE;
+        for (int i = 0; i < (int) ranges.size(); i++) {
+            if (ranges[i].second - ranges[i].first > largestCount) {
+                largestCount = ranges[i].second - ranges[i].first;
+                largest = i;
+            }
+        }
+        if (largest == -1) break;
+
+        uint64_t middle = partitionBinnedSAH(triangles, ranges[largest].first, ranges[largest].second);
+        ranges.emplace_back(middle, ranges[largest].second);
+        ranges[largest].second = middle;
+    }
+
+    auto index = (uint32_t) nodes.size();
+    nodes.emplace_back();
+    clearNode<Width>(&nodes[index]);
+
+    for (int i = 0; i < (int) ranges.size(); i++) {
+        BoundingBox box = emptyBoundingBox();
+        for (uint64_t j = ranges[i].first; j < ranges[i].second; j++) {
+            expandBoundingBox(box, triangles[j].boundingBox);
+        }
+        setChildBox<Width>(&nodes[index], i, box);
+        surfaceArea += box.getSA();
+
+        if (ranges[i].second - ranges[i].first <= TRIANGLE_BLOCK_SIZE) {
+            nodes[index].children[i] = WIDE_BVH_LEAF_FLAG | (uint32_t) blocks.size();
+            addBlock(triangles, ranges[i].first, ranges[i].second, vertices, indices);
+        } else {
+            // the node vector may grow during the recursion, so the child is written by index afterwards
+            uint32_t child = build<Width>(triangles, ranges[i].first, ranges[i].second, depth + 1, nodes, vertices,
+                                          indices);
+            nodes[index].children[i] = child;
+        }
+    }
+
+    return index;
+}
+
+void MeshBVH::addBlock(const std::vector<BuildTriangle> &triangles, uint64_t begin, uint64_t end,
+                       const std::vector<TriangleMeshObject::Vertex> *vertices, const std::vector<uint64_t> *indices) {
+    blocks.emplace_back();
+    TriangleBlock &block = blocks.back();
+    block = {};
+    block.count = (uint32_t) (end - begin);
+
+    for (uint32_t lane = 0; lane < block.count; lane++) {
+        uint32_t triangle = triangles[begin + lane].triangle;
+        Vector3D vertex1 = (*vertices)[(*indices)[(uint64_t) triangle * 3]].position;
+        Vector3D vertex2 = (*vertices)[(*indices)[(uint64_t) triangle * 3 + 1]].position;
+        Vector3D vertex3 = (*vertices)[(*indices)[(uint64_t) triangle * 3 + 2]].position;
+
+        block.v0x[lane] = (Real) vertex1.x;
+        block.v0y[lane] = (Real) vertex1.y;
+        block.v0z[lane] = (Real) vertex1.z;
+        block.e1x[lane] = (Real) (vertex2.x - vertex1.x);
+        block.e1y[lane] = (Real) (vertex2.y - vertex1.y);
+        block.e1z[lane] = (Real) (vertex2.z - vertex1.z);
+        block.e2x[lane] = (Real) (vertex3.x - vertex1.x);
+        block.e2y[lane] = (Real) (vertex3.y - vertex1.y);
+        block.e2z[lane] = (Real) (vertex3.z - vertex1.z);
+        block.triangles[lane] = triangle;
+    }
+}
+
+BoundingBox MeshBVH::getBoundingBox() const {
+    return boundingBox;
+}
+
+double MeshBVH::getSurfaceArea() const {
+    return surfaceArea;
+}
+
+bool MeshBVH::intersectFirst(TriangleHit *hit, Ray *ray) const {
+    if (maxDepth == 0) return false;
+
+    uint32_t stackSize = (width - 1) * maxDepth + 1;
+    WideTraversalContainer localStack[WIDE_BVH_STACK_SIZE];
+    auto *stack = stackSize <= WIDE_BVH_STACK_SIZE ? localStack : new WideTraversalContainer[stackSize];
+
+    MeshLeafIntersector leafIntersector(blocks.data(), hit, nullptr, ray);
+    bool found = width == 8 ? traverseFirst<8>(nodes8.data(), stack, ray, leafIntersector)
+                            : traverseFirst<4>(nodes4.data(), stack, ray, leafIntersector);
+
+    if (stack != localStack) delete[] stack;
+    return found;
+}
+
+bool MeshBVH::intersectAny(TriangleHit *hit, Ray *ray) const {
+    if (maxDepth == 0) return false;
+
+    uint32_t stackSize = (width - 1) * maxDepth + 1;
+    uint32_t localStack[WIDE_BVH_STACK_SIZE];
+    auto *stack = stackSize <= WIDE_BVH_STACK_SIZE ? localStack : new uint32_t[stackSize];
+
+    MeshLeafIntersector leafIntersector(blocks.data(), hit, nullptr, ray);
+    bool found = width == 8 ? traverseAny<8>(nodes8.data(), stack, ray, leafIntersector)
+                            : traverseAny<4>(nodes4.data(), stack, ray, leafIntersector);
+
+    if (stack != localStack) delete[] stack;
+    return found;
+}
+
+bool MeshBVH::intersectAll(std::vector<TriangleHit> *hits, Ray *ray) const {
+    if (maxDepth == 0) return false;
+
+    uint32_t stackSize = (width - 1) * maxDepth + 1;
+    uint32_t localStack[WIDE_BVH_STACK_SIZE];
+    auto *stack = stackSize <= WIDE_BVH_STACK_SIZE ? localStack : new uint32_t[stackSize];
+
+    MeshLeafIntersector leafIntersector(blocks.data(), nullptr, hits, ray);
+    bool found = width == 8 ? traverseAll<8>(nodes8.data(), stack, ray, leafIntersector)
+                            : traverseAll<4>(nodes4.data(), stack, ray, leafIntersector);
+
+    if (stack != localStack) delete[] stack;
+    return found;
+}
+
+uint64_t MeshBVH::intersectFirstPacket(TriangleHit *hits, Ray *rays, uint64_t rayMask) const {
+    if (maxDepth == 0) return 0;
+
+    uint32_t stackSize = (width - 1) * maxDepth + 1;
+    WidePacketContainer localStack[WIDE_BVH_STACK_SIZE];
+    auto *stack = stackSize <= WIDE_BVH_STACK_SIZE ? localStack : new WidePacketContainer[stackSize];
+
+    FloatPacket packet;
+    MeshPacketLeafIntersector leafIntersector(blocks.data(), hits, rays);
+    uint64_t found = tracePackets(rays, rayMask, &packet, [&](const FloatPacket *rayPacket, uint64_t packetMask) {
+        return width == 8 ? traversePacketFirst<8>(nodes8.data(), stack, rayPacket, packetMask, leafIntersector)
+                          : traversePacketFirst<4>(nodes4.data(), stack, rayPacket, packetMask, leafIntersector);
+    }, [&](uint32_t ray) {
+        TriangleHit hit{};
+        if (!intersectFirst(&hit, &rays[ray]) || hit.t >= hits[ray].t) return false;
+        hits[ray] = hit;
+        return true;
+    });
+
+    if (stack != localStack) delete[] stack;
+    return found;
+}
+
+uint64_t MeshBVH::intersectAnyPacket(TriangleHit *hits, Ray *rays, uint64_t rayMask) const {
+    if (maxDepth == 0) return 0;
+
+    uint32_t stackSize = (width - 1) * maxDepth + 1;
+    WidePacketContainer localStack[WIDE_BVH_STACK_SIZE];
+    auto *stack = stackSize <= WIDE_BVH_STACK_SIZE ? localStack : new WidePacketContainer[stackSize];
+
+    FloatPacket packet;
+    MeshPacketLeafIntersector leafIntersector(blocks.data(), hits, rays);
+    uint64_t found = tracePackets(rays, rayMask, &packet, [&](const FloatPacket *rayPacket, uint64_t packetMask) {
+        return width == 8 ? traversePacketAny<8>(nodes8.data(), stack, rayPacket, packetMask, leafIntersector)
+                          : traversePacketAny<4>(nodes4.data(), stack, rayPacket, packetMask, leafIntersector);
+    }, [&](uint32_t ray) {
+        return intersectAny(&hits[ray], &rays[ray]);
+    });
+
+    if (stack != localStack) delete[] stack;
+    return found;
+}
@@ -0,0 +1,153 @@
+//
+// Created by Sebastian on 18.10.2026.
+//
+
+#ifndef RAYTRACEENGINE_MESHBVH_H
+#define RAYTRACEENGINE_MESHBVH_H
+
+#include <vector>
+#include "RayTraceEngine/TriangleMeshObject.h"
+#include "Utils/Allocator/AlignedAllocator.h"
+#include "WideBVH.h"
+
+// precision of the packed triangles, single precision halves their size and doubles the lanes per SIMD register
+#ifdef RAYTRACEENGINE_SINGLE_PRECISION
+typedef float Real;
+#else
+typedef double Real;
+#endif
+
+// number of triangles stored in one leaf
+static const uint32_t TRIANGLE_BLOCK_SIZE = 8;
+
+/**
+ * Leaf of a mesh tree, up to TRIANGLE_BLOCK_SIZE triangles stored as structure of arrays, so that all of them are
+ * intersected in one pass without touching the index and vertex lists. Unused lanes are zero and never hit. In single
+ * precision the vertices are rounded, the boxes of the tree are padded by more than that rounding.
+ * v0x...v0z:   The first vertex of every triangle.
+ * e1x...e1z:   Edge from the first to the second vertex.
+ * e2x...e2z:   Edge from the first to the third vertex.
+ * triangles:   Index of the triangle in the mesh, the first index of the triangle is 3 times this value.
+ * count:       Number of used lanes.
+ */
+struct alignas(64) TriangleBlock {
+    Real v0x[TRIANGLE_BLOCK_SIZE];
+    Real v0y[TRIANGLE_BLOCK_SIZE];
+    Real v0z[TRIANGLE_BLOCK_SIZE];
+    Real e1x[TRIANGLE_BLOCK_SIZE];
+    Real e1y[TRIANGLE_BLOCK_SIZE];
+    Real e1z[TRIANGLE_BLOCK_SIZE];
+    Real e2x[TRIANGLE_BLOCK_SIZE];
+    Real e2y[TRIANGLE_BLOCK_SIZE];
+    Real e2z[TRIANGLE_BLOCK_SIZE];
+    uint32_t triangles[TRIANGLE_BLOCK_SIZE];
+    uint32_t count;
+};
+
+/**
+ * Intersection of a ray with one triangle of a mesh.
+ * triangle:    Index of the triangle in the mesh.
+ * t:           Ray parameter of the intersection.
+ * u, v:        Barycentric coordinates of the intersection with respect to the second and the third vertex.
+ */
+struct TriangleHit {
+    uint32_t triangle;
+    double t;
+    double u;
+    double v;
+};
+
+/**
+ * Static acceleration structure of a triangle mesh. The triangles are sorted into a 4 or 8 wide tree whose leaves are
+ * packed triangle blocks, built once from the index and vertex lists. Only triangle indices and barycentric
+ * coordinates are reported, the mesh resolves normals, texture coordinates and materials of the closest hit only.
+ * width:           Number of children per node, either 4 or 8.
+ * nodes4:          The nodes if the width is 4, the root is at index 0.
+ * nodes8:          The nodes if the width is 8, the root is at index 0.
+ * blocks:          The triangle blocks referenced by the leaf children.
+ * boundingBox:     Bounding box of the whole mesh.
+ * surfaceArea:     Sum of the surface areas of all boxes and triangles, the cost of intersecting the mesh.
+ * maxDepth:        Number of nodes on the longest path from the root to a leaf, used to size the traversal stack.
+ */
+class MeshBVH {
+private:
+    int width;
+    std::vector<WideBVHNode<4>, AlignedAllocator<WideBVHNode<4>, 64>> nodes4;
+    std::vector<WideBVHNode<8>, AlignedAllocator<WideBVHNode<8>, 64>> nodes8;
+    std::vector<TriangleBlock, AlignedAllocator<TriangleBlock, 64>> blocks;
+    BoundingBox boundingBox;
+    double surfaceArea;
+    uint32_t maxDepth;
+
+    struct BuildTriangle;
+
+    template<int Width, class NodeVector>
+    uint32_t build(std::vector<BuildTriangle> &triangles, uint64_t begin, uint64_t end, uint32_t depth,
+                   NodeVector &nodes, const std::vector<TriangleMeshObject::Vertex> *vertices,
+                   const std::vector<uint64_t> *indices);
+
+    void addBlock(const std::vector<BuildTriangle> &triangles, uint64_t begin, uint64_t end,
+                  const std::vector<TriangleMeshObject::Vertex> *vertices, const std::vector<uint64_t> *indices);
+
+public:
+    /**
+     * Builds the tree of a mesh.
+     * @param vertices  The vertices of the mesh.
+     * @param indices   The indices of the mesh, every 3 define one triangle.
+     */
+    MeshBVH(const std::vector<TriangleMeshObject::Vertex> *vertices, const std::vector<uint64_t> *indices);
+
+    /**
+     * @return  Bounding box of the whole mesh.
+     */
+    [[nodiscard]] BoundingBox getBoundingBox() const;
+
+    /**
+     * @return  Sum of the surface areas of all boxes and triangles of the tree.
+     */
+    [[nodiscard]] double getSurfaceArea() const;
+
+    /**
+     * Finds the closest triangle hit by a ray.
+     * @param hit   Its ray parameter bounds the search, it is only overwritten by a closer intersection.
+     * @param ray   The ray.
+     * @return      True if a closer triangle was hit, false otherwise.
+     */
+    bool intersectFirst(TriangleHit *hit, Ray *ray) const;
+
+    /**
+     * Finds any triangle hit by a ray.
+     * @param hit   Filled with the found intersection.
+     * @param ray   The ray.
+     * @return      True if a triangle was hit, false otherwise.
+     */
+    bool intersectAny(TriangleHit *hit, Ray *ray) const;
+
+    /**
+     * Finds all triangles hit by a ray.
+     * @param hits  Receives one entry per triangle that was hit.
+     * @param ray   The ray.
+     * @return      True if a triangle was hit, false otherwise.
+     */
+    bool intersectAll(std::vector<TriangleHit> *hits, Ray *ray) const;
+
+    /**
+     * Finds the closest triangles hit by a packet of rays, coherent rays share one traversal.
+     * @param hits      One entry per ray, its ray parameter bounds the search, it is only overwritten by a closer hit.
+     * @param rays      The rays, at most WIDE_BVH_PACKET_SIZE.
+     * @param rayMask   Mask of the rays to intersect.
+     * @return          Mask of the rays that hit a closer triangle.
+     */
+    uint64_t intersectFirstPacket(TriangleHit *hits, Ray *rays, uint64_t rayMask) const;
+
+    /**
+     * Finds any triangle hit by every ray of a packet, coherent rays share one traversal.
+     * @param hits      One entry per ray, filled with the found intersection.
+     * @param rays      The rays, at most WIDE_BVH_PACKET_SIZE.
+     * @param rayMask   Mask of the rays to intersect.
+     * @return          Mask of the rays that hit a triangle.
+     */
+    uint64_t intersectAnyPacket(TriangleHit *hits, Ray *rays, uint64_t rayMask) const;
+};
+
+#endif //RAYTRACEENGINE_MESHBVH_H
@@ -0,0 +1,737 @@
+//
+// Created by Sebastian on 18.10.2026.
+//
+
+#ifndef RAYTRACEENGINE_WIDEBVH_H
+#define RAYTRACEENGINE_WIDEBVH_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include "RayTraceEngine/Object.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define WIDE_BVH_SSE
+#include <immintrin.h>
+#if defined(__GNUC__)
+// AVX2 code is compiled for single functions only and selected at runtime, the rest of the library stays portable
+#define WIDE_BVH_AVX2
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+// marks a child as leaf, the remaining bits are interpreted by the leaf intersector
+static const uint32_t WIDE_BVH_LEAF_FLAG = 0x80000000u;
+static const uint32_t WIDE_BVH_EMPTY_CHILD = 0xFFFFFFFFu;
+
+// traversals whose stack fits into this many entries keep it on the call stack
+static const uint32_t WIDE_BVH_STACK_SIZE = 256;
+
+// number of rays traced together by the packet traversals, one bit per ray in a 64 bit mask
+static const uint32_t WIDE_BVH_PACKET_SIZE = 64;
+
+// packets with fewer rays than this share too little work, their rays are traced one by one
+static const uint32_t WIDE_BVH_MIN_PACKET_RAYS = 4;
+
+// relative amount by which boxes are enlarged, covers the error of the single precision slab test
+static const double WIDE_BVH_BOX_PADDING = 1.0 / (1 << 20);
+
+/**
+ * A node of a wide tree with up to Width children. The child boxes are stored as structure of arrays in single
+ * precision, so that one SIMD slab test covers all children. Boxes are rounded outwards, a ray that hits an object
+ * always hits all boxes containing it. Unused lanes hold NaN boxes, which are never hit.
+ * minX...maxZ: Bounding boxes of the children, one lane per child.
+ * children:    Index of the child node, a leaf with WIDE_BVH_LEAF_FLAG set, or WIDE_BVH_EMPTY_CHILD if unused.
+ */
+template<int Width>
+struct alignas(64) WideBVHNode {
+    float minX[Width];
+    float minY[Width];
+    float minZ[Width];
+    float maxX[Width];
+    float maxY[Width];
+    float maxZ[Width];
+    uint32_t children[Width];
+};
+
+struct WideTraversalContainer {
+    uint32_t node;
+    float distance;
+};
+
+/**
+ * Node on the stack of a packet traversal.
+ * node:        Index of the node.
+ * distance:    Lower bound of the entry distance of all rays of the packet.
+ * rays:        Mask of the rays of the packet that hit the node.
+ */
+struct WidePacketContainer {
+    uint32_t node;
+    float distance;
+    uint64_t rays;
+};
+
+/**
+ * Ray prepared for the single precision slab test.
+ */
+struct FloatRay {
+    float origin[3];
+    float dirfrac[3];
+};
+
+/**
+ * Rays traced together. Every ray has the same direction sign on every axis, so that the near and the far plane of a
+ * box are the same for all of them and the bounds below give a conservative slab test for the whole packet.
+ * rays:            The rays, only the ones in the mask of the traversal are used.
+ * originMin:       Component wise minimum of the origins, as well as originMax.
+ * dirfracMin:      Component wise minimum of the inverse directions, as well as dirfracMax.
+ * negative:        True for every axis along which the directions are negative.
+ */
+struct FloatPacket {
+    FloatRay rays[WIDE_BVH_PACKET_SIZE];
+    float originMin[3];
+    float originMax[3];
+    float dirfracMin[3];
+    float dirfracMax[3];
+    bool negative[3];
+};
+
+/**
+ * @return  True if the CPU supports AVX2, in which case 8 wide trees are used.
+ */
+static inline bool supportsAVX2() {
+#ifdef WIDE_BVH_AVX2
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+#else
+    return false;
+#endif
+}
+
+static inline FloatRay toFloatRay(Ray *ray) {
+    return {{(float) ray->origin.x, (float) ray->origin.y, (float) ray->origin.z},
+            {(float) ray->dirfrac.x, (float) ray->dirfrac.y, (float) ray->dirfrac.z}};
+}
+
+/**
+ * @return  Index of the lowest set bit of a non zero mask.
+ */
+static inline uint32_t lowestBit(uint64_t mask) {
+#if defined(__GNUC__)
+    return (uint32_t) __builtin_ctzll(mask);
+#else
+    uint32_t bit = 0;
+    while ((mask & 1) == 0) {
+        mask >>= 1;
+        bit++;
+    }
+    return bit;
+#endif
+}
+
+/**
+ * @return  Number of set bits of a mask.
+ */
+static inline uint32_t bitCount(uint64_t mask) {
+#if defined(__GNUC__)
+    return (uint32_t) __builtin_popcountll(mask);
+#else
+    uint32_t count = 0;
+    for (; mask != 0; mask &= mask - 1) {
+        count++;
+    }
+    return count;
+#endif
+}
+
+/**
+ * Splits rays into packets of rays with the same direction signs.
+ * @param rays      The rays, at most WIDE_BVH_PACKET_SIZE.
+ * @param rayMask   Mask of the rays to split.
+ * @param packets   Receives one mask per octant of directions, rays that can only be traced one by one are in none.
+ * @return          Mask of the rays that can only be traced one by one, since their origin or inverse direction is not
+ *                  finite.
+ */
+static inline uint64_t splitPacket(Ray *rays, uint64_t rayMask, uint64_t *packets) {
+    uint64_t incoherent = 0;
+    for (int i = 0; i < 8; i++) {
+        packets[i] = 0;
+    }
+    while (rayMask != 0) {
+        uint32_t i = lowestBit(rayMask);
+        rayMask &= rayMask - 1;
+        FloatRay floatRay = toFloatRay(&rays[i]);
+        bool finite = true;
+        for (int axis = 0; axis < 3; axis++) {
+            finite &= std::isfinite(floatRay.origin[axis]) && std::isfinite(floatRay.dirfrac[axis]) &&
+                      floatRay.dirfrac[axis] != 0;
+        }
+        if (!finite) {
+            incoherent |= 1ull << i;
+            continue;
+        }
+        int octant = (floatRay.dirfrac[0] < 0 ? 1 : 0) | (floatRay.dirfrac[1] < 0 ? 2 : 0) |
+                     (floatRay.dirfrac[2] < 0 ? 4 : 0);
+        packets[octant] |= 1ull << i;
+    }
+    return incoherent;
+}
+
+/**
+ * Prepares rays of the same octant for the packet slab test.
+ * @param packet    Receives the rays and their bounds.
+ * @param rays      The rays, at most WIDE_BVH_PACKET_SIZE.
+ * @param rayMask   Mask of the rays of the packet, all of them have finite inverse directions with the same signs.
+ */
+static inline void toFloatPacket(FloatPacket *packet, Ray *rays, uint64_t rayMask) {
+    for (int axis = 0; axis < 3; axis++) {
+        packet->originMin[axis] = std::numeric_limits<float>::infinity();
+        packet->originMax[axis] = -std::numeric_limits<float>::infinity();
+        packet->dirfracMin[axis] = std::numeric_limits<float>::infinity();
+        packet->dirfracMax[axis] = -std::numeric_limits<float>::infinity();
+    }
+    while (rayMask != 0) {
+        uint32_t i = lowestBit(rayMask);
+        rayMask &= rayMask - 1;
+        FloatRay *floatRay = &packet->rays[i];
+        *floatRay = toFloatRay(&rays[i]);
+        for (int axis = 0; axis < 3; axis++) {
+            packet->originMin[axis] = std::min(packet->originMin[axis], floatRay->origin[axis]);
+            packet->originMax[axis] = std::max(packet->originMax[axis], floatRay->origin[axis]);
+            packet->dirfracMin[axis] = std::min(packet->dirfracMin[axis], floatRay->dirfrac[axis]);
+            packet->dirfracMax[axis] = std::max(packet->dirfracMax[axis], floatRay->dirfrac[axis]);
+        }
+    }
+    for (int axis = 0; axis < 3; axis++) {
+        packet->negative[axis] = packet->dirfracMax[axis] < 0;
+    }
+}
+
+static inline float roundDown(double value, double padding) {
+    double padded = value - padding;
+    auto result = (float) padded;
+    if ((double) result > padded) result = std::nextafter(result, -std::numeric_limits<float>::infinity());
+    return result;
+}
+
+static inline float roundUp(double value, double padding) {
+    double padded = value + padding;
+    auto result = (float) padded;
+    if ((double) result < padded) result = std::nextafter(result, std::numeric_limits<float>::infinity());
+    return result;
+}
+
+/**
+ * Marks all lanes of a node as unused.
+ */
+template<int Width>
+static inline void clearNode(WideBVHNode<Width> *node) {
+    float nan = std::numeric_limits<float>::quiet_NaN();
+    for (int i = 0; i < Width; i++) {
+        node->minX[i] = nan;
+        node->minY[i] = nan;
+        node->minZ[i] = nan;
+        node->maxX[i] = nan;
+        node->maxY[i] = nan;
+        node->maxZ[i] = nan;
+        node->children[i] = WIDE_BVH_EMPTY_CHILD;
+    }
+}
+
+/**
+ * Stores the conservatively rounded box of a child.
+ */
+template<int Width>
+static inline void setChildBox(WideBVHNode<Width> *node, int lane, const BoundingBox &box) {
+    double extent = std::max(std::max(box.maxCorner.x - box.minCorner.x, box.maxCorner.y - box.minCorner.y),
+                             box.maxCorner.z - box.minCorner.z);
+
+    node->minX[lane] = roundDown(box.minCorner.x, (std::abs(box.minCorner.x) + extent) * WIDE_BVH_BOX_PADDING);
+    node->minY[lane] = roundDown(box.minCorner.y, (std::abs(box.minCorner.y) + extent) * WIDE_BVH_BOX_PADDING);
+    node->minZ[lane] = roundDown(box.minCorner.z, (std::abs(box.minCorner.z) + extent) * WIDE_BVH_BOX_PADDING);
+    node->maxX[lane] = roundUp(box.maxCorner.x, (std::abs(box.maxCorner.x) + extent) * WIDE_BVH_BOX_PADDING);
+    node->maxY[lane] = roundUp(box.maxCorner.y, (std::abs(box.maxCorner.y) + extent) * WIDE_BVH_BOX_PADDING);
+    node->maxZ[lane] = roundUp(box.maxCorner.z, (std::abs(box.maxCorner.z) + extent) * WIDE_BVH_BOX_PADDING);
+}
+
+template<int Width>
+static inline uint32_t intersectBoxesScalar(const WideBVHNode<Width> *node, const FloatRay *ray, float *distances) {
+    uint32_t mask = 0;
+    for (int i = 0; i < Width; i++) {
+        float t1 = (node->minX[i] - ray->origin[0]) * ray->dirfrac[0];
+        float t2 = (node->maxX[i] - ray->origin[0]) * ray->dirfrac[0];
+        float t3 = (node->minY[i] - ray->origin[1]) * ray->dirfrac[1];
+        float t4 = (node->maxY[i] - ray->origin[1]) * ray->dirfrac[1];
+        float t5 = (node->minZ[i] - ray->origin[2]) * ray->dirfrac[2];
+        float t6 = (node->maxZ[i] - ray->origin[2]) * ray->dirfrac[2];
+
+        float tmin = std::max(std::max(std::min(t1, t2), std::min(t3, t4)), std::min(t5, t6));
+        float tmax = std::min(std::min(std::max(t1, t2), std::max(t3, t4)), std::max(t5, t6));
+
+        distances[i] = tmin;
+        if (tmax >= 0 && tmin <= tmax) mask |= 1u << i;
+    }
+    return mask;
+}
+
+#ifdef WIDE_BVH_SSE
+
+static inline uint32_t intersectBoxesSSE(const WideBVHNode<4> *node, const FloatRay *ray, float *distances) {
+    __m128 originX = _mm_set1_ps(ray->origin[0]);
+    __m128 originY = _mm_set1_ps(ray->origin[1]);
+    __m128 originZ = _mm_set1_ps(ray->origin[2]);
+    __m128 dirfracX = _mm_set1_ps(ray->dirfrac[0]);
+    __m128 dirfracY = _mm_set1_ps(ray->dirfrac[1]);
+    __m128 dirfracZ = _mm_set1_ps(ray->dirfrac[2]);
+
+    __m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node->minX), originX), dirfracX);
+    __m128 t2 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node->maxX), originX), dirfracX);
+    __m128 t3 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node->minY), originY), dirfracY);
+    __m128 t4 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node->maxY), originY), dirfracY);
+    __m128 t5 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node->minZ), originZ), dirfracZ);
+    __m128 t6 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node->maxZ), originZ), dirfracZ);
+
+    __m128 tmin = _mm_max_ps(_mm_max_ps(_mm_min_ps(t1, t2), _mm_min_ps(t3, t4)), _mm_min_ps(t5, t6));
+    __m128 tmax = _mm_min_ps(_mm_min_ps(_mm_max_ps(t1, t2), _mm_max_ps(t3, t4)), _mm_max_ps(t5, t6));
+
+    __m128 hit = _mm_and_ps(_mm_cmpge_ps(tmax, _mm_setzero_ps()), _mm_cmple_ps(tmin, tmax));
+
+    _mm_storeu_ps(distances, tmin);
+    return (uint32_t) _mm_movemask_ps(hit);
+}
+
+#endif
+
+#ifdef WIDE_BVH_AVX2
+
+TARGET_AVX2
+static inline uint32_t intersectBoxesAVX2(const WideBVHNode<8> *node, const FloatRay *ray, float *distances) {
+    __m256 originX = _mm256_set1_ps(ray->origin[0]);
+    __m256 originY = _mm256_set1_ps(ray->origin[1]);
+    __m256 originZ = _mm256_set1_ps(ray->origin[2]);
+    __m256 dirfracX = _mm256_set1_ps(ray->dirfrac[0]);
+    __m256 dirfracY = _mm256_set1_ps(ray->dirfrac[1]);
+    __m256 dirfracZ = _mm256_set1_ps(ray->dirfrac[2]);
+
+    __m256 t1 = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(node->minX), originX), dirfracX);
+    __m256 t2 = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(node->maxX), originX), dirfracX);
+    __m256 t3 = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(node->minY), originY), dirfracY);
+    __m256 t4 = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(node->maxY), originY), dirfracY);
+    __m256 t5 = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(node->minZ), originZ), dirfracZ);
+    __m256 t6 = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(node->maxZ), originZ), dirfracZ);
+
+    __m256 tmin = _mm256_max_ps(_mm256_max_ps(_mm256_min_ps(t1, t2), _mm256_min_ps(t3, t4)), _mm256_min_ps(t5, t6));
+    __m256 tmax = _mm256_min_ps(_mm256_min_ps(_mm256_max_ps(t1, t2), _mm256_max_ps(t3, t4)), _mm256_max_ps(t5, t6));
+
+    __m256 hit = _mm256_and_ps(_mm256_cmp_ps(tmax, _mm256_setzero_ps(), _CMP_GE_OQ),
+                               _mm256_cmp_ps(tmin, tmax, _CMP_LE_OQ));
+
+    _mm256_storeu_ps(distances, tmin);
+    return (uint32_t) _mm256_movemask_ps(hit);
+}
+
+#endif
+
+/**
+ * Tests a ray against all child boxes of a node.
+ * @param node      The node.
+ * @param ray       The ray.
+ * @param distances Receives the entry distance of the ray for every child.
+ * @return          Bit mask of the children that were hit.
+ */
+static inline uint32_t intersectBoxes(const WideBVHNode<4> *node, const FloatRay *ray, float *distances) {
+#ifdef WIDE_BVH_SSE
+    return intersectBoxesSSE(node, ray, distances);
+#else
+    return intersectBoxesScalar<4>(node, ray, distances);
+#endif
+}
+
+static inline uint32_t intersectBoxes(const WideBVHNode<8> *node, const FloatRay *ray, float *distances) {
+#ifdef WIDE_BVH_AVX2
+    // 8 wide trees are only built on CPUs supporting AVX2
+    return intersectBoxesAVX2(node, ray, distances);
+#else
+    return intersectBoxesScalar<8>(node, ray, distances);
+#endif
+}
+
+/**
+ * Closest hit traversal. The leaf intersector provides
+ * getClosest():                    distance of the closest hit so far, bounds the search,
+ * intersectFirst(leaf, distance):  intersects a leaf entered at the given distance, returns true on a closer hit.
+ */
+template<int Width, class LeafIntersector>
+static inline bool traverseFirst(const WideBVHNode<Width> *nodes, WideTraversalContainer *stack, Ray *ray,
+                                 LeafIntersector &leafIntersector) {
+    bool hit = false;
+    FloatRay floatRay = toFloatRay(ray);
+
+    uint64_t stackPointer = 1;
+    stack[0] = {0, 0};
+
+    while (stackPointer != 0) {
+        stackPointer--;
+        if (stack[stackPointer].distance >= leafIntersector.getClosest()) continue;
+        const WideBVHNode<Width> *node = &nodes[stack[stackPointer].node];
+
+        float distances[Width];
+        uint32_t mask = intersectBoxes(node, &floatRay, distances);
+
+        WideTraversalContainer children[Width];
+        int childCount = 0;
+
+        for (int i = 0; i < Width; i++) {
+            if ((mask & (1u << i)) == 0) continue;
+            uint32_t child = node->children[i];
+            if (child & WIDE_BVH_LEAF_FLAG) {
+                if (distances[i] < leafIntersector.getClosest()) {
+                    hit |= leafIntersector.intersectFirst(child & ~WIDE_BVH_LEAF_FLAG, distances[i]);
+                }
+            } else {
+                // insertion sort, farthest first, so that the closest child ends up on top of the stack
+                int j = childCount++;
+                while (j > 0 && children[j - 1].distance < distances[i]) {
+                    children[j] = children[j - 1];
+                    j--;
+                }
+                children[j] = {child, distances[i]};
+            }
+        }
+
+        for (int i = 0; i < childCount; i++) {
+            stack[stackPointer++] = children[i];
+        }
+    }
+
+    return hit;
+}
+
+/**
+ * Any hit traversal. The leaf intersector provides
+ * intersectAny(leaf):  intersects a leaf, returns true if anything was hit, which ends the traversal.
+ */
+template<int Width, class LeafIntersector>
+static inline bool traverseAny(const WideBVHNode<Width> *nodes, uint32_t *stack, Ray *ray,
+                               LeafIntersector &leafIntersector) {
+    FloatRay floatRay = toFloatRay(ray);
+
+    uint64_t stackPointer = 1;
+    stack[0] = 0;
+
+    while (stackPointer != 0) {
+        const WideBVHNode<Width> *node = &nodes[stack[--stackPointer]];
+
+        float distances[Width];
+        uint32_t mask = intersectBoxes(node, &floatRay, distances);
+
+        for (int i = 0; i < Width; i++) {
+            if ((mask & (1u << i)) == 0) continue;
+            uint32_t child = node->children[i];
+            if (child & WIDE_BVH_LEAF_FLAG) {
+                if (leafIntersector.intersectAny(child & ~WIDE_BVH_LEAF_FLAG)) return true;
+            } else {
+                stack[stackPointer++] = child;
+            }
+        }
+    }
+
+    return false;
+}
+
+/**
+ * Traversal visiting every leaf that is hit. The leaf intersector provides
+ * intersectAll(leaf):  intersects a leaf, returns true if anything was hit.
+ */
+template<int Width, class LeafIntersector>
+static inline bool traverseAll(const WideBVHNode<Width> *nodes, uint32_t *stack, Ray *ray,
+                               LeafIntersector &leafIntersector) {
+    bool hit = false;
+    FloatRay floatRay = toFloatRay(ray);
+
+    uint64_t stackPointer = 1;
+    stack[0] = 0;
+
+    while (stackPointer != 0) {
+        const WideBVHNode<Width> *node = &nodes[stack[--stackPointer]];
+
+        float distances[Width];
+        uint32_t mask = intersectBoxes(node, &floatRay, distances);
+
+        for (int i = 0; i < Width; i++) {
+            if ((mask & (1u << i)) == 0) continue;
+            uint32_t child = node->children[i];
+            if (child & WIDE_BVH_LEAF_FLAG) {
+                hit |= leafIntersector.intersectAll(child & ~WIDE_BVH_LEAF_FLAG);
+            } else {
+                stack[stackPointer++] = child;
+            }
+        }
+    }
+
+    return hit;
+}
+
+/**
+ * Conservative slab test of a whole packet against all child boxes of a node, computed with interval arithmetic over
+ * the bounds of the packet. Every child hit by a ray of the packet is in the returned mask, every child in the covered
+ * mask is hit by all rays of the packet. Rounding is monotonic, so this also holds for the single precision results of
+ * intersectBoxes.
+ * @param node      The node.
+ * @param packet    The packet.
+ * @param distances Receives a lower bound of the entry distances of the rays for every child.
+ * @param covered   Receives the mask of the children that are hit by all rays of the packet.
+ * @return          Bit mask of the children that may be hit by a ray of the packet.
+ */
+template<int Width>
+static inline uint32_t intersectBoxesPacket(const WideBVHNode<Width> *node, const FloatPacket *packet,
+                                            float *distances, uint32_t *covered) {
+    const float *minPlanes[3] = {node->minX, node->minY, node->minZ};
+    const float *maxPlanes[3] = {node->maxX, node->maxY, node->maxZ};
+
+    // lower and upper bounds of the entry and exit distances of the rays
+    float entryMin[Width];
+    float entryMax[Width];
+    float exitMin[Width];
+    float exitMax[Width];
+    for (int i = 0; i < Width; i++) {
+        entryMin[i] = -std::numeric_limits<float>::infinity();
+        entryMax[i] = -std::numeric_limits<float>::infinity();
+        exitMin[i] = std::numeric_limits<float>::infinity();
+        exitMax[i] = std::numeric_limits<float>::infinity();
+    }
+
+    for (int axis = 0; axis < 3; axis++) {
+        // the signs of the directions are the same for all rays, and so are the near and the far planes
+        const float *nearPlanes = packet->negative[axis] ? maxPlanes[axis] : minPlanes[axis];
+        const float *farPlanes = packet->negative[axis] ? minPlanes[axis] : maxPlanes[axis];
+        float originMin = packet->originMin[axis];
+        float originMax = packet->originMax[axis];
+        float dirfracMin = packet->dirfracMin[axis];
+        float dirfracMax = packet->dirfracMax[axis];
+
+        for (int i = 0; i < Width; i++) {
+            float near1 = (nearPlanes[i] - originMin) * dirfracMin;
+            float near2 = (nearPlanes[i] - originMin) * dirfracMax;
+            float near3 = (nearPlanes[i] - originMax) * dirfracMin;
+            float near4 = (nearPlanes[i] - originMax) * dirfracMax;
+            float far1 = (farPlanes[i] - originMin) * dirfracMin;
+            float far2 = (farPlanes[i] - originMin) * dirfracMax;
+            float far3 = (farPlanes[i] - originMax) * dirfracMin;
+            float far4 = (farPlanes[i] - originMax) * dirfracMax;
+
+            entryMin[i] = std::max(entryMin[i], std::min(std::min(near1, near2), std::min(near3, near4)));
+            entryMax[i] = std::max(entryMax[i], std::max(std::max(near1, near2), std::max(near3, near4)));
+            exitMin[i] = std::min(exitMin[i], std::min(std::min(far1, far2), std::min(far3, far4)));
+            exitMax[i] = std::min(exitMax[i], std::max(std::max(far1, far2), std::max(far3, far4)));
+        }
+    }
+
+    uint32_t mask = 0;
+    *covered = 0;
+    for (int i = 0; i < Width; i++) {
+        distances[i] = entryMin[i];
+        // unused lanes hold NaN boxes, which may survive the comparisons above
+        if (node->children[i] == WIDE_BVH_EMPTY_CHILD) continue;
+        if (exitMax[i] >= 0 && entryMin[i] <= exitMax[i]) mask |= 1u << i;
+        if (exitMin[i] >= 0 && entryMax[i] <= exitMin[i]) *covered |= 1u << i;
+    }
+    return mask;
+}
+
+/**
+ * Tests the rays of a packet one by one against the child boxes of a node that are only partially hit by the packet.
+ * @param node          The node.
+ * @param packet        The packet.
+ * @param rayMask       Mask of the rays to test.
+ * @param packetMask    Mask of the children to test.
+ * @param leafIntersector   Provides the closest hit of every ray if Closest is set, children behind it are skipped.
+ * @param childRays     Receives the mask of the rays that hit every child.
+ * @param distances     Receives the smallest entry distance of these rays for every child.
+ */
+template<bool Closest, int Width, class LeafIntersector>
+static inline void intersectBoxesRays(const WideBVHNode<Width> *node, const FloatPacket *packet, uint64_t rayMask,
+                                      uint32_t packetMask, LeafIntersector &leafIntersector, uint64_t *childRays,
+                                      float *distances) {
+    for (int i = 0; i < Width; i++) {
+        childRays[i] = 0;
+        distances[i] = std::numeric_limits<float>::infinity();
+    }
+    if (packetMask == 0) return;
+
+    while (rayMask != 0) {
+        uint32_t ray = lowestBit(rayMask);
+        rayMask &= rayMask - 1;
+
+        float rayDistances[Width];
+        uint32_t mask = intersectBoxes(node, &packet->rays[ray], rayDistances) & packetMask;
+        double closest = Closest ? leafIntersector.getClosest(ray) : std::numeric_limits<double>::infinity();
+        while (mask != 0) {
+            uint32_t i = lowestBit(mask);
+            mask &= mask - 1;
+            if (rayDistances[i] < closest) {
+                childRays[i] |= 1ull << ray;
+                distances[i] = std::min(distances[i], rayDistances[i]);
+            }
+        }
+    }
+}
+
+/**
+ * Closest hit traversal of a packet. All rays of the packet share one stack and visit the nodes in the same order. A
+ * node is skipped for the whole packet if the packet slab test misses it, otherwise the rays are tested one by one, so
+ * that every child is only entered by the rays that hit it. The stack has the same size as the one of traverseFirst.
+ * The leaf intersector provides
+ * getClosest(ray):             distance of the closest hit of a ray so far, bounds its search,
+ * intersectFirst(leaf, rays):  intersects a leaf with the rays of a mask, returns the rays that found a closer hit.
+ * @return  Mask of the rays that found a closer hit.
+ */
+template<int Width, class LeafIntersector>
+static inline uint64_t traversePacketFirst(const WideBVHNode<Width> *nodes, WidePacketContainer *stack,
+                                           const FloatPacket *packet, uint64_t rayMask,
+                                           LeafIntersector &leafIntersector) {
+    uint64_t hit = 0;
+
+    uint64_t stackPointer = 1;
+    stack[0] = {0, -std::numeric_limits<float>::infinity(), rayMask};
+
+    while (stackPointer != 0) {
+        WidePacketContainer container = stack[--stackPointer];
+
+        // rays that found a hit in front of the node leave the packet
+        uint64_t rays = 0;
+        for (uint64_t remaining = container.rays; remaining != 0; remaining &= remaining - 1) {
+            uint32_t ray = lowestBit(remaining);
+            if (container.distance < leafIntersector.getClosest(ray)) rays |= 1ull << ray;
+        }
+        if (rays == 0) continue;
+
+        const WideBVHNode<Width> *node = &nodes[container.node];
+
+        float bounds[Width];
+        uint32_t covered;
+        uint32_t packetMask = intersectBoxesPacket(node, packet, bounds, &covered);
+        if (packetMask == 0) continue;
+
+        // only children that are partially hit need the rays to be tested one by one
+        uint64_t childRays[Width];
+        float distances[Width];
+        intersectBoxesRays<true>(node, packet, rays, packetMask & ~covered, leafIntersector, childRays, distances);
+        for (uint32_t mask = covered; mask != 0; mask &= mask - 1) {
+            uint32_t i = lowestBit(mask);
+            childRays[i] = rays;
+            distances[i] = bounds[i];
+        }
+
+        WidePacketContainer children[Width];
+        int childCount = 0;
+
+        for (int i = 0; i < Width; i++) {
+            if (childRays[i] == 0) continue;
+            uint32_t child = node->children[i];
+            if (child & WIDE_BVH_LEAF_FLAG) {
+                hit |= leafIntersector.intersectFirst(child & ~WIDE_BVH_LEAF_FLAG, childRays[i]);
+            } else {
+                // insertion sort, farthest first, so that the closest child ends up on top of the stack
+                int j = childCount++;
+                while (j > 0 && children[j - 1].distance < distances[i]) {
+                    children[j] = children[j - 1];
+                    j--;
+                }
+                children[j] = {child, distances[i], childRays[i]};
+            }
+        }
+
+        for (int i = 0; i < childCount; i++) {
+            stack[stackPointer++] = children[i];
+        }
+    }
+
+    return hit;
+}
+
+/**
+ * Any hit traversal of a packet, rays leave the packet as soon as they hit anything. The leaf intersector provides
+ * intersectAny(leaf, rays):    intersects a leaf with the rays of a mask, returns the mask of the rays that hit it.
+ * @return  Mask of the rays that hit anything.
+ */
+template<int Width, class LeafIntersector>
+static inline uint64_t traversePacketAny(const WideBVHNode<Width> *nodes, WidePacketContainer *stack,
+                                         const FloatPacket *packet, uint64_t rayMask,
+                                         LeafIntersector &leafIntersector) {
+    uint64_t hit = 0;
+
+    uint64_t stackPointer = 1;
+    stack[0] = {0, 0, rayMask};
+
+    while (stackPointer != 0) {
+        WidePacketContainer container = stack[--stackPointer];
+        uint64_t rays = container.rays & ~hit;
+        if (rays == 0) continue;
+        const WideBVHNode<Width> *node = &nodes[container.node];
+
+        float bounds[Width];
+        uint32_t covered;
+        uint32_t packetMask = intersectBoxesPacket(node, packet, bounds, &covered);
+        if (packetMask == 0) continue;
+
+        uint64_t childRays[Width];
+        float distances[Width];
+        intersectBoxesRays<false>(node, packet, rays, packetMask & ~covered, leafIntersector, childRays, distances);
+        for (uint32_t mask = covered; mask != 0; mask &= mask - 1) {
+            childRays[lowestBit(mask)] = rays;
+        }
+
+        for (int i = 0; i < Width; i++) {
+            if (childRays[i] == 0) continue;
+            uint32_t child = node->children[i];
+            if (child & WIDE_BVH_LEAF_FLAG) {
+                uint64_t leafRays = childRays[i] & ~hit;
+                if (leafRays == 0) continue;
+                hit |= leafIntersector.intersectAny(child & ~WIDE_BVH_LEAF_FLAG, leafRays);
+                if (hit == rayMask) return hit;
+            } else {
+                stack[stackPointer++] = {child, distances[i], childRays[i]};
+            }
+        }
+    }
+
+    return hit;
+}
+
+/**
+ * Traces rays in packets of rays with the same direction signs. Packets with fewer than WIDE_BVH_MIN_PACKET_RAYS rays
+ * and rays whose inverse direction is not finite are traced one by one.
+ * @param rays          The rays, at most WIDE_BVH_PACKET_SIZE.
+ * @param rayMask       Mask of the rays to trace.
+ * @param packet        Storage for the packets.
+ * @param tracePacket   Called with the packet and the mask of its rays, returns the mask of the rays that hit.
+ * @param traceRay      Called with the index of a single ray, returns true if it hit.
+ * @return              Mask of the rays that hit.
+ */
+template<class PacketTracer, class RayTracer>
+static inline uint64_t tracePackets(Ray *rays, uint64_t rayMask, FloatPacket *packet, PacketTracer tracePacket,
+                                    RayTracer traceRay) {
+    uint64_t packets[8];
+    uint64_t single = splitPacket(rays, rayMask, packets);
+
+    uint64_t hit = 0;
+    for (uint64_t packetMask: packets) {
+        if (packetMask == 0) continue;
+        if (bitCount(packetMask) < WIDE_BVH_MIN_PACKET_RAYS) {
+            single |= packetMask;
+            continue;
+        }
+        toFloatPacket(packet, rays, packetMask);
+        hit |= tracePacket(packet, packetMask);
+    }
+
+    for (; single != 0; single &= single - 1) {
+        uint32_t i = lowestBit(single);
+        if (traceRay(i)) hit |= 1ull << i;
+    }
+    return hit;
+}
+
+#endif //RAYTRACEENGINE_WIDEBVH_H
@@ -2,6 +2,8 @@
 // Created by Sebastian on 04.12.2021.
 //
 
+#include <algorithm>
+
 #include "DataManagementUnitV2.h"
 #include "Engine Node/EngineNode.h"
 #include "Pipeline/PipelineImplement.h"
@@ -9,6 +11,25 @@
 #include "RayTraceEngine/Pipeline.h"
 #include "Acceleration Structures/DBVHv2.h"
 #include "RayTraceEngine/Shader.h"
+#include "Utils/ThreadPool/TaskScheduler.h"
+
+// number of instances transformed by a single task
+static const uint64_t TRANSFORM_CHUNK_SIZE = 256;
+
+// share of changed instances from which on a transaction rebuilds the tree instead of inserting and refitting
+static const double TRANSACTION_REBUILD_SHARE = 0.5;
+
+static void applyTransforms(TaskScheduler *taskScheduler, std::vector<Instance *> *instances,
+                            std::vector<Matrix4x4 *> *transforms) {
+    // instances are independent of each other, transforms are applied in chunks to amortize the task overhead
+    uint64_t chunkCount = (instances->size() + TRANSFORM_CHUNK_SIZE - 1) / TRANSFORM_CHUNK_SIZE;
+    taskScheduler->parallelFor(chunkCount, [&](uint64_t chunk, unsigned int workerId) {
+        uint64_t end = std::min((chunk + 1) * TRANSFORM_CHUNK_SIZE, (uint64_t) instances->size());
+        for (uint64_t i = chunk * TRANSFORM_CHUNK_SIZE; i < end; i++) {
+            (*instances)[i]->applyTransform((*transforms)[i]);
+        }
+    });
+}
 
 DataManagementUnitV2::DataManagementUnitV2() {
     deviceId = getDeviceId();
@@ -74,7 +95,11 @@ PipelineId DataManagementUnitV2::createPipeline(PipelineDescription *pipelineDes
 
     // build bvh on instances
     auto *root = new DBVHNode();
-    DBVHv2::addObjects(root, &instances);
+    std::vector<DBVHLeaf *> leaves;
+    DBVHv2::addObjects(root, &instances, &leaves, engineNode->getTaskScheduler());
+    for (uint64_t i = 0; i < leaves.size(); i++) {
+        instanceLeafMap[instanceIds[i]] = leaves[i];
+    }
 
     // get shader implementation from id
     std::vector<RayGeneratorShaderPackage> pipelineRayGeneratorShaders;
@@ -155,6 +180,11 @@ PipelineId DataManagementUnitV2::createPipeline(PipelineDescription *pipelineDes
                                            &pipelineDescription->cameraUp, &pipelineRayGeneratorShaders,
                                            &pipelineOcclusionShaders, &pipelineHitShaders,
                                            &pipelinePierceShaders, &pipelineMissShaders, root);
+    pipeline->setMode(pipelineDescription->mode);
+    pipeline->setSampling(pipelineDescription->samplesPerRun, pipelineDescription->accumulate);
+    pipeline->setPriority(pipelineDescription->priority);
+    pipeline->setTargetFrameTime(pipelineDescription->targetFrameTime);
+    pipeline->setRayPayload(pipelineDescription->rayPayloadSize, pipelineDescription->rayPayloadAlignment);
 
     auto pipelineId = pipelineIds.extract(pipelineIds.begin()).value();
 
@@ -177,8 +207,14 @@ bool DataManagementUnitV2::removePipeline(PipelineId id) {
     // TODO: broadcast remove to all nodes;
     auto removed = engineNode->deletePipelineFragment(id);
     if (removed) {
-        for (auto instance: pipelineToInstanceMap.at(id)) {
-            removePipelineObject(id, instance);
+        pipelineTransactions.erase(id);
+        auto pipelineInstances = pipelineToInstanceMap.find(id);
+        if (pipelineInstances != pipelineToInstanceMap.end()) {
+            for (auto instance: pipelineInstances->second) {
+                removeInstance(id, instance);
+            }
+            // a reused pipeline id starts without instances
+            pipelineToInstanceMap.erase(pipelineInstances);
         }
 
         pipelineIds.insert(id);
@@ -203,12 +239,43 @@ DataManagementUnitV2::updatePipelineObjects(PipelineId pipelineId, std::vector<I
                                             std::vector<ObjectParameter *> *objectParameters) {
     if (objectInstanceIDs->size() != transforms->size()) return false;
 
+    auto transaction = pipelineTransactions.find(pipelineId);
+    if (transaction != pipelineTransactions.end()) {
+        // the instances keep their current transform until the commit, so that they stay within their boxes
+        auto &changes = transaction->second;
+        for (uint64_t i = 0; i < objectInstanceIDs->size(); i++) {
+            if (!isPipelineInstance(pipelineId, objectInstanceIDs->at(i))) continue;
+            auto index = changes.updateIndices.find(objectInstanceIDs->at(i));
+            if (index == changes.updateIndices.end()) {
+                changes.updateIndices[objectInstanceIDs->at(i)] = changes.updatedInstances.size();
+                changes.updatedInstances.push_back(objectInstanceIDs->at(i));
+                changes.transforms.push_back(*transforms->at(i));
+            } else {
+                changes.transforms[index->second].multiplyBy(transforms->at(i));
+            }
+        }
+        return true;
+    }
+
+    // waits for a running asynchronous execution, which may still trace the instances that are moved here
+    auto pipeline = engineNode->requestPipelineFragment(pipelineId);
+
+    std::vector<Instance *> instances;
+    std::vector<DBVHLeaf *> leaves;
+    std::vector<Matrix4x4 *> instanceTransforms;
+
     for (int i = 0; i < objectInstanceIDs->size(); i++) {
-        if (objectInstanceIds.count(objectInstanceIDs->at(i)) == 1) {
+        if (objectInstanceIdDeviceMap.count(objectInstanceIDs->at(i)) == 1) {
             if (objectInstanceIdDeviceMap[objectInstanceIDs->at(i)].deviceId == deviceId.deviceId) {
+                // only instances with a leaf in the tree of this pipeline are moved
+                if (!isPipelineInstance(pipelineId, objectInstanceIDs->at(i))) continue;
+                auto leaf = instanceLeafMap.find(objectInstanceIDs->at(i));
+                if (leaf == instanceLeafMap.end()) continue;
                 auto instance = engineNode->requestInstanceData(objectInstanceIDs->at(i));
                 if (instance == nullptr) continue;
-                instance->applyTransform(transforms->at(i));
+                instances.push_back(instance);
+                leaves.push_back(leaf->second);
+                instanceTransforms.push_back(transforms->at(i));
             } else {
                 // TODO: update instances on other nodes
             }
@@ -217,6 +284,14 @@ DataManagementUnitV2::updatePipelineObjects(PipelineId pipelineId, std::vector<I
         }
     }
 
+    applyTransforms(engineNode->getTaskScheduler(), &instances, &instanceTransforms);
+
+    // the instances keep their place in the tree, only the boxes above them have to grow or shrink
+    if (pipeline != nullptr) {
+        DBVHv2::refitObjects(pipeline->getGeometry(), &leaves, true);
+        pipeline->invalidateGeometry();
+    }
+
     return true;
 }
 
@@ -297,13 +372,120 @@ bool DataManagementUnitV2::updatePipelineShader(PipelineId pipelineId, MissShade
 }
 
 bool DataManagementUnitV2::removePipelineObject(PipelineId pipelineId, InstanceId objectInstanceId) {
+    auto transaction = pipelineTransactions.find(pipelineId);
+    if (transaction != pipelineTransactions.end()) {
+        if (!isPipelineInstance(pipelineId, objectInstanceId)) return false;
+        transaction->second.removedInstances.insert(objectInstanceId);
+        return true;
+    }
+
+    if (!isPipelineInstance(pipelineId, objectInstanceId)) return false;
+    auto removed = removeInstance(pipelineId, objectInstanceId);
+
+    // the leaf is unlinked even if the instance data could not be deleted, so the instance is no longer bound
+    pipelineToInstanceMap[pipelineId].erase(objectInstanceId);
+    return removed;
+}
+
+bool DataManagementUnitV2::beginPipelineTransaction(PipelineId pipelineId) {
+    if (engineNode->requestPipelineFragment(pipelineId) == nullptr) return false;
+    return pipelineTransactions.emplace(pipelineId, PipelineTransaction()).second;
+}
+
+bool DataManagementUnitV2::commitPipelineTransaction(PipelineId pipelineId) {
+    auto transaction = pipelineTransactions.find(pipelineId);
+    if (transaction == pipelineTransactions.end()) return false;
+
+    auto pipeline = engineNode->requestPipelineFragment(pipelineId);
+    auto &changes = transaction->second;
+
+    // instances removed right away in the meantime, e.g. together with their base object, are skipped
+    std::vector<InstanceId> removedIds;
+    std::vector<DBVHLeaf *> removedLeaves;
+    for (auto instanceId: changes.removedInstances) {
+        if (!isPipelineInstance(pipelineId, instanceId)) continue;
+        auto leaf = instanceLeafMap.find(instanceId);
+        if (leaf != instanceLeafMap.end()) {
+            removedLeaves.push_back(leaf->second);
+            instanceLeafMap.erase(leaf);
+        }
+        removedIds.push_back(instanceId);
+    }
+
+    std::vector<Instance *> updatedInstances;
+    std::vector<Matrix4x4 *> updatedTransforms;
+    std::vector<DBVHLeaf *> updatedLeaves;
+    for (uint64_t i = 0; i < changes.updatedInstances.size(); i++) {
+        auto instanceId = changes.updatedInstances[i];
+        if (changes.removedInstances.count(instanceId) != 0) continue;
+        auto instance = engineNode->requestInstanceData(instanceId);
+        if (instance == nullptr) continue;
+        updatedInstances.push_back(instance);
+        updatedTransforms.push_back(&changes.transforms[i]);
+
+        // instances added within the same transaction are not part of the tree yet
+        auto leaf = instanceLeafMap.find(instanceId);
+        if (leaf != instanceLeafMap.end()) updatedLeaves.push_back(leaf->second);
+    }
+
+    std::vector<Object *> addedInstances;
+    std::vector<InstanceId> addedIds;
+    for (auto instanceId: changes.addedInstances) {
+        if (changes.removedInstances.count(instanceId) != 0) continue;
+        auto instance = engineNode->requestInstanceData(instanceId);
+        if (instance == nullptr) continue;
+        addedInstances.push_back(instance);
+        addedIds.push_back(instanceId);
+    }
+
+    auto geometry = pipeline->getGeometry();
+    auto &pipelineInstances = pipelineToInstanceMap[pipelineId];
+    uint64_t changeCount = removedLeaves.size() + updatedLeaves.size() + addedInstances.size();
+    bool rebuild = (double) changeCount >= TRANSACTION_REBUILD_SHARE * (double) pipelineInstances.size();
+
+    // removals unlink their leaves through the handles in both cases, a rebuild then only sees the remaining objects
+    DBVHv2::removeObjects(geometry, &removedLeaves);
+    for (auto instanceId: removedIds) {
+        engineNode->deleteInstanceDataFragment(instanceId);
+        pipelineInstances.erase(instanceId);
+    }
+
+    applyTransforms(engineNode->getTaskScheduler(), &updatedInstances, &updatedTransforms);
+
+    std::vector<DBVHLeaf *> leaves;
+    if (rebuild) {
+        DBVHv2::rebuild(geometry, &addedInstances, &leaves, engineNode->getTaskScheduler());
+    } else {
+        DBVHv2::refitObjects(geometry, &updatedLeaves, true);
+        DBVHv2::addObjects(geometry, &addedInstances, &leaves, engineNode->getTaskScheduler());
+    }
+    for (uint64_t i = 0; i < leaves.size(); i++) {
+        instanceLeafMap[addedIds[i]] = leaves[i];
+    }
+    pipeline->invalidateGeometry();
+
+    pipelineTransactions.erase(transaction);
+
+    return true;
+}
+
+bool DataManagementUnitV2::removeInstance(PipelineId pipelineId, InstanceId objectInstanceId) {
+    // the handle of an instance bound to another pipeline points into another tree
+    if (!isPipelineInstance(pipelineId, objectInstanceId)) return false;
+
     if (objectInstanceIdDeviceMap.count(objectInstanceId) == 1) {
         if (objectInstanceIdDeviceMap[objectInstanceId].deviceId == deviceId.deviceId) {
             auto pipeline = engineNode->requestPipelineFragment(pipelineId);
-            auto geometry = pipeline->getGeometry();
-            auto instance = engineNode->requestInstanceData(objectInstanceId);
-            std::vector<Object *> remove = {instance};
-            DBVHv2::removeObjects(geometry, &remove);
+            auto leaf = instanceLeafMap.find(objectInstanceId);
+            if (leaf != instanceLeafMap.end()) {
+                // the handles of a removed pipeline were deleted together with its tree
+                if (pipeline != nullptr) {
+                    std::vector<DBVHLeaf *> remove = {leaf->second};
+                    DBVHv2::removeObjects(pipeline->getGeometry(), &remove);
+                    pipeline->invalidateGeometry();
+                }
+                instanceLeafMap.erase(leaf);
+            }
             return engineNode->deleteInstanceDataFragment(objectInstanceId);
         } else {
             // TODO: delete instance on other nodes
@@ -312,6 +494,12 @@ bool DataManagementUnitV2::removePipelineObject(PipelineId pipelineId, InstanceI
     return false;
 }
 
+bool DataManagementUnitV2::isPipelineInstance(PipelineId pipelineId, InstanceId objectInstanceId) {
+    auto pipelineInstances = pipelineToInstanceMap.find(pipelineId);
+    if (pipelineInstances == pipelineToInstanceMap.end()) return false;
+    return pipelineInstances->second.count(objectInstanceId) != 0;
+}
+
 bool DataManagementUnitV2::removePipelineShader(PipelineId pipelineId, RayGeneratorShaderId shaderInstanceId) {
     auto pipeline = engineNode->requestPipelineFragment(pipelineId);
 
@@ -369,7 +557,7 @@ DataManagementUnitV2::bindGeometryToPipeline(PipelineId pipelineId, std::vector<
         if (objectIdDeviceMap.count(objectIDs->at(i)) == 1) {
             if (objectIdDeviceMap[objectIDs->at(i)].deviceId == deviceId.deviceId) {
                 auto buffer = engineNode->requestBaseData(objectIDs->at(i))->getCapsule();
-                auto capsule = ObjectCapsule{ObjectId{i}, buffer.boundingBox, buffer.cost};
+                auto capsule = ObjectCapsule{objectIDs->at(i), buffer.boundingBox, buffer.cost};
 
                 // create instances of objects
                 auto *instance = new Instance(engineNode, &capsule);
@@ -401,7 +589,20 @@ DataManagementUnitV2::bindGeometryToPipeline(PipelineId pipelineId, std::vector<
 
     pipelineToInstanceMap[pipelineId].insert(instanceIds.begin(), instanceIds.end());
 
-    DBVHv2::addObjects(geometry, &instances);
+    // the tree is extended on commit, together with all other changes of the transaction
+    auto transaction = pipelineTransactions.find(pipelineId);
+    if (transaction != pipelineTransactions.end()) {
+        auto &addedInstances = transaction->second.addedInstances;
+        addedInstances.insert(addedInstances.end(), instanceIds.begin(), instanceIds.end());
+        return true;
+    }
+
+    std::vector<DBVHLeaf *> leaves;
+    DBVHv2::addObjects(geometry, &instances, &leaves, engineNode->getTaskScheduler());
+    for (uint64_t i = 0; i < leaves.size(); i++) {
+        instanceLeafMap[instanceIds[i]] = leaves[i];
+    }
+    pipeline->invalidateGeometry();
 
     return true;
 }
@@ -528,7 +729,7 @@ bool DataManagementUnitV2::removeObject(ObjectId id) {
     for (auto instanceId: objectToInstanceMap.at(id)) {
         for (auto &pipelineInstances: pipelineToInstanceMap) {
             if (pipelineInstances.second.count(instanceId) != 0) {
-                removePipelineObject(pipelineInstances.first, instanceId);
+                removeInstance(pipelineInstances.first, instanceId);
                 pipelineInstances.second.erase(instanceId);
                 break;
             }
@@ -741,11 +942,35 @@ int DataManagementUnitV2::runPipeline(PipelineId id) {
     return 0;
 }
 
+int DataManagementUnitV2::runPipeline(PipelineId id, double timeBudget, uint64_t targetSampleCount) {
+    return engineNode->runPipeline(id, timeBudget, targetSampleCount) ? 1 : 0;
+}
+
+PipelineExecutionHandle DataManagementUnitV2::runPipelineAsync(PipelineId id) {
+    return PipelineExecutionHandle{id, engineNode->runPipelineAsync(id)};
+}
+
+int DataManagementUnitV2::waitPipelineExecution(PipelineExecutionHandle handle) {
+    return engineNode->waitPipelineExecution(handle.pipelineId, handle.execution);
+}
+
+bool DataManagementUnitV2::isPipelineExecutionFinished(PipelineExecutionHandle handle) {
+    return engineNode->isPipelineExecutionFinished(handle.pipelineId, handle.execution);
+}
+
+void DataManagementUnitV2::cancelPipelineExecution(PipelineExecutionHandle handle) {
+    engineNode->cancelPipelineExecution(handle.pipelineId, handle.execution);
+}
+
 int DataManagementUnitV2::runAllPipelines() {
     engineNode->runPipelines();
     return 0;
 }
 
+void DataManagementUnitV2::setThreadCount(unsigned int threadCount) {
+    engineNode->setThreadCount(threadCount);
+}
+
 void
 DataManagementUnitV2::updatePipelineCamera(PipelineId id, int resolutionX, int resolutionY, Vector3D cameraPosition,
                                            Vector3D cameraDirection, Vector3D cameraUp) {
@@ -754,6 +979,36 @@ DataManagementUnitV2::updatePipelineCamera(PipelineId id, int resolutionX, int r
     pipeline->setCamera(cameraPosition, cameraDirection, cameraUp);
 }
 
+void DataManagementUnitV2::updatePipelineMode(PipelineId id, PipelineMode mode) {
+    auto pipeline = engineNode->requestPipelineFragment(id);
+    pipeline->setMode(mode);
+}
+
+void DataManagementUnitV2::updatePipelineSampling(PipelineId id, int samplesPerRun, bool accumulate) {
+    auto pipeline = engineNode->requestPipelineFragment(id);
+    pipeline->setSampling(samplesPerRun, accumulate);
+}
+
+void DataManagementUnitV2::updatePipelinePriority(PipelineId id, int priority) {
+    auto pipeline = engineNode->requestPipelineFragment(id);
+    pipeline->setPriority(priority);
+}
+
+void DataManagementUnitV2::updatePipelineFrameTime(PipelineId id, double targetFrameTime) {
+    auto pipeline = engineNode->requestPipelineFragment(id);
+    pipeline->setTargetFrameTime(targetFrameTime);
+}
+
+void DataManagementUnitV2::resetPipelineAccumulation(PipelineId id) {
+    auto pipeline = engineNode->requestPipelineFragment(id);
+    pipeline->resetAccumulation();
+}
+
+uint64_t DataManagementUnitV2::getPipelineSampleCount(PipelineId id) {
+    auto pipeline = engineNode->requestPipelineFragment(id);
+    return pipeline->getSampleCount();
+}
+
 Texture *DataManagementUnitV2::getPipelineResult(PipelineId id) {
     auto pipeline = engineNode->requestPipelineFragment(id);
     return pipeline->getResult();
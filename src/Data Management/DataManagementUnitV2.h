@@ -30,6 +30,7 @@ class Instance;
 class ShaderResource;
 
 struct DBVHNode;
+struct DBVHLeaf;
 struct PipelineDescription;
 struct Vector3D;
 struct Texture;
@@ -55,6 +56,22 @@ struct std::hash<DeviceId>{
     }
 };
 
+/**
+ * Instance changes of a pipeline gathered between the begin and the commit of a transaction.
+ * addedInstances:      Instances that are bound to the pipeline but not yet part of its tree.
+ * updatedInstances:    Instances with pending transforms, in the order of their first update.
+ * updateIndices:       Position of each updated instance in updatedInstances.
+ * transforms:          Pending transforms, composed when an instance is updated more than once.
+ * removedInstances:    Instances that are removed from the pipeline on commit.
+ */
+struct PipelineTransaction {
+    std::vector<InstanceId> addedInstances;
+    std::vector<InstanceId> updatedInstances;
+    std::unordered_map<InstanceId, uint64_t> updateIndices;
+    std::vector<Matrix4x4> transforms;
+    std::set<InstanceId> removedInstances;
+};
+
 class DataManagementUnitV2 {
 private:
     DeviceId deviceId;
@@ -81,8 +98,27 @@ private:
     std::unordered_map<InstanceId, DeviceId> objectInstanceIdDeviceMap;
     std::unordered_map<DBVHNode *, DeviceId> pipelineTreeDeviceMap;
 
+    // handles of the instances in the trees of their pipelines, instances are removed and refit without a tree search
+    std::unordered_map<InstanceId, DBVHLeaf *> instanceLeafMap;
+
+    // open transactions, instance changes of these pipelines are gathered until they are committed
+    std::unordered_map<PipelineId, PipelineTransaction> pipelineTransactions;
+
     DeviceId getDeviceId();
 
+    /*
+     * Removes a single object instance from the specified pipeline right away, regardless of open transactions.
+     * return:          true if success, false otherwise
+     */
+    bool removeInstance(PipelineId pipelineId, InstanceId objectInstanceId);
+
+    /*
+     * Checks whether the object instance is bound to the specified pipeline, only then its leaf handle belongs to the
+     * tree of that pipeline.
+     * return:          true if the instance is bound to the pipeline, false otherwise
+     */
+    bool isPipelineInstance(PipelineId pipelineId, InstanceId objectInstanceId);
+
 public:
     DataManagementUnitV2();
 
@@ -98,6 +134,18 @@ public:
     updatePipelineCamera(PipelineId id, int resolutionX, int resolutionY, Vector3D cameraPosition, Vector3D cameraDirection,
                          Vector3D cameraUp);
 
+    void updatePipelineMode(PipelineId id, PipelineMode mode);
+
+    void updatePipelineSampling(PipelineId id, int samplesPerRun, bool accumulate);
+
+    void updatePipelinePriority(PipelineId id, int priority);
+
+    void updatePipelineFrameTime(PipelineId id, double targetFrameTime);
+
+    void resetPipelineAccumulation(PipelineId id);
+
+    uint64_t getPipelineSampleCount(PipelineId id);
+
     Texture *getPipelineResult(PipelineId id);
 
     /*
@@ -168,6 +216,22 @@ public:
      */
     bool removePipelineObject(PipelineId pipelineId, InstanceId objectInstanceId);
 
+    /*
+     * Opens a transaction on a pipeline. Until it is committed, bound, updated and removed object instances are
+     * gathered instead of changing the pipelines tree one call at a time.
+     * pipelineId:      the pipeline the transaction is opened on
+     * return:          true if success, false if the pipeline does not exist or already has an open transaction
+     */
+    bool beginPipelineTransaction(PipelineId pipelineId);
+
+    /*
+     * Applies all changes gathered by the open transaction of a pipeline to its tree at once. Depending on the share
+     * of instances that changed, the tree is either updated incrementally or rebuilt from scratch.
+     * pipelineId:      the pipeline the transaction was opened on
+     * return:          true if success, false if the pipeline has no open transaction
+     */
+    bool commitPipelineTransaction(PipelineId pipelineId);
+
     /*
      * Removes a single shader instance from the specified pipeline.
      * pipelineId:      the pipeline the object instance is associated with
@@ -261,8 +325,20 @@ public:
 
     int runPipeline(PipelineId id);
 
+    int runPipeline(PipelineId id, double timeBudget, uint64_t targetSampleCount);
+
+    PipelineExecutionHandle runPipelineAsync(PipelineId id);
+
+    int waitPipelineExecution(PipelineExecutionHandle handle);
+
+    bool isPipelineExecutionFinished(PipelineExecutionHandle handle);
+
+    void cancelPipelineExecution(PipelineExecutionHandle handle);
+
     int runAllPipelines();
 
+    void setThreadCount(unsigned int threadCount);
+
     Object *getBaseDataFragment(ObjectId id);
 
     Instance *getInstanceDataFragment(InstanceId id);
@@ -8,6 +8,21 @@
 #include "Pipeline/PipelineImplement.h"
 #include "Object/Instance.h"
 #include "Acceleration Structures/DBVHv2.h"
+#include "Utils/ThreadPool/TaskScheduler.h"
+
+/**
+ * Asynchronous execution state of a pipeline, a pipeline is executed at most once at a time.
+ * taskGroup:   Group of the task running the current execution.
+ * execution:   Number of the current execution, counted from 1.
+ * cancelled:   Requests the current execution to stop at the next tile.
+ * status:      Status returned by the current execution once it is finished.
+ */
+struct PipelineExecution {
+    TaskGroup taskGroup;
+    uint64_t execution{0};
+    std::atomic_bool cancelled{false};
+    int status{0};
+};
 
 EngineNode::MemoryBlock::MemoryBlock() = default;
 
@@ -226,10 +241,11 @@ void EngineNode::PipelineBlock::runPipeline(PipelineId id) {
     }
 }
 
-void EngineNode::PipelineBlock::runPipelines() {
-    for (auto p: pipelines) {
-        p.second->run();
+bool EngineNode::PipelineBlock::runPipeline(PipelineId id, double timeBudget, uint64_t targetSampleCount) {
+    if (pipelines.count(id) == 1) {
+        return pipelines[id]->runProgressive(timeBudget, targetSampleCount);
     }
+    return false;
 }
 
 PipelineImplement *EngineNode::PipelineBlock::getPipelineFragment(PipelineId id) {
@@ -237,15 +253,29 @@ PipelineImplement *EngineNode::PipelineBlock::getPipelineFragment(PipelineId id)
     return pipelines[id];
 }
 
+std::vector<PipelineId> EngineNode::PipelineBlock::getPipelineIds() {
+    std::vector<PipelineId> ids;
+    for (auto &pipeline: pipelines) {
+        ids.push_back(pipeline.first);
+    }
+    return ids;
+}
+
 EngineNode::EngineNode(DataManagementUnitV2 *DMU) {
     dataManagementUnit = DMU;
     memoryBlock = new MemoryBlock();
     pipelineBlock = new PipelineBlock();
+    taskScheduler = new TaskScheduler(0);
 }
 
 EngineNode::~EngineNode() {
+    finishExecutions();
+    for (auto &execution: pipelineExecutions) {
+        delete execution.second;
+    }
     delete memoryBlock;
     delete pipelineBlock;
+    delete taskScheduler;
 }
 
 void EngineNode::storeBaseDataFragments(Object *object, ObjectId id) {
@@ -278,10 +308,16 @@ void EngineNode::storePipelineFragments(PipelineImplement *pipeline, PipelineId
 }
 
 bool EngineNode::deletePipelineFragment(PipelineId id) {
+    finishExecution(id);
+    if (pipelineExecutions.count(id) != 0) {
+        delete pipelineExecutions[id];
+        pipelineExecutions.erase(id);
+    }
     return pipelineBlock->deletePipelineFragment(id);
 }
 
 Object *EngineNode::requestBaseData(ObjectId id) {
+    std::lock_guard<std::mutex> lock(requestLock);
     auto fragment = memoryBlock->getBaseDataFragment(id);
     if (fragment == nullptr) {
         fragment = dataManagementUnit->getBaseDataFragment(id);
@@ -291,6 +327,7 @@ Object *EngineNode::requestBaseData(ObjectId id) {
 }
 
 Instance *EngineNode::requestInstanceData(InstanceId id) {
+    std::lock_guard<std::mutex> lock(requestLock);
     auto fragment = memoryBlock->getInstanceDataFragment(id);
     if (fragment == nullptr) {
         fragment = dataManagementUnit->getInstanceDataFragment(id);
@@ -304,6 +341,8 @@ ShaderResource *EngineNode::getShaderResource(ShaderResourceId id) {
 }
 
 PipelineImplement *EngineNode::requestPipelineFragment(PipelineId id) {
+    // the pipeline is handed out for changes, so a running execution has to finish first
+    finishExecution(id);
     return pipelineBlock->getPipelineFragment(id);
 }
 
@@ -348,34 +387,121 @@ MissShader *EngineNode::getShader(MissShaderId id) {
 }
 
 bool EngineNode::deleteShader(RayGeneratorShaderId id) {
+    finishExecutions();
     return pipelineBlock->deleteShader(id);
 }
 
 bool EngineNode::deleteShader(HitShaderId id) {
+    finishExecutions();
     return pipelineBlock->deleteShader(id);
 }
 
 bool EngineNode::deleteShader(OcclusionShaderId id) {
+    finishExecutions();
     return pipelineBlock->deleteShader(id);
 }
 
 bool EngineNode::deleteShader(PierceShaderId id) {
+    finishExecutions();
     return pipelineBlock->deleteShader(id);
 }
 
 bool EngineNode::deleteShader(MissShaderId id) {
+    finishExecutions();
     return pipelineBlock->deleteShader(id);
 }
 
 void EngineNode::runPipeline(PipelineId id) {
+    finishExecution(id);
+    if (pipelineExecutions.count(id) != 0) pipelineExecutions[id]->cancelled = false;
     pipelineBlock->runPipeline(id);
 }
 
+bool EngineNode::runPipeline(PipelineId id, double timeBudget, uint64_t targetSampleCount) {
+    finishExecution(id);
+    if (pipelineExecutions.count(id) != 0) pipelineExecutions[id]->cancelled = false;
+    return pipelineBlock->runPipeline(id, timeBudget, targetSampleCount);
+}
+
 void EngineNode::runPipelines() {
-    pipelineBlock->runPipelines();
+    finishExecutions();
+
+    // pipelines only read the shared data, so all of them are executed at once
+    std::vector<PipelineImplement *> pipelines;
+    for (auto id: pipelineBlock->getPipelineIds()) {
+        if (pipelineExecutions.count(id) != 0) pipelineExecutions[id]->cancelled = false;
+        pipelines.push_back(pipelineBlock->getPipelineFragment(id));
+    }
+    PipelineImplement::runAll(&pipelines, taskScheduler);
+}
+
+uint64_t EngineNode::runPipelineAsync(PipelineId id) {
+    auto pipeline = pipelineBlock->getPipelineFragment(id);
+    if (pipeline == nullptr) return 0;
+
+    // a pipeline only has a single result, so an execution waits for the previous one
+    finishExecution(id);
+    auto &execution = pipelineExecutions[id];
+    if (execution == nullptr) {
+        execution = new PipelineExecution();
+        pipeline->setCancellation(&execution->cancelled);
+    }
+    execution->cancelled = false;
+    execution->execution++;
+
+    auto pipelineExecution = execution;
+    taskScheduler->spawn(&pipelineExecution->taskGroup, [pipeline, pipelineExecution] {
+        pipelineExecution->status = pipeline->run();
+    });
+    return pipelineExecution->execution;
+}
+
+int EngineNode::waitPipelineExecution(PipelineId id, uint64_t execution) {
+    if (pipelineExecutions.count(id) == 0) return 0;
+    auto pipelineExecution = pipelineExecutions[id];
+    if (pipelineExecution->execution != execution) return 0;
+    taskScheduler->wait(&pipelineExecution->taskGroup);
+    return pipelineExecution->status;
+}
+
+bool EngineNode::isPipelineExecutionFinished(PipelineId id, uint64_t execution) {
+    if (pipelineExecutions.count(id) == 0) return true;
+    auto pipelineExecution = pipelineExecutions[id];
+    if (pipelineExecution->execution != execution) return true;
+    return taskScheduler->poll(&pipelineExecution->taskGroup);
+}
+
+void EngineNode::cancelPipelineExecution(PipelineId id, uint64_t execution) {
+    if (pipelineExecutions.count(id) == 0) return;
+    auto pipelineExecution = pipelineExecutions[id];
+    if (pipelineExecution->execution == execution) pipelineExecution->cancelled = true;
+}
+
+void EngineNode::finishExecution(PipelineId id) {
+    if (pipelineExecutions.count(id) != 0) {
+        taskScheduler->wait(&pipelineExecutions[id]->taskGroup);
+    }
+}
+
+void EngineNode::finishExecutions() {
+    for (auto &execution: pipelineExecutions) {
+        taskScheduler->wait(&execution.second->taskGroup);
+    }
+}
+
+void EngineNode::setThreadCount(unsigned int threadCount) {
+    finishExecutions();
+    delete taskScheduler;
+    taskScheduler = new TaskScheduler(threadCount);
+}
+
+TaskScheduler *EngineNode::getTaskScheduler() {
+    return taskScheduler;
 }
 
 bool EngineNode::deleteBaseDataFragment(ObjectId id) {
+    // instances of the object may be traced by any running execution
+    finishExecutions();
     return memoryBlock->deleteBaseDataFragment(id);
 }
 
@@ -8,6 +8,7 @@
 #include "RayTraceEngine/Object.h"
 #include "RayTraceEngine/Shader.h"
 #include "RayTraceEngine/Pipeline.h"
+#include <mutex>
 #include <unordered_map>
 
 class Instance;
@@ -18,8 +19,12 @@ class DataManagementUnitV2;
 
 class ShaderResource;
 
+class TaskScheduler;
+
 struct DBVHNode;
 
+struct PipelineExecution;
+
 class EngineNode {
 private:
     class MemoryBlock {
@@ -80,6 +85,8 @@ private:
 
         PipelineImplement *getPipelineFragment(PipelineId id);
 
+        std::vector<PipelineId> getPipelineIds();
+
         void addShader(RayGeneratorShaderId id, RayGeneratorShader *shader);
 
         void addShader(HitShaderId id, HitShader *shader);
@@ -112,7 +119,7 @@ private:
 
         void runPipeline(PipelineId id);
 
-        void runPipelines();
+        bool runPipeline(PipelineId id, double timeBudget, uint64_t targetSampleCount);
     };
 
     DataManagementUnitV2 *dataManagementUnit;
@@ -120,6 +127,16 @@ private:
     MemoryBlock *memoryBlock;
     PipelineBlock *pipelineBlock;
 
+    TaskScheduler *taskScheduler;
+
+    std::mutex requestLock;
+
+    std::unordered_map<PipelineId, PipelineExecution *> pipelineExecutions;
+
+    void finishExecution(PipelineId id);
+
+    void finishExecutions();
+
 public:
     explicit EngineNode(DataManagementUnitV2 *DMU);
 
@@ -185,7 +202,21 @@ public:
 
     void runPipeline(PipelineId id);
 
+    bool runPipeline(PipelineId id, double timeBudget, uint64_t targetSampleCount);
+
     void runPipelines();
+
+    uint64_t runPipelineAsync(PipelineId id);
+
+    int waitPipelineExecution(PipelineId id, uint64_t execution);
+
+    bool isPipelineExecutionFinished(PipelineId id, uint64_t execution);
+
+    void cancelPipelineExecution(PipelineId id, uint64_t execution);
+
+    void setThreadCount(unsigned int threadCount);
+
+    TaskScheduler *getTaskScheduler();
 };
 
 #endif //RAYTRACEENGINE_ENGINENODE_H
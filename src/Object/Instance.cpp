@@ -6,6 +6,7 @@
 #include <complex>
 #include "Object/Instance.h"
 #include "Engine Node/EngineNode.h"
+#include "Acceleration Structures/WideBVH.h"
 
 
 void createAABB(BoundingBox *aabb, Matrix4x4 *transform) {
@@ -164,244 +165,208 @@ void createAABB(BoundingBox *aabb, Matrix4x4 *transform) {
     aabb->maxCorner.z += mid.z;
 }
 
+static TransformType classifyTransform(Matrix4x4 *transform) {
+    auto &elements = transform->elements;
+    if (elements[3][0] != 0 || elements[3][1] != 0 || elements[3][2] != 0 || elements[3][3] != 1) {
+        return TransformType::AFFINE;
+    }
+    if (elements[0][1] != 0 || elements[0][2] != 0 || elements[1][0] != 0 || elements[1][2] != 0 ||
+        elements[2][0] != 0 || elements[2][1] != 0) {
+        return TransformType::AFFINE;
+    }
+    double scale = elements[0][0];
+    if (elements[1][1] != scale || elements[2][2] != scale || scale <= 0) return TransformType::AFFINE;
+    if (scale != 1) return TransformType::UNIFORM_SCALE;
+    if (elements[0][3] != 0 || elements[1][3] != 0 || elements[2][3] != 0) return TransformType::TRANSLATION;
+    return TransformType::IDENTITY;
+}
+
 Instance::Instance(EngineNode *node, ObjectCapsule *objectCapsule) : baseObjectId(objectCapsule->id) {
     engineNode = node;
-    objectCached = false;
     objectCache = nullptr;
     cost = objectCapsule->cost;
+    baseBoundingBox = objectCapsule->boundingBox;
     boundingBox = objectCapsule->boundingBox;
     transform = Matrix4x4::getIdentity();
-    inverseTransform = Matrix4x4::getIdentity();
+    for (int row = 0; row < 3; row++) {
+        for (int column = 0; column < 3; column++) {
+            objectTransform[row][column] = row == column ? 1 : 0;
+            normalTransform[row][column] = row == column ? 1 : 0;
+        }
+    }
 }
 
 void Instance::applyTransform(Matrix4x4 *newTransform) {
-    createAABB(&boundingBox, newTransform);
     transform.multiplyBy(newTransform);
-    inverseTransform = transform.getInverse();
+    transformType = classifyTransform(&transform);
+
+    double pivot[3] = {(baseBoundingBox.maxCorner.x + baseBoundingBox.minCorner.x) / 2,
+                       (baseBoundingBox.maxCorner.y + baseBoundingBox.minCorner.y) / 2,
+                       (baseBoundingBox.maxCorner.z + baseBoundingBox.minCorner.z) / 2};
+
+    // derived from the untransformed box every time, so that the box turns around the same pivot as the rays
+    boundingBox = baseBoundingBox;
+    switch (transformType) {
+        case TransformType::IDENTITY:
+            break;
+        case TransformType::TRANSLATION:
+            boundingBox.minCorner.x += transform.elements[0][3];
+            boundingBox.minCorner.y += transform.elements[1][3];
+            boundingBox.minCorner.z += transform.elements[2][3];
+            boundingBox.maxCorner.x += transform.elements[0][3];
+            boundingBox.maxCorner.y += transform.elements[1][3];
+            boundingBox.maxCorner.z += transform.elements[2][3];
+            break;
+        case TransformType::UNIFORM_SCALE: {
+            double scale = transform.elements[0][0];
+            double offset[3] = {transform.elements[0][3] + pivot[0], transform.elements[1][3] + pivot[1],
+                                transform.elements[2][3] + pivot[2]};
+            boundingBox.minCorner.x = (baseBoundingBox.minCorner.x - pivot[0]) * scale + offset[0];
+            boundingBox.minCorner.y = (baseBoundingBox.minCorner.y - pivot[1]) * scale + offset[1];
+            boundingBox.minCorner.z = (baseBoundingBox.minCorner.z - pivot[2]) * scale + offset[2];
+            boundingBox.maxCorner.x = (baseBoundingBox.maxCorner.x - pivot[0]) * scale + offset[0];
+            boundingBox.maxCorner.y = (baseBoundingBox.maxCorner.y - pivot[1]) * scale + offset[1];
+            boundingBox.maxCorner.z = (baseBoundingBox.maxCorner.z - pivot[2]) * scale + offset[2];
+            break;
+        }
+        case TransformType::AFFINE:
+            createAABB(&boundingBox, &transform);
+            break;
+    }
+
+    Matrix4x4 inverseTransform = transform.getInverse();
+
+    // object = inverse * (world - pivot) + pivot, folded into a single affine matrix
+    for (int row = 0; row < 3; row++) {
+        objectTransform[row][3] = inverseTransform.elements[row][3] + pivot[row];
+        for (int column = 0; column < 3; column++) {
+            objectTransform[row][column] = inverseTransform.elements[row][column];
+            objectTransform[row][3] -= inverseTransform.elements[row][column] * pivot[column];
+            normalTransform[row][column] = inverseTransform.elements[column][row];
+        }
+    }
 }
 
 void Instance::invalidateCache() {
-    objectCached = false;
+    objectCache = nullptr;
+}
+
+Object *Instance::getBaseObject() {
+    // instances are intersected from multiple worker threads at once, the first thread to resolve the base object
+    // publishes it for the others
+    Object *baseObject = objectCache.load(std::memory_order_acquire);
+    if (baseObject == nullptr) {
+        baseObject = engineNode->requestBaseData(baseObjectId);
+        objectCache.store(baseObject, std::memory_order_release);
+    }
+    return baseObject;
 }
 
 Instance::~Instance() = default;
 
-bool Instance::intersectFirst(IntersectionInfo *intersectionInfo, Ray *ray) {
-    Object *baseObject;
-    if (objectCached) {
-        baseObject = objectCache;
-    } else {
-        baseObject = engineNode->requestBaseData(baseObjectId);
-        objectCache = baseObject;
-        objectCached = true;
+void Instance::toObjectSpace(Ray *objectRay, Ray *ray) {
+    switch (transformType) {
+        case TransformType::IDENTITY:
+            *objectRay = *ray;
+            return;
+        case TransformType::TRANSLATION:
+            objectRay->origin.x = ray->origin.x + objectTransform[0][3];
+            objectRay->origin.y = ray->origin.y + objectTransform[1][3];
+            objectRay->origin.z = ray->origin.z + objectTransform[2][3];
+            objectRay->direction = ray->direction;
+            objectRay->dirfrac = ray->dirfrac;
+            return;
+        case TransformType::UNIFORM_SCALE: {
+            double scale = objectTransform[0][0];
+            objectRay->origin.x = ray->origin.x * scale + objectTransform[0][3];
+            objectRay->origin.y = ray->origin.y * scale + objectTransform[1][3];
+            objectRay->origin.z = ray->origin.z * scale + objectTransform[2][3];
+            objectRay->direction.x = ray->direction.x * scale;
+            objectRay->direction.y = ray->direction.y * scale;
+            objectRay->direction.z = ray->direction.z * scale;
+            objectRay->dirfrac.x = ray->dirfrac.x * transform.elements[0][0];
+            objectRay->dirfrac.y = ray->dirfrac.y * transform.elements[0][0];
+            objectRay->dirfrac.z = ray->dirfrac.z * transform.elements[0][0];
+            return;
+        }
+        case TransformType::AFFINE:
+            break;
     }
 
-    Ray newRay = *ray;
-
-    BoundingBox originalAABB = baseObject->getBoundaries();
-
-    Vector3D originalMid = {(originalAABB.maxCorner.x + originalAABB.minCorner.x) / 2,
-                            (originalAABB.maxCorner.y + originalAABB.minCorner.y) / 2,
-                            (originalAABB.maxCorner.z + originalAABB.minCorner.z) / 2};
-
-    newRay.origin.x -= originalMid.x;
-    newRay.origin.y -= originalMid.y;
-    newRay.origin.z -= originalMid.z;
-
-    Vector3D directionBuffer{};
-    directionBuffer.x = newRay.origin.x + newRay.direction.x;
-    directionBuffer.y = newRay.origin.y + newRay.direction.y;
-    directionBuffer.z = newRay.origin.z + newRay.direction.z;
-
-    Vector3D originBuffer = newRay.origin;
-    newRay.origin.x = inverseTransform.elements[0][0] * originBuffer.x +
-                      inverseTransform.elements[0][1] * originBuffer.y +
-                      inverseTransform.elements[0][2] * originBuffer.z +
-                      inverseTransform.elements[0][3];
-    newRay.origin.y = inverseTransform.elements[1][0] * originBuffer.x +
-                      inverseTransform.elements[1][1] * originBuffer.y +
-                      inverseTransform.elements[1][2] * originBuffer.z +
-                      inverseTransform.elements[1][3];
-    newRay.origin.z = inverseTransform.elements[2][0] * originBuffer.x +
-                      inverseTransform.elements[2][1] * originBuffer.y +
-                      inverseTransform.elements[2][2] * originBuffer.z +
-                      inverseTransform.elements[2][3];
-
-    newRay.direction.x = inverseTransform.elements[0][0] * directionBuffer.x +
-                         inverseTransform.elements[0][1] * directionBuffer.y +
-                         inverseTransform.elements[0][2] * directionBuffer.z +
-                         inverseTransform.elements[0][3];
-    newRay.direction.y = inverseTransform.elements[1][0] * directionBuffer.x +
-                         inverseTransform.elements[1][1] * directionBuffer.y +
-                         inverseTransform.elements[1][2] * directionBuffer.z +
-                         inverseTransform.elements[1][3];
-    newRay.direction.z = inverseTransform.elements[2][0] * directionBuffer.x +
-                         inverseTransform.elements[2][1] * directionBuffer.y +
-                         inverseTransform.elements[2][2] * directionBuffer.z +
-                         inverseTransform.elements[2][3];
-
-    newRay.direction.x = newRay.direction.x - newRay.origin.x;
-    newRay.direction.y = newRay.direction.y - newRay.origin.y;
-    newRay.direction.z = newRay.direction.z - newRay.origin.z;
-
-    double length = std::sqrt(newRay.direction.x * newRay.direction.x + newRay.direction.y * newRay.direction.y +
-                         newRay.direction.z * newRay.direction.z);
-
-    newRay.direction.x /= length;
-    newRay.direction.y /= length;
-    newRay.direction.z /= length;
-
-    newRay.dirfrac.x = 1.0 / newRay.direction.x;
-    newRay.dirfrac.y = 1.0 / newRay.direction.y;
-    newRay.dirfrac.z = 1.0 / newRay.direction.z;
-
-    newRay.origin.x += originalMid.x;
-    newRay.origin.y += originalMid.y;
-    newRay.origin.z += originalMid.z;
+    objectRay->origin.x = objectTransform[0][0] * ray->origin.x + objectTransform[0][1] * ray->origin.y +
+                          objectTransform[0][2] * ray->origin.z + objectTransform[0][3];
+    objectRay->origin.y = objectTransform[1][0] * ray->origin.x + objectTransform[1][1] * ray->origin.y +
+                          objectTransform[1][2] * ray->origin.z + objectTransform[1][3];
+    objectRay->origin.z = objectTransform[2][0] * ray->origin.x + objectTransform[2][1] * ray->origin.y +
+                          objectTransform[2][2] * ray->origin.z + objectTransform[2][3];
+
+    // the direction is not normalized, a distance along the object space ray is the same distance in world space
+    objectRay->direction.x = objectTransform[0][0] * ray->direction.x + objectTransform[0][1] * ray->direction.y +
+                             objectTransform[0][2] * ray->direction.z;
+    objectRay->direction.y = objectTransform[1][0] * ray->direction.x + objectTransform[1][1] * ray->direction.y +
+                             objectTransform[1][2] * ray->direction.z;
+    objectRay->direction.z = objectTransform[2][0] * ray->direction.x + objectTransform[2][1] * ray->direction.y +
+                             objectTransform[2][2] * ray->direction.z;
+
+    objectRay->dirfrac.x = 1.0 / objectRay->direction.x;
+    objectRay->dirfrac.y = 1.0 / objectRay->direction.y;
+    objectRay->dirfrac.z = 1.0 / objectRay->direction.z;
+}
+
+void Instance::toWorldSpace(IntersectionInfo *intersectionInfo, Ray *ray) {
+    // the base object already intersected the world space ray
+    if (transformType == TransformType::IDENTITY) return;
+
+    double distance = intersectionInfo->distance;
+    intersectionInfo->position.x = ray->origin.x + ray->direction.x * distance;
+    intersectionInfo->position.y = ray->origin.y + ray->direction.y * distance;
+    intersectionInfo->position.z = ray->origin.z + ray->direction.z * distance;
+
+    // moving and uniformly scaling keep the direction of normals
+    if (transformType != TransformType::AFFINE) return;
+
+    Vector3D normal = intersectionInfo->normal;
+    intersectionInfo->normal.x = normalTransform[0][0] * normal.x + normalTransform[0][1] * normal.y +
+                                 normalTransform[0][2] * normal.z;
+    intersectionInfo->normal.y = normalTransform[1][0] * normal.x + normalTransform[1][1] * normal.y +
+                                 normalTransform[1][2] * normal.z;
+    intersectionInfo->normal.z = normalTransform[2][0] * normal.x + normalTransform[2][1] * normal.y +
+                                 normalTransform[2][2] * normal.z;
+
+    double length = std::sqrt(intersectionInfo->normal.x * intersectionInfo->normal.x +
+                              intersectionInfo->normal.y * intersectionInfo->normal.y +
+                              intersectionInfo->normal.z * intersectionInfo->normal.z);
+
+    intersectionInfo->normal.x /= length;
+    intersectionInfo->normal.y /= length;
+    intersectionInfo->normal.z /= length;
+}
+
+bool Instance::intersectFirst(IntersectionInfo *intersectionInfo, Ray *ray) {
+    Object *baseObject = getBaseObject();
+
+    Ray newRay{};
+    toObjectSpace(&newRay, ray);
 
     IntersectionInfo intersectionInformationBuffer{};
     intersectionInformationBuffer.hit = false;
-    intersectionInformationBuffer.distance = std::numeric_limits<double>::max();
+    intersectionInformationBuffer.distance = intersectionInfo->distance;
     intersectionInformationBuffer.position = {0, 0, 0};
     bool hit = baseObject->intersectFirst(&intersectionInformationBuffer, &newRay);
 
-    if (hit) {
-        Vector3D pos = intersectionInformationBuffer.position;
-
-        intersectionInformationBuffer.position.x = transform.elements[0][0] * pos.x +
-                                                   transform.elements[0][1] * pos.y +
-                                                   transform.elements[0][2] * pos.z +
-                                                   transform.elements[0][3];
-        intersectionInformationBuffer.position.y = transform.elements[1][0] * pos.x +
-                                                   transform.elements[1][1] * pos.y +
-                                                   transform.elements[1][2] * pos.z +
-                                                   transform.elements[1][3];
-        intersectionInformationBuffer.position.z = transform.elements[2][0] * pos.x +
-                                                   transform.elements[2][1] * pos.y +
-                                                   transform.elements[2][2] * pos.z +
-                                                   transform.elements[2][3];
-
-        Vector3D normal = {intersectionInformationBuffer.normal.x + pos.x,
-                           intersectionInformationBuffer.normal.y + pos.y,
-                           intersectionInformationBuffer.normal.z + pos.z};
-
-        intersectionInformationBuffer.normal.x = transform.elements[0][0] * normal.x +
-                                                 transform.elements[0][1] * normal.y +
-                                                 transform.elements[0][2] * normal.z +
-                                                 transform.elements[0][3];
-        intersectionInformationBuffer.normal.y = transform.elements[1][0] * normal.x +
-                                                 transform.elements[1][1] * normal.y +
-                                                 transform.elements[1][2] * normal.z +
-                                                 transform.elements[1][3];
-        intersectionInformationBuffer.normal.z = transform.elements[2][0] * normal.x +
-                                                 transform.elements[2][1] * normal.y +
-                                                 transform.elements[2][2] * normal.z +
-                                                 transform.elements[2][3];
-
-        intersectionInformationBuffer.normal.x =
-                intersectionInformationBuffer.normal.x - intersectionInformationBuffer.position.x;
-        intersectionInformationBuffer.normal.y =
-                intersectionInformationBuffer.normal.y - intersectionInformationBuffer.position.y;
-        intersectionInformationBuffer.normal.z =
-                intersectionInformationBuffer.normal.z - intersectionInformationBuffer.position.z;
-
-        length = sqrt(intersectionInformationBuffer.normal.x * intersectionInformationBuffer.normal.x +
-                      intersectionInformationBuffer.normal.y * intersectionInformationBuffer.normal.y +
-                      intersectionInformationBuffer.normal.z * intersectionInformationBuffer.normal.z);
-
-        intersectionInformationBuffer.normal.x /= length;
-        intersectionInformationBuffer.normal.y /= length;
-        intersectionInformationBuffer.normal.z /= length;
-
-        intersectionInformationBuffer.
-                distance = sqrt(
-                (ray->origin.x - intersectionInformationBuffer.position.x) *
-                (ray->origin.x - intersectionInformationBuffer.position.x) +
-                (ray->origin.y - intersectionInformationBuffer.position.y) *
-                (ray->origin.y - intersectionInformationBuffer.position.y) +
-                (ray->origin.z - intersectionInformationBuffer.position.z) *
-                (ray->origin.z - intersectionInformationBuffer.position.z));
-    }
-
-    if (intersectionInformationBuffer.hit) {
-        if (intersectionInformationBuffer.distance < intersectionInfo->distance) {
-            *intersectionInfo = intersectionInformationBuffer;
-            return true;
-        }
+    if (hit && intersectionInformationBuffer.distance < intersectionInfo->distance) {
+        toWorldSpace(&intersectionInformationBuffer, ray);
+        *intersectionInfo = intersectionInformationBuffer;
+        return true;
     }
     return false;
 }
 
 bool Instance::intersectAny(IntersectionInfo *intersectionInfo, Ray *ray) {
-    Object *baseObject;
-    if (objectCached) {
-        baseObject = objectCache;
-    } else {
-        baseObject = engineNode->requestBaseData(baseObjectId);
-    }
+    Object *baseObject = getBaseObject();
 
-    Ray newRay = *ray;
-
-    BoundingBox originalAABB = baseObject->getBoundaries();
-
-    Vector3D originalMid = {(originalAABB.maxCorner.x + originalAABB.minCorner.x) / 2,
-                            (originalAABB.maxCorner.y + originalAABB.minCorner.y) / 2,
-                            (originalAABB.maxCorner.z + originalAABB.minCorner.z) / 2};
-
-    newRay.origin.x -= originalMid.x;
-    newRay.origin.y -= originalMid.y;
-    newRay.origin.z -= originalMid.z;
-
-    Vector3D directionBuffer{};
-    directionBuffer.x = newRay.origin.x + newRay.direction.x;
-    directionBuffer.y = newRay.origin.y + newRay.direction.y;
-    directionBuffer.z = newRay.origin.z + newRay.direction.z;
-
-    Vector3D originBuffer = newRay.origin;
-    newRay.origin.x = inverseTransform.elements[0][0] * originBuffer.x +
-                      inverseTransform.elements[0][1] * originBuffer.y +
-                      inverseTransform.elements[0][2] * originBuffer.z +
-                      inverseTransform.elements[0][3];
-    newRay.origin.y = inverseTransform.elements[1][0] * originBuffer.x +
-                      inverseTransform.elements[1][1] * originBuffer.y +
-                      inverseTransform.elements[1][2] * originBuffer.z +
-                      inverseTransform.elements[1][3];
-    newRay.origin.z = inverseTransform.elements[2][0] * originBuffer.x +
-                      inverseTransform.elements[2][1] * originBuffer.y +
-                      inverseTransform.elements[2][2] * originBuffer.z +
-                      inverseTransform.elements[2][3];
-
-    newRay.direction.x = inverseTransform.elements[0][0] * directionBuffer.x +
-                         inverseTransform.elements[0][1] * directionBuffer.y +
-                         inverseTransform.elements[0][2] * directionBuffer.z +
-                         inverseTransform.elements[0][3];
-    newRay.direction.y = inverseTransform.elements[1][0] * directionBuffer.x +
-                         inverseTransform.elements[1][1] * directionBuffer.y +
-                         inverseTransform.elements[1][2] * directionBuffer.z +
-                         inverseTransform.elements[1][3];
-    newRay.direction.z = inverseTransform.elements[2][0] * directionBuffer.x +
-                         inverseTransform.elements[2][1] * directionBuffer.y +
-                         inverseTransform.elements[2][2] * directionBuffer.z +
-                         inverseTransform.elements[2][3];
-
-    newRay.direction.x = newRay.direction.x - newRay.origin.x;
-    newRay.direction.y = newRay.direction.y - newRay.origin.y;
-    newRay.direction.z = newRay.direction.z - newRay.origin.z;
-
-    double length = sqrt(newRay.direction.x * newRay.direction.x + newRay.direction.y * newRay.direction.y +
-                         newRay.direction.z * newRay.direction.z);
-
-    newRay.direction.x /= length;
-    newRay.direction.y /= length;
-    newRay.direction.z /= length;
-
-    newRay.dirfrac.x = 1.0 / newRay.direction.x;
-    newRay.dirfrac.y = 1.0 / newRay.direction.y;
-    newRay.dirfrac.z = 1.0 / newRay.direction.z;
-
-    newRay.origin.x += originalMid.x;
-    newRay.origin.y += originalMid.y;
-    newRay.origin.z += originalMid.z;
+    Ray newRay{};
+    toObjectSpace(&newRay, ray);
 
     IntersectionInfo intersectionInformationBuffer{};
     intersectionInformationBuffer.hit = false;
@@ -410,62 +375,7 @@ bool Instance::intersectAny(IntersectionInfo *intersectionInfo, Ray *ray) {
     bool hit = baseObject->intersectAny(&intersectionInformationBuffer, &newRay);
 
     if (hit) {
-        Vector3D pos = intersectionInformationBuffer.position;
-
-        intersectionInformationBuffer.position.x = transform.elements[0][0] * pos.x +
-                                                   transform.elements[0][1] * pos.y +
-                                                   transform.elements[0][2] * pos.z +
-                                                   transform.elements[0][3];
-        intersectionInformationBuffer.position.y = transform.elements[1][0] * pos.x +
-                                                   transform.elements[1][1] * pos.y +
-                                                   transform.elements[1][2] * pos.z +
-                                                   transform.elements[1][3];
-        intersectionInformationBuffer.position.z = transform.elements[2][0] * pos.x +
-                                                   transform.elements[2][1] * pos.y +
-                                                   transform.elements[2][2] * pos.z +
-                                                   transform.elements[2][3];
-
-        Vector3D normal = {intersectionInformationBuffer.normal.x + pos.x,
-                           intersectionInformationBuffer.normal.y + pos.y,
-                           intersectionInformationBuffer.normal.z + pos.z};
-
-        intersectionInformationBuffer.normal.x = transform.elements[0][0] * normal.x +
-                                                 transform.elements[0][1] * normal.y +
-                                                 transform.elements[0][2] * normal.z +
-                                                 transform.elements[0][3];
-        intersectionInformationBuffer.normal.y = transform.elements[1][0] * normal.x +
-                                                 transform.elements[1][1] * normal.y +
-                                                 transform.elements[1][2] * normal.z +
-                                                 transform.elements[1][3];
-        intersectionInformationBuffer.normal.z = transform.elements[2][0] * normal.x +
-                                                 transform.elements[2][1] * normal.y +
-                                                 transform.elements[2][2] * normal.z +
-                                                 transform.elements[2][3];
-
-        intersectionInformationBuffer.normal.x =
-                intersectionInformationBuffer.normal.x - intersectionInformationBuffer.position.x;
-        intersectionInformationBuffer.normal.y =
-                intersectionInformationBuffer.normal.y - intersectionInformationBuffer.position.y;
-        intersectionInformationBuffer.normal.z =
-                intersectionInformationBuffer.normal.z - intersectionInformationBuffer.position.z;
-
-        length = sqrt(intersectionInformationBuffer.normal.x * intersectionInformationBuffer.normal.x +
-                      intersectionInformationBuffer.normal.y * intersectionInformationBuffer.normal.y +
-                      intersectionInformationBuffer.normal.z * intersectionInformationBuffer.normal.z);
-
-        intersectionInformationBuffer.normal.x /= length;
-        intersectionInformationBuffer.normal.y /= length;
-        intersectionInformationBuffer.normal.z /= length;
-
-        intersectionInformationBuffer.
-                distance = sqrt(
-                (ray->origin.x - intersectionInformationBuffer.position.x) *
-                (ray->origin.x - intersectionInformationBuffer.position.x) +
-                (ray->origin.y - intersectionInformationBuffer.position.y) *
-                (ray->origin.y - intersectionInformationBuffer.position.y) +
-                (ray->origin.z - intersectionInformationBuffer.position.z) *
-                (ray->origin.z - intersectionInformationBuffer.position.z));
-
+        toWorldSpace(&intersectionInformationBuffer, ray);
         *intersectionInfo = intersectionInformationBuffer;
     }
 
@@ -473,137 +383,17 @@ bool Instance::intersectAny(IntersectionInfo *intersectionInfo, Ray *ray) {
 }
 
 bool Instance::intersectAll(std::vector<IntersectionInfo *> *intersectionInfo, Ray *ray) {
-    Object *baseObject;
-    if (objectCached) {
-        baseObject = objectCache;
-    } else {
-        baseObject = engineNode->requestBaseData(baseObjectId);
-    }
+    Object *baseObject = getBaseObject();
 
-    Ray newRay = *ray;
-
-    BoundingBox originalAABB = baseObject->getBoundaries();
-
-    Vector3D originalMid = {(originalAABB.maxCorner.x + originalAABB.minCorner.x) / 2,
-                            (originalAABB.maxCorner.y + originalAABB.minCorner.y) / 2,
-                            (originalAABB.maxCorner.z + originalAABB.minCorner.z) / 2};
-
-    newRay.origin.x -= originalMid.x;
-    newRay.origin.y -= originalMid.y;
-    newRay.origin.z -= originalMid.z;
-
-    Vector3D directionBuffer{};
-    directionBuffer.x = newRay.origin.x + newRay.direction.x;
-    directionBuffer.y = newRay.origin.y + newRay.direction.y;
-    directionBuffer.z = newRay.origin.z + newRay.direction.z;
-
-    Vector3D originBuffer = newRay.origin;
-    newRay.origin.x = inverseTransform.elements[0][0] * originBuffer.x +
-                      inverseTransform.elements[0][1] * originBuffer.y +
-                      inverseTransform.elements[0][2] * originBuffer.z +
-                      inverseTransform.elements[0][3];
-    newRay.origin.y = inverseTransform.elements[1][0] * originBuffer.x +
-                      inverseTransform.elements[1][1] * originBuffer.y +
-                      inverseTransform.elements[1][2] * originBuffer.z +
-                      inverseTransform.elements[1][3];
-    newRay.origin.z = inverseTransform.elements[2][0] * originBuffer.x +
-                      inverseTransform.elements[2][1] * originBuffer.y +
-                      inverseTransform.elements[2][2] * originBuffer.z +
-                      inverseTransform.elements[2][3];
-
-    newRay.direction.x = inverseTransform.elements[0][0] * directionBuffer.x +
-                         inverseTransform.elements[0][1] * directionBuffer.y +
-                         inverseTransform.elements[0][2] * directionBuffer.z +
-                         inverseTransform.elements[0][3];
-    newRay.direction.y = inverseTransform.elements[1][0] * directionBuffer.x +
-                         inverseTransform.elements[1][1] * directionBuffer.y +
-                         inverseTransform.elements[1][2] * directionBuffer.z +
-                         inverseTransform.elements[1][3];
-    newRay.direction.z = inverseTransform.elements[2][0] * directionBuffer.x +
-                         inverseTransform.elements[2][1] * directionBuffer.y +
-                         inverseTransform.elements[2][2] * directionBuffer.z +
-                         inverseTransform.elements[2][3];
-
-    newRay.direction.x = newRay.direction.x - newRay.origin.x;
-    newRay.direction.y = newRay.direction.y - newRay.origin.y;
-    newRay.direction.z = newRay.direction.z - newRay.origin.z;
-
-    double length = sqrt(newRay.direction.x * newRay.direction.x + newRay.direction.y * newRay.direction.y +
-                         newRay.direction.z * newRay.direction.z);
-
-    newRay.direction.x /= length;
-    newRay.direction.y /= length;
-    newRay.direction.z /= length;
-
-    newRay.dirfrac.x = 1.0 / newRay.direction.x;
-    newRay.dirfrac.y = 1.0 / newRay.direction.y;
-    newRay.dirfrac.z = 1.0 / newRay.direction.z;
-
-    newRay.origin.x += originalMid.x;
-    newRay.origin.y += originalMid.y;
-    newRay.origin.z += originalMid.z;
+    Ray newRay{};
+    toObjectSpace(&newRay, ray);
 
     std::vector<IntersectionInfo *> intersectionInformationBuffers;
     bool hit = baseObject->intersectAll(&intersectionInformationBuffers, &newRay);
 
     if (hit) {
         for (auto intersectionInformationBuffer: intersectionInformationBuffers) {
-            Vector3D pos = intersectionInformationBuffer->position;
-
-            intersectionInformationBuffer->position.x = transform.elements[0][0] * pos.x +
-                                                        transform.elements[0][1] * pos.y +
-                                                        transform.elements[0][2] * pos.z +
-                                                        transform.elements[0][3];
-            intersectionInformationBuffer->position.y = transform.elements[1][0] * pos.x +
-                                                        transform.elements[1][1] * pos.y +
-                                                        transform.elements[1][2] * pos.z +
-                                                        transform.elements[1][3];
-            intersectionInformationBuffer->position.z = transform.elements[2][0] * pos.x +
-                                                        transform.elements[2][1] * pos.y +
-                                                        transform.elements[2][2] * pos.z +
-                                                        transform.elements[2][3];
-
-            Vector3D normal = {intersectionInformationBuffer->normal.x + pos.x,
-                               intersectionInformationBuffer->normal.y + pos.y,
-                               intersectionInformationBuffer->normal.z + pos.z};
-
-            intersectionInformationBuffer->normal.x = transform.elements[0][0] * normal.x +
-                                                      transform.elements[0][1] * normal.y +
-                                                      transform.elements[0][2] * normal.z +
-                                                      transform.elements[0][3];
-            intersectionInformationBuffer->normal.y = transform.elements[1][0] * normal.x +
-                                                      transform.elements[1][1] * normal.y +
-                                                      transform.elements[1][2] * normal.z +
-                                                      transform.elements[1][3];
-            intersectionInformationBuffer->normal.z = transform.elements[2][0] * normal.x +
-                                                      transform.elements[2][1] * normal.y +
-                                                      transform.elements[2][2] * normal.z +
-                                                      transform.elements[2][3];
-
-            intersectionInformationBuffer->normal.x =
-                    intersectionInformationBuffer->normal.x - intersectionInformationBuffer->position.x;
-            intersectionInformationBuffer->normal.y =
-                    intersectionInformationBuffer->normal.y - intersectionInformationBuffer->position.y;
-            intersectionInformationBuffer->normal.z =
-                    intersectionInformationBuffer->normal.z - intersectionInformationBuffer->position.z;
-
-            length = sqrt(intersectionInformationBuffer->normal.x * intersectionInformationBuffer->normal.x +
-                          intersectionInformationBuffer->normal.y * intersectionInformationBuffer->normal.y +
-                          intersectionInformationBuffer->normal.z * intersectionInformationBuffer->normal.z);
-
-            intersectionInformationBuffer->normal.x /= length;
-            intersectionInformationBuffer->normal.y /= length;
-            intersectionInformationBuffer->normal.z /= length;
-
-            intersectionInformationBuffer->
-                    distance = sqrt(
-                    (ray->origin.x - intersectionInformationBuffer->position.x) *
-                    (ray->origin.x - intersectionInformationBuffer->position.x) +
-                    (ray->origin.y - intersectionInformationBuffer->position.y) *
-                    (ray->origin.y - intersectionInformationBuffer->position.y) +
-                    (ray->origin.z - intersectionInformationBuffer->position.z) *
-                    (ray->origin.z - intersectionInformationBuffer->position.z));
-
+            toWorldSpace(intersectionInformationBuffer, ray);
             intersectionInfo->push_back(intersectionInformationBuffer);
         }
     }
@@ -611,6 +401,58 @@ bool Instance::intersectAll(std::vector<IntersectionInfo *> *intersectionInfo, R
     return hit;
 }
 
+uint64_t Instance::intersectFirstPacket(IntersectionInfo *intersectionInfo, Ray *rays, uint64_t rayMask) {
+    Object *baseObject = getBaseObject();
+
+    Ray newRays[WIDE_BVH_PACKET_SIZE];
+    IntersectionInfo intersectionInformationBuffers[WIDE_BVH_PACKET_SIZE];
+    for (uint64_t remaining = rayMask; remaining != 0; remaining &= remaining - 1) {
+        uint32_t i = lowestBit(remaining);
+        toObjectSpace(&newRays[i], &rays[i]);
+        intersectionInformationBuffers[i] = {};
+        intersectionInformationBuffers[i].hit = false;
+        intersectionInformationBuffers[i].distance = intersectionInfo[i].distance;
+        intersectionInformationBuffers[i].position = {0, 0, 0};
+    }
+
+    uint64_t hit = baseObject->intersectFirstPacket(intersectionInformationBuffers, newRays, rayMask);
+
+    for (uint64_t remaining = hit; remaining != 0; remaining &= remaining - 1) {
+        uint32_t i = lowestBit(remaining);
+        if (intersectionInformationBuffers[i].distance < intersectionInfo[i].distance) {
+            toWorldSpace(&intersectionInformationBuffers[i], &rays[i]);
+            intersectionInfo[i] = intersectionInformationBuffers[i];
+        } else {
+            hit &= ~(1ull << i);
+        }
+    }
+    return hit;
+}
+
+uint64_t Instance::intersectAnyPacket(IntersectionInfo *intersectionInfo, Ray *rays, uint64_t rayMask) {
+    Object *baseObject = getBaseObject();
+
+    Ray newRays[WIDE_BVH_PACKET_SIZE];
+    IntersectionInfo intersectionInformationBuffers[WIDE_BVH_PACKET_SIZE];
+    for (uint64_t remaining = rayMask; remaining != 0; remaining &= remaining - 1) {
+        uint32_t i = lowestBit(remaining);
+        toObjectSpace(&newRays[i], &rays[i]);
+        intersectionInformationBuffers[i] = {};
+        intersectionInformationBuffers[i].hit = false;
+        intersectionInformationBuffers[i].distance = std::numeric_limits<double>::max();
+        intersectionInformationBuffers[i].position = {0, 0, 0};
+    }
+
+    uint64_t hit = baseObject->intersectAnyPacket(intersectionInformationBuffers, newRays, rayMask);
+
+    for (uint64_t remaining = hit; remaining != 0; remaining &= remaining - 1) {
+        uint32_t i = lowestBit(remaining);
+        toWorldSpace(&intersectionInformationBuffers[i], &rays[i]);
+        intersectionInfo[i] = intersectionInformationBuffers[i];
+    }
+    return hit;
+}
+
 BoundingBox Instance::getBoundaries() {
     return boundingBox;
 }
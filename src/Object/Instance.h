@@ -5,22 +5,50 @@
 #ifndef RAYTRACECORE_INSTANCE_H
 #define RAYTRACECORE_INSTANCE_H
 
+#include <atomic>
+#include <cstdint>
 #include "RayTraceEngine/Object.h"
 
 class EngineNode;
 
+/**
+ * Shape of the transform of an instance, classified once it is applied so that intersections and boundaries skip the
+ * parts of the matrix math that have no effect.
+ * IDENTITY:        The instance is placed exactly like its base object.
+ * TRANSLATION:     The base object is only moved.
+ * UNIFORM_SCALE:   The base object is moved and scaled by the same positive factor on every axis.
+ * AFFINE:          Any other transform, rotations, shears and non uniform scales.
+ */
+enum class TransformType : uint8_t {
+    IDENTITY, TRANSLATION, UNIFORM_SCALE, AFFINE
+};
+
 class Instance : public Object {
 private:
     EngineNode *engineNode;
 
     ObjectId baseObjectId;
-    bool objectCached;
-    Object *objectCache;
+    std::atomic<Object *> objectCache;
 
     double cost;
+    BoundingBox baseBoundingBox{};
     BoundingBox boundingBox{};
     Matrix4x4 transform{};
-    Matrix4x4 inverseTransform{};
+
+    /**
+     * Cached at applyTransform, so that intersections only multiply with them.
+     * objectTransform: World to object space, a 3x4 affine matrix that already rotates and scales around the pivot.
+     * normalTransform: Object to world space for normals, the transposed inverse of the linear part of transform.
+     */
+    double objectTransform[3][4]{};
+    double normalTransform[3][3]{};
+    TransformType transformType = TransformType::IDENTITY;
+
+    Object *getBaseObject();
+
+    void toObjectSpace(Ray *objectRay, Ray *ray);
+
+    void toWorldSpace(IntersectionInfo *intersectionInfo, Ray *ray);
 
 public:
     explicit Instance(EngineNode *node, ObjectCapsule *objectCapsule);
@@ -41,6 +69,10 @@ public:
 
     bool intersectAll(std::vector<IntersectionInfo *> *intersectionInfo, Ray *ray) override;
 
+    uint64_t intersectFirstPacket(IntersectionInfo *intersectionInfo, Ray *rays, uint64_t rayMask) override;
+
+    uint64_t intersectAnyPacket(IntersectionInfo *intersectionInfo, Ray *rays, uint64_t rayMask) override;
+
     double getSurfaceArea() override;
 
     ObjectCapsule getCapsule() override;
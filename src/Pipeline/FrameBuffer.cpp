@@ -0,0 +1,78 @@
+//
+// Created by Sebastian on 18.10.2026.
+//
+
+#include <algorithm>
+#include <new>
+
+#include "Pipeline/FrameBuffer.h"
+#include "RayTraceEngine/BasicStructures.h"
+
+// alignment of the image storage in bytes, a cache line, so that the tiles of different threads rarely share one
+static const std::size_t FRAME_BUFFER_ALIGNMENT = 64;
+
+template<class T>
+static T *allocate(uint64_t count) {
+    return static_cast<T *>(::operator new(count * sizeof(T), std::align_val_t(FRAME_BUFFER_ALIGNMENT)));
+}
+
+template<class T>
+static void release(T *storage) {
+    if (storage != nullptr) ::operator delete(storage, std::align_val_t(FRAME_BUFFER_ALIGNMENT));
+}
+
+// growing to at least twice the old capacity bounds the number of reallocations while the resolution goes up
+template<class T>
+static bool reserve(T **storage, uint64_t *capacity, uint64_t count) {
+    if (count <= *capacity) return false;
+    *capacity = std::max(count, *capacity * 2);
+    release(*storage);
+    *storage = allocate<T>(*capacity);
+    return true;
+}
+
+FrameBuffer::FrameBuffer(int width, int height) {
+    result = new Texture{"Render", 0, 0, nullptr};
+    resultCapacity = 0;
+    accumulation = nullptr;
+    accumulationWidth = 0;
+    accumulationHeight = 0;
+    accumulationCapacity = 0;
+
+    resize(width, height);
+    resizeAccumulation(width, height);
+}
+
+FrameBuffer::~FrameBuffer() {
+    release(result->image);
+    release(accumulation);
+    delete result;
+}
+
+bool FrameBuffer::resize(int width, int height) {
+    uint64_t pixelCount = (uint64_t) width * height;
+    result->w = width;
+    result->h = height;
+
+    bool reallocated = reserve(&result->image, &resultCapacity, pixelCount * 3);
+    std::fill(result->image, result->image + pixelCount * 3, 0);
+    return reallocated;
+}
+
+bool FrameBuffer::resizeAccumulation(int width, int height) {
+    accumulationWidth = width;
+    accumulationHeight = height;
+    return reserve(&accumulation, &accumulationCapacity, (uint64_t) width * height * 4);
+}
+
+void FrameBuffer::clearAccumulation() {
+    std::fill(accumulation, accumulation + (uint64_t) accumulationWidth * accumulationHeight * 4, 0.0f);
+}
+
+Texture *FrameBuffer::getResult() {
+    return result;
+}
+
+float *FrameBuffer::getAccumulation() {
+    return accumulation;
+}
@@ -0,0 +1,65 @@
+//
+// Created by Sebastian on 18.10.2026.
+//
+
+#ifndef RAYTRACEENGINE_FRAMEBUFFER_H
+#define RAYTRACEENGINE_FRAMEBUFFER_H
+
+#include <cstdint>
+
+struct Texture;
+
+/**
+ * Image memory of a pipeline, the resolved 24 bit result and the float rgba accumulation buffer it is resolved from.
+ * The accumulation buffer has the resolution that is rendered, which may be lower than the one of the result. Resizing
+ * reuses the existing storage as long as it is large enough and otherwise grows it geometrically, so that frequent
+ * resolution changes settle without further allocations. Storage is aligned to cache lines.
+ * result:                  The resolved image handed out to the user, its image pointer changes when the storage grows.
+ * resultCapacity:          Number of pixels the storage of the result can hold.
+ * accumulation:            Sum of the colors of all samples as rgba, the alpha channel counts the samples of every pixel.
+ * accumulationWidth:       Horizontal resolution of the accumulation buffer.
+ * accumulationHeight:      Vertical resolution of the accumulation buffer.
+ * accumulationCapacity:    Number of pixels the accumulation buffer can hold.
+ */
+class FrameBuffer {
+private:
+    Texture *result;
+    uint64_t resultCapacity;
+
+    float *accumulation;
+    int accumulationWidth;
+    int accumulationHeight;
+    uint64_t accumulationCapacity;
+
+public:
+    FrameBuffer(int width, int height);
+
+    ~FrameBuffer();
+
+    /**
+     * Changes the resolution of the result, which is cleared afterwards.
+     * @param width     New horizontal resolution.
+     * @param height    New vertical resolution.
+     * @return          True if the storage had to be reallocated.
+     */
+    bool resize(int width, int height);
+
+    /**
+     * Changes the resolution of the accumulation buffer, its contents are undefined afterwards.
+     * @param width     New horizontal resolution.
+     * @param height    New vertical resolution.
+     * @return          True if the storage had to be reallocated.
+     */
+    bool resizeAccumulation(int width, int height);
+
+    /**
+     * Sets all pixels of the accumulation buffer to zero.
+     */
+    void clearAccumulation();
+
+    Texture *getResult();
+
+    float *getAccumulation();
+};
+
+#endif //RAYTRACEENGINE_FRAMEBUFFER_H
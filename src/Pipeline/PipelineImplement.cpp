@@ -2,23 +2,237 @@
 // Created by sebastian on 02.07.19.
 //
 
+#include <algorithm>
+#include <cmath>
+#include <functional>
 #include <iostream>
 
 #include "Data Management/DataManagementUnitV2.h"
 #include "Pipeline/PipelineImplement.h"
+#include "Pipeline/FrameBuffer.h"
+#include "Pipeline/RayResourcePool.h"
 #include "RayTraceEngine/Pipeline.h"
 #include "RayTraceEngine/BasicStructures.h"
 #include "RayTraceEngine/Shader.h"
 #include "Acceleration Structures/DBVHv2.h"
+#include "Acceleration Structures/CompiledDBVH.h"
 #include "Engine Node/EngineNode.h"
+#include "Utils/ThreadPool/TaskScheduler.h"
 
-struct RayContainer {
-    int rayID;
-    Vector3D rayOrigin;
-    Vector3D rayDirection;
-    RayResource *rayResource;
+// edge length of the square pixel tiles that are distributed over the worker threads
+static const int TILE_SIZE = 16;
+
+// number of tiles per worker thread rendered between two checks of the deadline of a progressive execution
+static const uint64_t TILES_PER_WORKER = 4;
+
+// number of pixels whose rays are traced together in wavefront mode, bounds the memory of the ray buffers
+static const int WAVEFRONT_SIZE = 1 << 16;
+
+// number of pixels of the smaller waves of progressive executions in wavefront mode, WAVEFRONT_SIZE is a multiple of it
+static const int PROGRESSIVE_WAVEFRONT_SIZE = 1 << 12;
+
+// number of rays or pixels handled by a single task in wavefront mode
+static const uint64_t WAVEFRONT_CHUNK_SIZE = 256;
+
+// lowest render scale the frame time controller goes down to
+static const double MIN_RENDER_SCALE = 0.25;
+
+// relative change of the render scale below which the controller keeps the current resolution
+static const double RENDER_SCALE_TOLERANCE = 0.05;
+
+// fraction of the target frame time the controller plans with, leaves room for variations between frames
+static const double FRAME_TIME_HEADROOM = 0.9;
+
+// weight of a new measurement when the time per pixel went down, increases are taken over at once
+static const double PIXEL_TIME_SMOOTHING = 0.25;
+
+// largest alignment of inline ray payloads in bytes, the alignment of the payload buffers
+static const uint64_t MAX_PAYLOAD_ALIGNMENT = 64;
+
+/**
+ * A tile of a pipeline in the schedule shared by all pipelines executed together.
+ * pipeline:    The pipeline the tile belongs to.
+ * tile:        Index of the tile, row by row.
+ */
+struct ScheduledTile {
+    PipelineImplement *pipeline;
+    uint64_t tile;
 };
 
+static void pushPayload(PayloadBuffer *payloads, const void *payload, uint64_t payloadStride) {
+    auto bytes = static_cast<const unsigned char *>(payload);
+    payloads->insert(payloads->end(), bytes, bytes + payloadStride);
+}
+
+static void *getPayload(PayloadBuffer *payloads, uint64_t index, uint64_t payloadStride) {
+    return payloadStride == 0 ? nullptr : payloads->data() + index * payloadStride;
+}
+
+/**
+ * Moves the payload of the last ray on the stack of a worker into its current payload, the slot is reused by the
+ * children of the ray.
+ * @param tileContext   Scratch memory of the worker.
+ * @param payloadStride Size of a payload slot, zero if the pipeline declares no payload.
+ * @return              The current payload, nullptr if the pipeline declares no payload.
+ */
+static void *popPayload(TileContext *tileContext, uint64_t payloadStride) {
+    if (payloadStride == 0) return nullptr;
+    auto &payloads = tileContext->payloads;
+    tileContext->payload.resize(payloadStride);
+    std::copy(payloads.end() - (int64_t) payloadStride, payloads.end(), tileContext->payload.begin());
+    payloads.resize(payloads.size() - payloadStride);
+    return tileContext->payload.data();
+}
+
+/**
+ * Gives every ray generator output of a worker a zeroed initial payload.
+ * @param tileContext   Scratch memory of the worker, its rays are already sized.
+ * @param payloadStride Size of a payload slot, zero if the pipeline declares no payload.
+ */
+static void preparePayloads(TileContext *tileContext, uint64_t payloadStride) {
+    auto &rays = tileContext->rays;
+    tileContext->generatedPayloads.assign(rays.size() * payloadStride, 0);
+    for (uint64_t i = 0; i < rays.size(); i++) {
+        rays[i].rayPayload = getPayload(&tileContext->generatedPayloads, i, payloadStride);
+    }
+}
+
+static void pushRay(RayBuffer *buffer, uint64_t rayID, Vector3D *origin, Vector3D *direction, RayResource *rayResource,
+                    const void *payload, uint64_t payloadStride) {
+    buffer->rayIDs.push_back(rayID);
+    buffer->originX.push_back(origin->x);
+    buffer->originY.push_back(origin->y);
+    buffer->originZ.push_back(origin->z);
+    buffer->directionX.push_back(direction->x);
+    buffer->directionY.push_back(direction->y);
+    buffer->directionZ.push_back(direction->z);
+    buffer->rayResources.push_back(rayResource);
+    pushPayload(&buffer->payloads, payload, payloadStride);
+}
+
+static void clearRays(RayBuffer *buffer) {
+    buffer->rayIDs.clear();
+    buffer->originX.clear();
+    buffer->originY.clear();
+    buffer->originZ.clear();
+    buffer->directionX.clear();
+    buffer->directionY.clear();
+    buffer->directionZ.clear();
+    buffer->rayResources.clear();
+    buffer->payloads.clear();
+}
+
+static void addColor(float *target, ShaderOutput *color) {
+    target[0] += color->color[0];
+    target[1] += color->color[1];
+    target[2] += color->color[2];
+}
+
+/**
+ * Hands the resource of a shaded ray on to one of its child rays, the last child takes it over and all others receive
+ * copies. Rays without children release their resource to the pool instead.
+ * @param rayResource   Resource of the shaded ray.
+ * @param child         Index of the child ray, called once for every child in order.
+ * @param childCount    Number of child rays.
+ * @param pool          Pool of the calling thread.
+ * @return              The resource of the child ray.
+ */
+static RayResource *passRayResource(RayResource *rayResource, uint64_t child, uint64_t childCount,
+                                    RayResourcePool *pool) {
+    return child + 1 == childCount ? rayResource : pool->copy(rayResource);
+}
+
+/**
+ * Pushes the child rays spawned by the shaders of a ray onto the stack of a worker, they inherit the payload and the
+ * resource of the ray. Rays without children release their resource to the pool instead.
+ * @param tileContext   Scratch memory of the worker.
+ * @param rayID         Id of the ray family.
+ * @param rayResource   Resource of the shaded ray.
+ * @param rayPayload    Payload of the shaded ray, nullptr if the pipeline declares no payload.
+ * @param newRays       Child rays spawned by the shaders of the ray.
+ * @param payloadStride Size of a payload slot, zero if the pipeline declares no payload.
+ */
+static void pushChildRays(TileContext *tileContext, int rayID, RayResource *rayResource, const void *rayPayload,
+                          RayGeneratorOutput *newRays, uint64_t payloadStride) {
+    uint64_t childCount = newRays->rays.size();
+    for (uint64_t i = 0; i < childCount; i++) {
+        auto &r = newRays->rays[i];
+        RayContainer rayContainer = {rayID, r.rayOrigin, r.rayDirection,
+                                     passRayResource(rayResource, i, childCount, &tileContext->rayResourcePool)};
+        tileContext->rayContainers.push_back(rayContainer);
+        pushPayload(&tileContext->payloads, rayPayload, payloadStride);
+    }
+    if (childCount == 0) tileContext->rayResourcePool.release(rayResource);
+}
+
+/**
+ * Takes a generated ray from the stack of a worker, the ray was already traced and shaded together with the rest of
+ * its tile, so only its child rays are pushed.
+ * @param tileContext   Scratch memory of the worker.
+ * @param payloadStride Size of a payload slot, zero if the pipeline declares no payload.
+ */
+static void popPrimaryRay(TileContext *tileContext, uint64_t payloadStride) {
+    auto &rayContainers = tileContext->rayContainers;
+    int id = rayContainers.back().rayID;
+    auto rayResource = rayContainers.back().rayResource;
+    void *rayPayload = popPayload(tileContext, payloadStride);
+    rayContainers.pop_back();
+
+    tileContext->primaryCount = rayContainers.size();
+    uint64_t slot = tileContext->primarySlots[tileContext->primaryOffset + tileContext->primaryCount];
+    pushChildRays(tileContext, id, rayResource, rayPayload, &tileContext->primaryRays[slot], payloadStride);
+}
+
+/**
+ * Traces up to WIDE_BVH_PACKET_SIZE rays as one packet, rays with diverging directions fall back to single ray
+ * traversal within the geometry.
+ * @param geometry      The geometry.
+ * @param intersections One entry per ray, initialized with the origin and direction of its ray, receives the result.
+ * @param count         Number of rays.
+ * @param closest       True to find the closest intersection of every ray, false for any intersection.
+ */
+static void traceRayPacket(CompiledDBVH *geometry, IntersectionInfo *intersections, uint64_t count, bool closest) {
+    Ray rays[WIDE_BVH_PACKET_SIZE];
+    for (uint64_t i = 0; i < count; i++) {
+        rays[i].origin = intersections[i].rayOrigin;
+        rays[i].direction = intersections[i].rayDirection;
+        rays[i].dirfrac.x = 1.0 / rays[i].direction.x;
+        rays[i].dirfrac.y = 1.0 / rays[i].direction.y;
+        rays[i].dirfrac.z = 1.0 / rays[i].direction.z;
+    }
+
+    uint64_t rayMask = count == WIDE_BVH_PACKET_SIZE ? ~0ull : (1ull << count) - 1;
+    if (closest) {
+        geometry->intersectFirstPacket(intersections, rays, rayMask);
+    } else {
+        geometry->intersectAnyPacket(intersections, rays, rayMask);
+    }
+}
+
+static void averagePixel(const float *pixel, float *color) {
+    float scale = pixel[3] > 0.0f ? 1.0f / pixel[3] : 0.0f;
+    color[0] = pixel[0] * scale;
+    color[1] = pixel[1] * scale;
+    color[2] = pixel[2] * scale;
+}
+
+/**
+ * Maps an output pixel onto the rendered resolution for bilinear filtering, pixel centers of both resolutions are
+ * aligned and coordinates beyond the border are clamped to it.
+ * @param outputPixel   Coordinate of the output pixel.
+ * @param scale         Ratio of the rendered to the output resolution.
+ * @param size          Rendered resolution along the axis.
+ * @param first         The lower rendered pixel.
+ * @param second        The upper rendered pixel.
+ * @param weight        Weight of the upper rendered pixel.
+ */
+static void mapPixel(int outputPixel, float scale, int size, int *first, int *second, float *weight) {
+    float position = std::clamp((outputPixel + 0.5f) * scale - 0.5f, 0.0f, (float) (size - 1));
+    *first = std::min((int) position, size - 1);
+    *second = std::min(*first + 1, size - 1);
+    *weight = position - (float) *first;
+}
+
 PipelineImplement::PipelineImplement(EngineNode *engine, int width, int height, Vector3D *cameraPosition,
                                      Vector3D *cameraDirection, Vector3D *cameraUp,
                                      std::vector<RayGeneratorShaderPackage> *rayGeneratorShaders,
@@ -51,329 +265,1147 @@ PipelineImplement::PipelineImplement(EngineNode *engine, int width, int height,
     }
 
     this->geometry = geometry;
-    result = new Texture{"Render", width, height, new unsigned char[width * height * 3]};
-
-    for (int i = 0; i < width * height * 3; i++) {
-        result->image[i] = 0;
-    }
+    mode = PipelineMode::DEPTH_FIRST;
+    compiledGeometry = nullptr;
+    geometryChanged = true;
+    frameBuffer = new FrameBuffer(width, height);
+    sampleCount = 0;
+    sampleProgress = 0;
+    samplesPerRun = 1;
+    accumulate = false;
+    priority = 0;
+    accumulationInvalid = true;
+    targetFrameTime = 0;
+    renderScale = 1.0;
+    pixelTime = 0;
+    payloadStride = 0;
+    cancellation = nullptr;
 }
 
 PipelineImplement::~PipelineImplement() {
     //delete geometry;
-    delete[] result->image;
-    delete result;
+    delete frameBuffer;
     delete pipelineInfo;
+    delete compiledGeometry;
     DBVHv2::deleteTree(geometry);
 }
 
 void PipelineImplement::setResolution(int resolutionWidth, int resolutionHeight) {
-    pipelineInfo->width = resolutionWidth;
-    pipelineInfo->height = resolutionHeight;
+    Texture *result = frameBuffer->getResult();
+    if (resolutionWidth == result->w && resolutionHeight == result->h) return;
+    frameBuffer->resize(resolutionWidth, resolutionHeight);
+    applyRenderScale();
+}
+
+void PipelineImplement::applyRenderScale() {
+    Texture *result = frameBuffer->getResult();
+    int width = std::max((int) std::lround(result->w * renderScale), 1);
+    int height = std::max((int) std::lround(result->h * renderScale), 1);
+    if (width == pipelineInfo->width && height == pipelineInfo->height) return;
+
+    pipelineInfo->width = width;
+    pipelineInfo->height = height;
+    frameBuffer->resizeAccumulation(width, height);
+    accumulationInvalid = true;
+}
+
+void PipelineImplement::adjustRenderScale(double frameTime) {
+    if (targetFrameTime <= 0) return;
+
+    // the duration of a run grows with the number of rendered pixels, so the controller estimates the time per pixel,
+    // which stays comparable across resolution changes, and follows drops in it more slowly than rises
+    double measuredPixelTime = frameTime / ((double) pipelineInfo->width * pipelineInfo->height);
+    if (pixelTime <= 0 || measuredPixelTime > pixelTime) {
+        pixelTime = measuredPixelTime;
+    } else {
+        pixelTime += (measuredPixelTime - pixelTime) * PIXEL_TIME_SMOOTHING;
+    }
+
+    Texture *result = frameBuffer->getResult();
+    double pixelBudget = targetFrameTime * FRAME_TIME_HEADROOM / pixelTime;
+    double scale = std::clamp(std::sqrt(pixelBudget / ((double) result->w * result->h)), MIN_RENDER_SCALE, 1.0);
+    if (std::abs(scale - renderScale) < renderScale * RENDER_SCALE_TOLERANCE && scale != 1.0) return;
+
+    renderScale = scale;
+    applyRenderScale();
 }
 
 void PipelineImplement::setCamera(Vector3D pos, Vector3D dir, Vector3D up) {
     pipelineInfo->cameraPosition = pos;
     pipelineInfo->cameraDirection = dir;
     pipelineInfo->cameraUp = up;
+    accumulationInvalid = true;
+}
+
+void PipelineImplement::setMode(PipelineMode pipelineMode) {
+    // both modes split a sample into different units, so a partially rendered sample is started over, which only
+    // gives some pixels an additional sample
+    if (mode != pipelineMode) sampleProgress = 0;
+    mode = pipelineMode;
+}
+
+void PipelineImplement::setSampling(int samples, bool accumulateSamples) {
+    samplesPerRun = std::max(samples, 1);
+    accumulate = accumulateSamples;
+}
+
+void PipelineImplement::setPriority(int pipelinePriority) {
+    priority = pipelinePriority;
+}
+
+void PipelineImplement::setRayPayload(uint64_t size, uint64_t alignment) {
+    // alignments are rounded up to a power of two, the payload buffers do not provide more than MAX_PAYLOAD_ALIGNMENT
+    uint64_t payloadAlignment = 1;
+    while (payloadAlignment < alignment && payloadAlignment < MAX_PAYLOAD_ALIGNMENT) payloadAlignment *= 2;
+    payloadStride = (size + payloadAlignment - 1) / payloadAlignment * payloadAlignment;
+}
+
+void PipelineImplement::setTargetFrameTime(double frameTime) {
+    targetFrameTime = std::max(frameTime, 0.0);
+    pixelTime = 0;
+    if (targetFrameTime == 0) {
+        renderScale = 1.0;
+        applyRenderScale();
+    }
+}
+
+void PipelineImplement::resetAccumulation() {
+    accumulationInvalid = true;
+}
+
+uint64_t PipelineImplement::getSampleCount() {
+    return accumulationInvalid ? 0 : sampleCount;
+}
+
+void PipelineImplement::setCancellation(const std::atomic_bool *cancelled) {
+    cancellation = cancelled;
+}
+
+bool PipelineImplement::isCancelled() {
+    return cancellation != nullptr && cancellation->load(std::memory_order_relaxed);
 }
 
 DBVHNode *PipelineImplement::getGeometry() {
     return geometry;
 }
 
+void PipelineImplement::invalidateGeometry() {
+    geometryChanged = true;
+    accumulationInvalid = true;
+}
+
 Object *PipelineImplement::getGeometryAsObject() {
     // TODO
     return nullptr;
 }
 
 int PipelineImplement::run() {
-    RayGeneratorOutput rays;
+    auto start = std::chrono::steady_clock::now();
+    prepare(!accumulate);
+    renderSamples(sampleCount + samplesPerRun, std::chrono::steady_clock::time_point::max());
+
+    // a cancelled execution left some tiles out, its samples are discarded and the result keeps the previous image
+    if (isCancelled()) {
+        accumulationInvalid = true;
+        return -1;
+    }
+    resolve();
 
-    std::vector<RayContainer> rayContainers;
+    adjustRenderScale(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    return 0;
+}
 
-    for (int i = 0; i < pipelineInfo->width * pipelineInfo->height * 3; i++) {
-        result->image[i] = 0;
+bool PipelineImplement::runProgressive(double timeBudget, uint64_t targetSampleCount) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double, std::milli>(timeBudget));
+
+    // progressive executions always continue where the previous one stopped
+    prepare(false);
+    if (targetSampleCount == 0) {
+        renderSamples(std::numeric_limits<uint64_t>::max(), deadline);
+    } else if (sampleCount < targetSampleCount) {
+        renderSamples(targetSampleCount, deadline);
     }
 
-    if (!pierceShaders.empty()) {
-        // worst case, full traversal
-        for (int x = 0; x < pipelineInfo->width; x++) {
-            for (int y = 0; y < pipelineInfo->height; y++) {
-                for (auto &generator: rayGeneratorShaders) {
-                    int rayID = x + y * pipelineInfo->width;
-                    generator.second.rayGeneratorShader->shade(rayID, pipelineInfo, &generator.second.shaderResources,
-                                                               &rays);
-
-                    for (auto &ray: rays.rays) {
-                        RayContainer rayContainer = {rayID, ray.rayOrigin, ray.rayDirection, nullptr};
-                        rayContainers.push_back(rayContainer);
-                    }
+    if (isCancelled()) {
+        accumulationInvalid = true;
+        return false;
+    }
+    resolve();
+
+    return targetSampleCount != 0 && sampleCount >= targetSampleCount;
+}
 
-                    rays.rays.clear();
-
-                    while (!rayContainers.empty()) {
-                        int id = rayContainers.back().rayID;
-                        auto rayResource = rayContainers.back().rayResource;
-                        Ray ray{};
-                        ray.origin = rayContainers.back().rayOrigin;
-                        ray.direction = rayContainers.back().rayDirection;
-                        ray.dirfrac.x = 1.0 / ray.direction.x;
-                        ray.dirfrac.y = 1.0 / ray.direction.y;
-                        ray.dirfrac.z = 1.0 / ray.direction.z;
-
-                        std::vector<IntersectionInfo *> infos;
-                        DBVHv2::intersectAll(geometry, &infos, &ray);
-
-                        RayGeneratorOutput newRays;
-
-                        for (auto &pierceShader: pierceShaders) {
-                            PierceShaderInput pierceShaderInput = {infos};
-                            auto pixel = pierceShader.second.pierceShader->shade(id, pipelineInfo, &pierceShaderInput,
-                                                                                 &pierceShader.second.shaderResources,
-                                                                                 &rayResource, &newRays);
-                            result->image[id * 3] += pixel.color[0];
-                            result->image[id * 3 + 1] += pixel.color[1];
-                            result->image[id * 3 + 2] += pixel.color[2];
-                        }
-
-                        IntersectionInfo closest = {false, std::numeric_limits<double>::max(), ray.origin,
-                                                    ray.direction, 0, 0, 0, 0, 0};
-                        bool hitAny = false;
-                        for (auto info: infos) {
-                            if (info->hit) {
-                                hitAny = true;
-                                if (closest.distance > info->distance) {
-                                    closest = *info;
-                                }
-                            }
-                        }
-
-                        if (closest.hit) {
-                            for (auto &hitShader: hitShaders) {
-                                HitShaderInput hitShaderInput = {&closest};
-                                auto pixel = hitShader.second.hitShader->shade(id, pipelineInfo, &hitShaderInput,
-                                                                               &hitShader.second.shaderResources,
-                                                                               &rayResource, &newRays);
-                                result->image[id * 3] += pixel.color[0];
-                                result->image[id * 3 + 1] += pixel.color[1];
-                                result->image[id * 3 + 2] += pixel.color[2];
-                            }
-                        }
-
-                        if (closest.hit) {
-                            for (auto &occlusionShader: occlusionShaders) {
-                                OcclusionShaderInput occlusionShaderInput = {ray.origin, ray.direction};
-                                auto pixel = occlusionShader.second.occlusionShader->shade(id, pipelineInfo,
-                                                                                           &occlusionShaderInput,
-                                                                                           &occlusionShader.second.shaderResources,
-                                                                                           &rayResource,
-                                                                                           &newRays);
-                                result->image[id * 3] += pixel.color[0];
-                                result->image[id * 3 + 1] += pixel.color[1];
-                                result->image[id * 3 + 2] += pixel.color[2];
-                            }
-                        }
-
-                        if (!hitAny) {
-                            for (auto &missShader: missShaders) {
-                                MissShaderInput missShaderInput = {ray.origin, ray.direction};
-                                auto pixel = missShader.second.missShader->shade(id, pipelineInfo, &missShaderInput,
-                                                                                 &missShader.second.shaderResources,
-                                                                                 &rayResource, &newRays);
-                                result->image[id * 3] += pixel.color[0];
-                                result->image[id * 3 + 1] += pixel.color[1];
-                                result->image[id * 3 + 2] += pixel.color[2];
-                            }
-                        }
-
-                        rayContainers.pop_back();
-
-                        for (auto &r: newRays.rays) {
-                            RayContainer rayContainer = {id, r.rayDirection, r.rayOrigin,
-                                                         rayResource == nullptr ? nullptr : rayResource->clone()};
-                            rayContainers.push_back(rayContainer);
-                        }
-
-                        while (!infos.empty()) {
-                            delete infos.back();
-                            infos.pop_back();
-                        }
+void PipelineImplement::runAll(std::vector<PipelineImplement *> *pipelines, TaskScheduler *taskScheduler) {
+    auto start = std::chrono::steady_clock::now();
+
+    // wavefront pipelines and pipelines in the middle of a progressively rendered sample are executed on their own, the
+    // tiles of all others go into a single schedule
+    std::vector<PipelineImplement *> tiled;
+    TaskGroup separate;
+    for (auto pipeline: *pipelines) {
+        bool partial = pipeline->accumulate && !pipeline->accumulationInvalid && pipeline->sampleProgress != 0;
+        if (pipeline->mode == PipelineMode::WAVEFRONT || partial) {
+            taskScheduler->spawn(&separate, [pipeline] {
+                pipeline->run();
+            });
+        } else {
+            tiled.push_back(pipeline);
+        }
+    }
+    std::stable_sort(tiled.begin(), tiled.end(), [](PipelineImplement *a, PipelineImplement *b) {
+        return a->priority > b->priority;
+    });
+
+    taskScheduler->parallelFor(tiled.size(), [&tiled](uint64_t i, unsigned int workerId) {
+        tiled[i]->prepare(!tiled[i]->accumulate);
+    });
+
+    // every round renders the next sample of all pipelines that need one, tiles of pipelines with a higher priority come
+    // first and tiles of pipelines with the same priority take turns
+    std::vector<ScheduledTile> schedule;
+    for (int round = 0;; round++) {
+        schedule.clear();
+        for (uint64_t first = 0; first < tiled.size();) {
+            uint64_t last = first;
+            while (last < tiled.size() && tiled[last]->priority == tiled[first]->priority) last++;
+
+            bool remaining = true;
+            for (uint64_t tile = 0; remaining; tile++) {
+                remaining = false;
+                for (uint64_t i = first; i < last; i++) {
+                    auto pipeline = tiled[i];
+                    auto pipelineInfo = pipeline->pipelineInfo;
+                    uint64_t tileCount = (uint64_t) ((pipelineInfo->width + TILE_SIZE - 1) / TILE_SIZE) *
+                                         ((pipelineInfo->height + TILE_SIZE - 1) / TILE_SIZE);
+                    if (round < pipeline->samplesPerRun && tile < tileCount) {
+                        schedule.push_back({pipeline, tile});
+                        remaining = true;
                     }
                 }
             }
+            first = last;
         }
-    } else if (!hitShaders.empty()) {
-        // normal case, early out when closest found
-        for (int x = 0; x < pipelineInfo->width; x++) {
-            for (int y = 0; y < pipelineInfo->height; y++) {
-                for (auto &generator: rayGeneratorShaders) {
-                    int rayID = x + y * pipelineInfo->width;
-                    generator.second.rayGeneratorShader->shade(rayID, pipelineInfo, &generator.second.shaderResources,
-                                                               &rays);
-
-                    for (auto &ray: rays.rays) {
-                        RayContainer rayContainer = {rayID, ray.rayOrigin, ray.rayDirection, nullptr};
-                        rayContainers.push_back(rayContainer);
-                    }
+        if (schedule.empty()) break;
 
-                    rays.rays.clear();
-
-                    while (!rayContainers.empty()) {
-                        int id = rayContainers.back().rayID;
-                        auto rayResource = rayContainers.back().rayResource;
-                        Ray ray{};
-                        ray.origin = rayContainers.back().rayOrigin;
-                        ray.direction = rayContainers.back().rayDirection;
-                        ray.dirfrac.x = 1.0 / ray.direction.x;
-                        ray.dirfrac.y = 1.0 / ray.direction.y;
-                        ray.dirfrac.z = 1.0 / ray.direction.z;
-
-                        IntersectionInfo info = {false, std::numeric_limits<double>::max(), ray.origin, ray.direction,
-                                                 0, 0, 0, 0, 0};
-                        DBVHv2::intersectFirst(geometry, &info, &ray);
-
-                        RayGeneratorOutput newRays;
-
-                        if (info.hit) {
-                            for (auto &hitShader: hitShaders) {
-                                HitShaderInput hitShaderInput = {&info};
-                                auto pixel = hitShader.second.hitShader->shade(id, pipelineInfo, &hitShaderInput,
-                                                                               &hitShader.second.shaderResources,
-                                                                               &rayResource, &newRays);
-                                result->image[id * 3] += pixel.color[0];
-                                result->image[id * 3 + 1] += pixel.color[1];
-                                result->image[id * 3 + 2] += pixel.color[2];
-                            }
-
-                            for (auto &occlusionShader: occlusionShaders) {
-                                OcclusionShaderInput occlusionShaderInput = {ray.origin, ray.direction};
-                                auto pixel = occlusionShader.second.occlusionShader->shade(id, pipelineInfo,
-                                                                                           &occlusionShaderInput,
-                                                                                           &occlusionShader.second.shaderResources,
-                                                                                           &rayResource,
-                                                                                           &newRays);
-                                result->image[id * 3] += pixel.color[0];
-                                result->image[id * 3 + 1] += pixel.color[1];
-                                result->image[id * 3 + 2] += pixel.color[2];
-                            }
-                        } else {
-                            for (auto &missShader: missShaders) {
-                                MissShaderInput missShaderInput = {ray.origin, ray.direction};
-                                auto pixel = missShader.second.missShader->shade(id, pipelineInfo, &missShaderInput,
-                                                                                 &missShader.second.shaderResources,
-                                                                                 &rayResource, &newRays);
-                                result->image[id * 3] += pixel.color[0];
-                                result->image[id * 3 + 1] += pixel.color[1];
-                                result->image[id * 3 + 2] += pixel.color[2];
-                            }
-                        }
-
-                        rayContainers.pop_back();
-
-                        for (auto &r: newRays.rays) {
-                            RayContainer rayContainer = {id, r.rayDirection, r.rayOrigin,
-                                                         rayResource == nullptr ? nullptr : rayResource->clone()};
-                            rayContainers.push_back(rayContainer);
-                        }
-                    }
-                }
+        for (auto pipeline: tiled) {
+            pipeline->pipelineInfo->sampleIndex = pipeline->sampleCount;
+        }
+
+        // tiles are handed out in order, so that every thread works on the front of the schedule
+        std::atomic_uint64_t next{0};
+        auto render = [&schedule, &next, taskScheduler] {
+            unsigned int workerId = taskScheduler->getWorkerId();
+            for (uint64_t i = next.fetch_add(1); i < schedule.size(); i = next.fetch_add(1)) {
+                auto pipeline = schedule[i].pipeline;
+                int tilesX = (pipeline->pipelineInfo->width + TILE_SIZE - 1) / TILE_SIZE;
+                pipeline->renderTile((int) (schedule[i].tile % tilesX), (int) (schedule[i].tile / tilesX),
+                                     &pipeline->tileContexts[workerId]);
             }
+        };
+        TaskGroup taskGroup;
+        for (unsigned int i = 1; i < taskScheduler->getThreadCount(); i++) {
+            taskScheduler->spawn(&taskGroup, render);
+        }
+        render();
+        taskScheduler->wait(&taskGroup);
+
+        for (auto pipeline: tiled) {
+            if (round < pipeline->samplesPerRun) pipeline->sampleCount++;
         }
+    }
+
+    for (auto pipeline: tiled) {
+        pipeline->resolve();
+    }
+
+    // the tiles of all pipelines are interleaved, so every one of them took as long as the whole schedule
+    double frameTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    for (auto pipeline: tiled) {
+        pipeline->adjustRenderScale(frameTime);
+    }
+    taskScheduler->wait(&separate);
+}
+
+void PipelineImplement::prepare(bool resetAccumulation) {
+    // samples are only averaged as long as nothing changed that alters the image
+    if (resetAccumulation || accumulationInvalid) {
+        frameBuffer->clearAccumulation();
+        sampleCount = 0;
+        sampleProgress = 0;
+        accumulationInvalid = false;
+    }
+
+    // traversal runs on a flattened copy of the geometry, which is only rebuilt after the geometry changed
+    if (geometryChanged) {
+        delete compiledGeometry;
+        compiledGeometry = new CompiledDBVH(geometry);
+        geometryChanged = false;
+    }
+
+    auto taskScheduler = engineNode->getTaskScheduler();
+    if (tileContexts.size() < taskScheduler->getThreadCount()) {
+        tileContexts.resize(taskScheduler->getThreadCount());
+    }
+    if (wavefrontContext.intersectionArenas.size() < taskScheduler->getThreadCount()) {
+        wavefrontContext.intersectionArenas.resize(taskScheduler->getThreadCount());
+    }
+}
+
+void PipelineImplement::renderSamples(uint64_t targetSampleCount, std::chrono::steady_clock::time_point deadline) {
+    auto taskScheduler = engineNode->getTaskScheduler();
+    bool bounded = deadline != std::chrono::steady_clock::time_point::max();
+    int pixelCount = pipelineInfo->width * pipelineInfo->height;
+    int tilesX = (pipelineInfo->width + TILE_SIZE - 1) / TILE_SIZE;
+    int tilesY = (pipelineInfo->height + TILE_SIZE - 1) / TILE_SIZE;
+
+    // a sample is rendered in units of tiles, or of small waves in wavefront mode, which are merged into full waves
+    // unless the deadline has to be checked
+    uint64_t unitCount;
+    uint64_t batchSize;
+    if (mode == PipelineMode::WAVEFRONT) {
+        unitCount = (pixelCount + PROGRESSIVE_WAVEFRONT_SIZE - 1) / PROGRESSIVE_WAVEFRONT_SIZE;
+        batchSize = bounded ? 1 : WAVEFRONT_SIZE / PROGRESSIVE_WAVEFRONT_SIZE;
     } else {
-        // best case, early out when any found
-        for (int x = 0; x < pipelineInfo->width; x++) {
-            for (int y = 0; y < pipelineInfo->height; y++) {
-                for (auto &generator: rayGeneratorShaders) {
-                    int rayID = x + y * pipelineInfo->width;
-                    generator.second.rayGeneratorShader->shade(rayID, pipelineInfo, &generator.second.shaderResources,
-                                                               &rays);
-                    for (auto &ray: rays.rays) {
-                        RayContainer rayContainer = {rayID, ray.rayOrigin, ray.rayDirection, nullptr};
-                        rayContainers.push_back(rayContainer);
-                    }
+        unitCount = (uint64_t) tilesX * tilesY;
+        // without a deadline all tiles of a sample are distributed at once, with one the deadline is checked after
+        // every few tiles per worker
+        batchSize = bounded ? taskScheduler->getThreadCount() * TILES_PER_WORKER : unitCount;
+    }
+    if (unitCount == 0) return;
+
+    while (sampleCount < targetSampleCount) {
+        pipelineInfo->sampleIndex = sampleCount;
+        uint64_t last = std::min(sampleProgress + batchSize, unitCount);
+
+        if (mode == PipelineMode::WAVEFRONT) {
+            renderWave((int) sampleProgress * PROGRESSIVE_WAVEFRONT_SIZE,
+                       std::min((int) last * PROGRESSIVE_WAVEFRONT_SIZE, pixelCount));
+        } else {
+            // tiles write to disjoint pixels, so they can be rendered without any synchronisation
+            uint64_t first = sampleProgress;
+            taskScheduler->parallelFor(last - first, [this, first, tilesX](uint64_t i, unsigned int workerId) {
+                if (isCancelled()) return;
+                uint64_t tile = first + i;
+                renderTile((int) (tile % tilesX), (int) (tile / tilesX), &tileContexts[workerId]);
+            });
+        }
 
-                    rays.rays.clear();
-
-                    while (!rayContainers.empty()) {
-                        int id = rayContainers.back().rayID;
-                        auto rayResource = rayContainers.back().rayResource;
-                        Ray ray{};
-                        ray.origin = rayContainers.back().rayOrigin;
-                        ray.direction = rayContainers.back().rayDirection;
-                        ray.dirfrac.x = 1.0 / ray.direction.x;
-                        ray.dirfrac.y = 1.0 / ray.direction.y;
-                        ray.dirfrac.z = 1.0 / ray.direction.z;
-
-                        IntersectionInfo info = {false, std::numeric_limits<double>::max(), ray.origin, ray.direction,
-                                                 0, 0, 0, 0, 0};
-                        DBVHv2::intersectAny(geometry, &info, &ray);
-
-                        RayGeneratorOutput newRays;
-
-                        if (info.hit) {
-                            for (auto &occlusionShader: occlusionShaders) {
-                                OcclusionShaderInput occlusionShaderInput = {ray.origin, ray.direction};
-                                auto pixel = occlusionShader.second.occlusionShader->shade(id, pipelineInfo,
-                                                                                           &occlusionShaderInput,
-                                                                                           &occlusionShader.second.shaderResources,
-                                                                                           &rayResource,
-                                                                                           &newRays);
-                                result->image[id * 3] += pixel.color[0];
-                                result->image[id * 3 + 1] += pixel.color[1];
-                                result->image[id * 3 + 2] += pixel.color[2];
-                            }
-                        } else {
-                            for (auto &missShader: missShaders) {
-                                MissShaderInput missShaderInput = {ray.origin, ray.direction};
-                                auto pixel = missShader.second.missShader->shade(id, pipelineInfo, &missShaderInput,
-                                                                                 &missShader.second.shaderResources,
-                                                                                 &rayResource, &newRays);
-                                result->image[id * 3] += pixel.color[0];
-                                result->image[id * 3 + 1] += pixel.color[1];
-                                result->image[id * 3 + 2] += pixel.color[2];
-                            }
-                        }
-
-                        rayContainers.pop_back();
-
-                        for (auto &r: newRays.rays) {
-                            RayContainer rayContainer = {id, r.rayDirection, r.rayOrigin,
-                                                         rayResource == nullptr ? nullptr : rayResource->clone()};
-                            rayContainers.push_back(rayContainer);
-                        }
-                    }
+        sampleProgress = last;
+        if (sampleProgress == unitCount) {
+            sampleProgress = 0;
+            sampleCount++;
+        }
+
+        if (isCancelled() || (bounded && std::chrono::steady_clock::now() >= deadline)) break;
+    }
+}
+
+void PipelineImplement::resolve() {
+    int width = pipelineInfo->width;
+    int height = pipelineInfo->height;
+    float *accumulation = frameBuffer->getAccumulation();
+    Texture *result = frameBuffer->getResult();
+    unsigned char *image = result->image;
+    auto taskScheduler = engineNode->getTaskScheduler();
+
+    // the result holds the average of all samples, clamped to the range of the 24 bit image
+    if (width == result->w && height == result->h) {
+        taskScheduler->parallelFor(height, [width, accumulation, image](uint64_t row, unsigned int workerId) {
+            float color[3];
+            for (uint64_t i = row * width; i < (row + 1) * width; i++) {
+                averagePixel(&accumulation[i * 4], color);
+                for (int channel = 0; channel < 3; channel++) {
+                    image[i * 3 + channel] = (unsigned char) std::min(color[channel] + 0.5f, 255.0f);
                 }
             }
+        });
+        return;
+    }
+
+    // a lower rendered resolution is upscaled bilinearly into the output resolution
+    int outputWidth = result->w;
+    float scaleX = (float) width / (float) result->w;
+    float scaleY = (float) height / (float) result->h;
+    taskScheduler->parallelFor(result->h, [=](uint64_t row, unsigned int workerId) {
+        int y0, y1;
+        float weightY;
+        mapPixel((int) row, scaleY, height, &y0, &y1, &weightY);
+
+        float corners[4][3];
+        for (int x = 0; x < outputWidth; x++) {
+            int x0, x1;
+            float weightX;
+            mapPixel(x, scaleX, width, &x0, &x1, &weightX);
+            averagePixel(&accumulation[((uint64_t) y0 * width + x0) * 4], corners[0]);
+            averagePixel(&accumulation[((uint64_t) y0 * width + x1) * 4], corners[1]);
+            averagePixel(&accumulation[((uint64_t) y1 * width + x0) * 4], corners[2]);
+            averagePixel(&accumulation[((uint64_t) y1 * width + x1) * 4], corners[3]);
+
+            unsigned char *pixel = &image[(row * outputWidth + x) * 3];
+            for (int channel = 0; channel < 3; channel++) {
+                float top = corners[0][channel] + (corners[1][channel] - corners[0][channel]) * weightX;
+                float bottom = corners[2][channel] + (corners[3][channel] - corners[2][channel]) * weightX;
+                float color = top + (bottom - top) * weightY;
+                pixel[channel] = (unsigned char) std::min(color + 0.5f, 255.0f);
+            }
+        }
+    });
+}
+
+void PipelineImplement::renderTile(int tileX, int tileY, TileContext *tileContext) {
+    float *accumulation = frameBuffer->getAccumulation();
+    int startX = tileX * TILE_SIZE;
+    int startY = tileY * TILE_SIZE;
+    int endX = std::min(startX + TILE_SIZE, pipelineInfo->width);
+    int endY = std::min(startY + TILE_SIZE, pipelineInfo->height);
+
+    auto &rayIDs = tileContext->rayIDs;
+    rayIDs.clear();
+    for (int x = startX; x < endX; x++) {
+        for (int y = startY; y < endY; y++) {
+            rayIDs.push_back(x + y * pipelineInfo->width);
         }
     }
 
-    return 0;
+    // the rays of the whole tile are generated up front, one batch per generator
+    uint64_t pixelCount = rayIDs.size();
+    tileContext->rays.resize(pixelCount * rayGeneratorShaders.size());
+    preparePayloads(tileContext, payloadStride);
+    uint64_t offset = 0;
+    for (auto &generator: rayGeneratorShaders) {
+        generator.second.rayGeneratorShader->shadeBatch(pixelCount, rayIDs.data(), pipelineInfo,
+                                                        &generator.second.shaderResources,
+                                                        &tileContext->rays[offset]);
+        offset += pixelCount;
+    }
+
+    // the generated rays of the whole tile are shaded in batches, only their children are traced ray by ray
+    shadePrimaryRays(tileContext);
+
+    for (uint64_t pixel = 0; pixel < pixelCount; pixel++) {
+        for (uint64_t generator = 0; generator < rayGeneratorShaders.size(); generator++) {
+            int rayID = (int) rayIDs[pixel];
+            auto &rays = tileContext->rays[generator * pixelCount + pixel];
+
+            tileContext->primaryOffset = tileContext->primaryOffsets[generator * pixelCount + pixel];
+            tileContext->primaryCount = rays.rays.size();
+
+            for (uint64_t i = 0; i < rays.rays.size(); i++) {
+                uint64_t slot = tileContext->primarySlots[tileContext->primaryOffset + i];
+                RayContainer rayContainer = {rayID, rays.rays[i].rayOrigin, rays.rays[i].rayDirection,
+                                             tileContext->primaryResources[slot]};
+                tileContext->rayContainers.push_back(rayContainer);
+                pushPayload(&tileContext->payloads, getPayload(&tileContext->primaryPayloads, slot, payloadStride),
+                            payloadStride);
+            }
+
+            rays.rays.clear();
+
+            if (!pierceShaders.empty()) {
+                // worst case, full traversal
+                traceAll(tileContext);
+            } else if (!hitShaders.empty()) {
+                // normal case, early out when closest found
+                traceFirst(tileContext);
+            } else {
+                // best case, early out when any found
+                traceAny(tileContext);
+            }
+        }
+
+        accumulation[rayIDs[pixel] * 4 + 3] += 1.0f;
+    }
+}
+
+void PipelineImplement::tracePrimaryRays(TileContext *tileContext) {
+    auto &intersections = tileContext->primaryIntersections;
+    auto &offsets = tileContext->primaryOffsets;
+    intersections.clear();
+    offsets.resize(tileContext->rays.size());
+    for (uint64_t i = 0; i < tileContext->rays.size(); i++) {
+        offsets[i] = intersections.size();
+        for (auto &ray: tileContext->rays[i].rays) {
+            intersections.push_back({false, std::numeric_limits<double>::max(), ray.rayOrigin, ray.rayDirection,
+                                     0, 0, 0, 0, 0});
+        }
+    }
+
+    if (pierceShaders.empty()) {
+        // consecutive rays belong to neighbouring pixels of the same generator
+        for (uint64_t first = 0; first < intersections.size(); first += WIDE_BVH_PACKET_SIZE) {
+            uint64_t count = std::min<uint64_t>(WIDE_BVH_PACKET_SIZE, intersections.size() - first);
+            traceRayPacket(compiledGeometry, &intersections[first], count, !hitShaders.empty());
+        }
+        return;
+    }
+
+    // pierce shaders need every intersection, which is only found by single ray traversal, the intersections of all
+    // generated rays are kept until the tile is shaded
+    auto &pierceInputs = tileContext->primaryPierceInputs;
+    pierceInputs.resize(intersections.size());
+    tileContext->intersectionArena.reset();
+    for (uint64_t i = 0; i < intersections.size(); i++) {
+        Ray ray{};
+        ray.origin = intersections[i].rayOrigin;
+        ray.direction = intersections[i].rayDirection;
+        ray.dirfrac.x = 1.0 / ray.direction.x;
+        ray.dirfrac.y = 1.0 / ray.direction.y;
+        ray.dirfrac.z = 1.0 / ray.direction.z;
+
+        auto &infos = pierceInputs[i].intersectionInfo;
+        infos.clear();
+        compiledGeometry->intersectAll(&infos, &tileContext->intersectionArena, &ray);
+        for (auto candidate: infos) {
+            if (candidate->hit && intersections[i].distance > candidate->distance) {
+                intersections[i] = *candidate;
+            }
+        }
+    }
+}
+
+void PipelineImplement::shadePrimaryRays(TileContext *tileContext) {
+    float *accumulation = frameBuffer->getAccumulation();
+    bool traceAll = !pierceShaders.empty();
+
+    tracePrimaryRays(tileContext);
+
+    // compaction as in wavefront mode, rays that hit the geometry go to the front and rays that missed it to the back,
+    // rays in between only hit something behind the closest distance
+    auto &intersections = tileContext->primaryIntersections;
+    auto &primaryPierceInputs = tileContext->primaryPierceInputs;
+    auto &order = tileContext->primaryOrder;
+    uint64_t rayCount = intersections.size();
+    order.resize(rayCount);
+    for (uint64_t i = 0; i < rayCount; i++) {
+        order[i] = i;
+    }
+    auto hitEnd = std::partition(order.begin(), order.end(), [&intersections](uint64_t i) {
+        return intersections[i].hit;
+    });
+    auto missStart = std::partition(hitEnd, order.end(), [&primaryPierceInputs, traceAll](uint64_t i) {
+        if (!traceAll) return false;
+        for (auto candidate: primaryPierceInputs[i].intersectionInfo) {
+            if (candidate->hit) return true;
+        }
+        return false;
+    });
+    uint64_t hitCount = hitEnd - order.begin();
+    uint64_t missBegin = missStart - order.begin();
+
+    auto &slots = tileContext->primarySlots;
+    slots.resize(rayCount);
+    for (uint64_t i = 0; i < rayCount; i++) {
+        slots[order[i]] = i;
+    }
+
+    auto &ids = tileContext->primaryIDs;
+    auto &payloads = tileContext->primaryPayloads;
+    auto &rayResources = tileContext->primaryResources;
+    auto &newRays = tileContext->primaryRays;
+    auto &shaderOutputs = tileContext->primaryOutputs;
+    auto &hitInputs = tileContext->hitInputs;
+    auto &occlusionInputs = tileContext->occlusionInputs;
+    auto &missInputs = tileContext->missInputs;
+    auto &pierceInputs = tileContext->pierceInputs;
+    ids.resize(rayCount);
+    payloads.resize(rayCount * payloadStride);
+    rayResources.assign(rayCount, nullptr);
+    newRays.resize(rayCount);
+    shaderOutputs.resize(rayCount);
+    hitInputs.resize(hitCount);
+    occlusionInputs.resize(hitCount);
+    missInputs.resize(rayCount - missBegin);
+    if (traceAll) pierceInputs.resize(rayCount);
+
+    // every generated ray receives its own copy of the payload of its generator output
+    uint64_t pixelCount = tileContext->rayIDs.size();
+    for (uint64_t entry = 0; entry < tileContext->rays.size(); entry++) {
+        auto &rays = tileContext->rays[entry];
+        for (uint64_t ray = 0; ray < rays.rays.size(); ray++) {
+            uint64_t source = tileContext->primaryOffsets[entry] + ray;
+            uint64_t slot = slots[source];
+            ids[slot] = tileContext->rayIDs[entry % pixelCount];
+            newRays[slot].rays.clear();
+
+            void *rayPayload = getPayload(&payloads, slot, payloadStride);
+            if (rayPayload != nullptr) {
+                auto bytes = static_cast<const unsigned char *>(rays.rayPayload);
+                std::copy(bytes, bytes + payloadStride, static_cast<unsigned char *>(rayPayload));
+            }
+
+            Vector3D &origin = rays.rays[ray].rayOrigin;
+            Vector3D &direction = rays.rays[ray].rayDirection;
+            if (slot < hitCount) {
+                hitInputs[slot] = {&intersections[source], rayPayload};
+                occlusionInputs[slot] = {origin, direction, rayPayload};
+            } else if (slot >= missBegin) {
+                missInputs[slot - missBegin] = {origin, direction, rayPayload};
+            }
+            if (traceAll) {
+                std::swap(pierceInputs[slot].intersectionInfo, primaryPierceInputs[source].intersectionInfo);
+                pierceInputs[slot].rayPayload = rayPayload;
+            }
+        }
+    }
+
+    // runs a single shader over a contiguous range of the compacted rays and adds the colors to their pixels
+    auto batch = [&](uint64_t begin, uint64_t end, const auto &shade) {
+        if (begin == end) return;
+        shade(begin, end - begin);
+        for (uint64_t i = begin; i < end; i++) {
+            addColor(&accumulation[ids[i] * 4], &shaderOutputs[i]);
+        }
+    };
+
+    // the shaders of a single ray are called in the same order as for the rays traced one by one
+    for (auto &pierceShader: pierceShaders) {
+        batch(0, rayCount, [&](uint64_t first, uint64_t count) {
+            pierceShader.second.pierceShader->shadeBatch(count, &ids[first], pipelineInfo, &pierceInputs[first],
+                                                         &pierceShader.second.shaderResources,
+                                                         &rayResources[first], &newRays[first],
+                                                         &shaderOutputs[first]);
+        });
+    }
+
+    for (auto &hitShader: hitShaders) {
+        batch(0, hitCount, [&](uint64_t first, uint64_t count) {
+            hitShader.second.hitShader->shadeBatch(count, &ids[first], pipelineInfo, &hitInputs[first],
+                                                   &hitShader.second.shaderResources, &rayResources[first],
+                                                   &newRays[first], &shaderOutputs[first]);
+        });
+    }
+
+    for (auto &occlusionShader: occlusionShaders) {
+        batch(0, hitCount, [&](uint64_t first, uint64_t count) {
+            occlusionShader.second.occlusionShader->shadeBatch(count, &ids[first], pipelineInfo,
+                                                               &occlusionInputs[first],
+                                                               &occlusionShader.second.shaderResources,
+                                                               &rayResources[first], &newRays[first],
+                                                               &shaderOutputs[first]);
+        });
+    }
+
+    for (auto &missShader: missShaders) {
+        batch(missBegin, rayCount, [&](uint64_t first, uint64_t count) {
+            missShader.second.missShader->shadeBatch(count, &ids[first], pipelineInfo,
+                                                     &missInputs[first - missBegin],
+                                                     &missShader.second.shaderResources, &rayResources[first],
+                                                     &newRays[first], &shaderOutputs[first]);
+        });
+    }
+
+    // the intersections live in the arena of the worker, which is reset by the first traced child ray
+    for (auto &pierceInput: pierceInputs) {
+        pierceInput.intersectionInfo.clear();
+    }
+}
+
+void PipelineImplement::renderWave(int firstPixel, int lastPixel) {
+    generateWavefront(firstPixel, lastPixel);
+
+    // every generation is traced and shaded as a whole, the shaders spawn the next one
+    while (!wavefrontContext.rays.rayIDs.empty()) {
+        traceWavefront();
+        shadeWavefront();
+        std::swap(wavefrontContext.rays, wavefrontContext.nextRays);
+        clearRays(&wavefrontContext.nextRays);
+    }
+}
+
+void PipelineImplement::generateWavefront(int firstPixel, int lastPixel) {
+    auto taskScheduler = engineNode->getTaskScheduler();
+    uint64_t pixelCount = lastPixel - firstPixel;
+    uint64_t chunkCount = (pixelCount + WAVEFRONT_CHUNK_SIZE - 1) / WAVEFRONT_CHUNK_SIZE;
+
+    float *accumulation = frameBuffer->getAccumulation();
+
+    // every worker collects the rays it generates, the order of the rays does not change the image
+    taskScheduler->parallelFor(chunkCount, [&](uint64_t chunk, unsigned int workerId) {
+        auto tileContext = &tileContexts[workerId];
+        int first = firstPixel + (int) (chunk * WAVEFRONT_CHUNK_SIZE);
+        int last = std::min(first + (int) WAVEFRONT_CHUNK_SIZE, lastPixel);
+
+        tileContext->rayIDs.clear();
+        for (int rayID = first; rayID < last; rayID++) {
+            tileContext->rayIDs.push_back(rayID);
+            accumulation[rayID * 4 + 3] += 1.0f;
+        }
+        tileContext->rays.resize(last - first);
+
+        for (auto &generator: rayGeneratorShaders) {
+            preparePayloads(tileContext, payloadStride);
+            generator.second.rayGeneratorShader->shadeBatch(last - first, tileContext->rayIDs.data(), pipelineInfo,
+                                                            &generator.second.shaderResources,
+                                                            tileContext->rays.data());
+
+            for (int i = 0; i < last - first; i++) {
+                for (auto &ray: tileContext->rays[i].rays) {
+                    RayContainer rayContainer = {first + i, ray.rayOrigin, ray.rayDirection, nullptr};
+                    tileContext->rayContainers.push_back(rayContainer);
+                    pushPayload(&tileContext->payloads, tileContext->rays[i].rayPayload, payloadStride);
+                }
+                tileContext->rays[i].rays.clear();
+            }
+        }
+    });
+
+    for (auto &tileContext: tileContexts) {
+        auto &rayContainers = tileContext.rayContainers;
+        for (uint64_t i = 0; i < rayContainers.size(); i++) {
+            pushRay(&wavefrontContext.rays, rayContainers[i].rayID, &rayContainers[i].rayOrigin,
+                    &rayContainers[i].rayDirection, rayContainers[i].rayResource,
+                    getPayload(&tileContext.payloads, i, payloadStride), payloadStride);
+        }
+        rayContainers.clear();
+        tileContext.payloads.clear();
+    }
+}
+
+void PipelineImplement::traceWavefront() {
+    auto &rays = wavefrontContext.rays;
+    uint64_t rayCount = rays.rayIDs.size();
+    bool traceAll = !pierceShaders.empty();
+    bool traceFirst = !hitShaders.empty();
+
+    wavefrontContext.intersections.resize(rayCount);
+    if (traceAll) wavefrontContext.pierceInputs.resize(rayCount);
+
+    // the entries of the previous generation were released at the end of its shading
+    for (auto &arena: wavefrontContext.intersectionArenas) {
+        arena.reset();
+    }
+
+    uint64_t chunkCount = (rayCount + WAVEFRONT_CHUNK_SIZE - 1) / WAVEFRONT_CHUNK_SIZE;
+    engineNode->getTaskScheduler()->parallelFor(chunkCount, [&](uint64_t chunk, unsigned int workerId) {
+        uint64_t begin = chunk * WAVEFRONT_CHUNK_SIZE;
+        uint64_t end = std::min((chunk + 1) * WAVEFRONT_CHUNK_SIZE, rayCount);
+        if (!traceAll) {
+            for (uint64_t i = begin; i < end; i++) {
+                Vector3D origin = {rays.originX[i], rays.originY[i], rays.originZ[i]};
+                Vector3D direction = {rays.directionX[i], rays.directionY[i], rays.directionZ[i]};
+                wavefrontContext.intersections[i] = {false, std::numeric_limits<double>::max(), origin, direction,
+                                                     0, 0, 0, 0, 0};
+            }
+
+            // neighbouring rays are traced as packets, generations whose rays diverge fall back to single rays
+            for (uint64_t first = begin; first < end; first += WIDE_BVH_PACKET_SIZE) {
+                uint64_t count = std::min<uint64_t>(WIDE_BVH_PACKET_SIZE, end - first);
+                traceRayPacket(compiledGeometry, &wavefrontContext.intersections[first], count, traceFirst);
+            }
+            return;
+        }
+
+        for (uint64_t i = begin; i < end; i++) {
+            Ray ray{};
+            ray.origin = {rays.originX[i], rays.originY[i], rays.originZ[i]};
+            ray.direction = {rays.directionX[i], rays.directionY[i], rays.directionZ[i]};
+            ray.dirfrac.x = 1.0 / ray.direction.x;
+            ray.dirfrac.y = 1.0 / ray.direction.y;
+            ray.dirfrac.z = 1.0 / ray.direction.z;
+
+            IntersectionInfo *info = &wavefrontContext.intersections[i];
+            *info = {false, std::numeric_limits<double>::max(), ray.origin, ray.direction, 0, 0, 0, 0, 0};
+
+            auto &infos = wavefrontContext.pierceInputs[i].intersectionInfo;
+            compiledGeometry->intersectAll(&infos, &wavefrontContext.intersectionArenas[workerId], &ray);
+            for (auto candidate: infos) {
+                if (candidate->hit && info->distance > candidate->distance) {
+                    *info = *candidate;
+                }
+            }
+        }
+    });
+
+    // compaction, rays that hit the geometry go to the front and rays that missed it to the back, so that every shader
+    // batch works on a contiguous range, rays in between only hit something behind the closest distance
+    auto &intersections = wavefrontContext.intersections;
+    auto &pierceInputs = wavefrontContext.pierceInputs;
+    auto &order = wavefrontContext.order;
+    order.resize(rayCount);
+    for (uint64_t i = 0; i < rayCount; i++) {
+        order[i] = i;
+    }
+    auto hitEnd = std::partition(order.begin(), order.end(), [&intersections](uint64_t i) {
+        return intersections[i].hit;
+    });
+    auto missBegin = std::partition(hitEnd, order.end(), [&pierceInputs, traceAll](uint64_t i) {
+        if (!traceAll) return false;
+        for (auto candidate: pierceInputs[i].intersectionInfo) {
+            if (candidate->hit) return true;
+        }
+        return false;
+    });
+    wavefrontContext.hitCount = hitEnd - order.begin();
+    wavefrontContext.missCount = order.end() - missBegin;
+
+    auto &compactedRays = wavefrontContext.nextRays;
+    auto &compactedIntersections = wavefrontContext.compactedIntersections;
+    auto &compactedPierceInputs = wavefrontContext.compactedPierceInputs;
+    compactedIntersections.resize(rayCount);
+    if (traceAll) compactedPierceInputs.resize(rayCount);
+    for (uint64_t i = 0; i < rayCount; i++) {
+        uint64_t source = order[i];
+        Vector3D origin = {rays.originX[source], rays.originY[source], rays.originZ[source]};
+        Vector3D direction = {rays.directionX[source], rays.directionY[source], rays.directionZ[source]};
+        pushRay(&compactedRays, rays.rayIDs[source], &origin, &direction, rays.rayResources[source],
+                getPayload(&rays.payloads, source, payloadStride), payloadStride);
+        compactedIntersections[i] = intersections[source];
+        if (traceAll) std::swap(compactedPierceInputs[i], pierceInputs[source]);
+    }
+    std::swap(rays, compactedRays);
+    clearRays(&compactedRays);
+    std::swap(intersections, compactedIntersections);
+    if (traceAll) std::swap(pierceInputs, compactedPierceInputs);
+}
+
+void PipelineImplement::shadeWavefront() {
+    float *accumulation = frameBuffer->getAccumulation();
+    auto taskScheduler = engineNode->getTaskScheduler();
+    auto &rays = wavefrontContext.rays;
+    auto &newRays = wavefrontContext.newRays;
+    auto &shaderOutputs = wavefrontContext.shaderOutputs;
+    auto &colors = wavefrontContext.colors;
+    uint64_t rayCount = rays.rayIDs.size();
+    uint64_t hitCount = wavefrontContext.hitCount;
+    uint64_t missBegin = rayCount - wavefrontContext.missCount;
+
+    newRays.resize(rayCount);
+    shaderOutputs.resize(rayCount);
+    colors.assign(rayCount * 3, 0.0f);
+
+    auto &hitInputs = wavefrontContext.hitInputs;
+    auto &occlusionInputs = wavefrontContext.occlusionInputs;
+    auto &missInputs = wavefrontContext.missInputs;
+    hitInputs.resize(hitCount);
+    occlusionInputs.resize(hitCount);
+    missInputs.resize(rayCount - missBegin);
+    for (uint64_t i = 0; i < hitCount; i++) {
+        void *rayPayload = getPayload(&rays.payloads, i, payloadStride);
+        hitInputs[i] = {&wavefrontContext.intersections[i], rayPayload};
+        occlusionInputs[i] = {{rays.originX[i], rays.originY[i], rays.originZ[i]},
+                              {rays.directionX[i], rays.directionY[i], rays.directionZ[i]}, rayPayload};
+    }
+    for (uint64_t i = missBegin; i < rayCount; i++) {
+        missInputs[i - missBegin] = {{rays.originX[i], rays.originY[i], rays.originZ[i]},
+                                     {rays.directionX[i], rays.directionY[i], rays.directionZ[i]},
+                                     getPayload(&rays.payloads, i, payloadStride)};
+    }
+    if (!pierceShaders.empty()) {
+        for (uint64_t i = 0; i < rayCount; i++) {
+            wavefrontContext.pierceInputs[i].rayPayload = getPayload(&rays.payloads, i, payloadStride);
+        }
+    }
+
+    // runs a single shader over a range of rays in chunks, every ray has its own slots, so no synchronisation is needed
+    auto batch = [taskScheduler, &shaderOutputs, &colors](uint64_t begin, uint64_t end,
+                                                          const std::function<void(uint64_t, uint64_t)> &shade) {
+        uint64_t chunkCount = (end - begin + WAVEFRONT_CHUNK_SIZE - 1) / WAVEFRONT_CHUNK_SIZE;
+        taskScheduler->parallelFor(chunkCount, [&](uint64_t chunk, unsigned int workerId) {
+            uint64_t first = begin + chunk * WAVEFRONT_CHUNK_SIZE;
+            uint64_t last = std::min(first + WAVEFRONT_CHUNK_SIZE, end);
+            shade(first, last - first);
+            for (uint64_t i = first; i < last; i++) {
+                addColor(&colors[i * 3], &shaderOutputs[i]);
+            }
+        });
+    };
+
+    // the shaders of a single ray are called in the same order as in depth first mode
+    for (auto &pierceShader: pierceShaders) {
+        batch(0, rayCount, [&](uint64_t first, uint64_t count) {
+            pierceShader.second.pierceShader->shadeBatch(count, &rays.rayIDs[first], pipelineInfo,
+                                                         &wavefrontContext.pierceInputs[first],
+                                                         &pierceShader.second.shaderResources,
+                                                         &rays.rayResources[first], &newRays[first],
+                                                         &shaderOutputs[first]);
+        });
+    }
+
+    for (auto &hitShader: hitShaders) {
+        batch(0, hitCount, [&](uint64_t first, uint64_t count) {
+            hitShader.second.hitShader->shadeBatch(count, &rays.rayIDs[first], pipelineInfo, &hitInputs[first],
+                                                   &hitShader.second.shaderResources, &rays.rayResources[first],
+                                                   &newRays[first], &shaderOutputs[first]);
+        });
+    }
+
+    for (auto &occlusionShader: occlusionShaders) {
+        batch(0, hitCount, [&](uint64_t first, uint64_t count) {
+            occlusionShader.second.occlusionShader->shadeBatch(count, &rays.rayIDs[first], pipelineInfo,
+                                                               &occlusionInputs[first],
+                                                               &occlusionShader.second.shaderResources,
+                                                               &rays.rayResources[first], &newRays[first],
+                                                               &shaderOutputs[first]);
+        });
+    }
+
+    for (auto &missShader: missShaders) {
+        batch(missBegin, rayCount, [&](uint64_t first, uint64_t count) {
+            missShader.second.missShader->shadeBatch(count, &rays.rayIDs[first], pipelineInfo,
+                                                     &missInputs[first - missBegin],
+                                                     &missShader.second.shaderResources, &rays.rayResources[first],
+                                                     &newRays[first], &shaderOutputs[first]);
+        });
+    }
+
+    // several rays may belong to the same pixel, so colors are written and child rays spawned in a single pass
+    for (uint64_t i = 0; i < rayCount; i++) {
+        uint64_t id = rays.rayIDs[i];
+        accumulation[id * 4] += colors[i * 3];
+        accumulation[id * 4 + 1] += colors[i * 3 + 1];
+        accumulation[id * 4 + 2] += colors[i * 3 + 2];
+
+        auto rayResource = rays.rayResources[i];
+        uint64_t childCount = newRays[i].rays.size();
+        for (uint64_t child = 0; child < childCount; child++) {
+            auto &r = newRays[i].rays[child];
+            pushRay(&wavefrontContext.nextRays, id, &r.rayOrigin, &r.rayDirection,
+                    passRayResource(rayResource, child, childCount, &wavefrontContext.rayResourcePool),
+                    getPayload(&rays.payloads, i, payloadStride), payloadStride);
+        }
+        if (childCount == 0) wavefrontContext.rayResourcePool.release(rayResource);
+        newRays[i].rays.clear();
+    }
+
+    for (auto &pierceInput: wavefrontContext.pierceInputs) {
+        pierceInput.intersectionInfo.clear();
+    }
+}
+
+void PipelineImplement::traceAll(TileContext *tileContext) {
+    float *accumulation = frameBuffer->getAccumulation();
+    auto &rayContainers = tileContext->rayContainers;
+
+    while (!rayContainers.empty()) {
+        if (rayContainers.size() <= tileContext->primaryCount) {
+            // generated rays were already traced and shaded together with the rest of the tile
+            popPrimaryRay(tileContext, payloadStride);
+            continue;
+        }
+
+        int id = rayContainers.back().rayID;
+        auto rayResource = rayContainers.back().rayResource;
+        void *rayPayload = popPayload(tileContext, payloadStride);
+        Ray ray{};
+        ray.origin = rayContainers.back().rayOrigin;
+        ray.direction = rayContainers.back().rayDirection;
+        ray.dirfrac.x = 1.0 / ray.direction.x;
+        ray.dirfrac.y = 1.0 / ray.direction.y;
+        ray.dirfrac.z = 1.0 / ray.direction.z;
+
+        // the intersections of the previous ray are released at once, their storage and the vectors are reused
+        auto &infos = tileContext->intersections;
+        infos.clear();
+        tileContext->intersectionArena.reset();
+        compiledGeometry->intersectAll(&infos, &tileContext->intersectionArena, &ray);
+
+        auto &newRays = tileContext->newRays;
+        newRays.rays.clear();
+
+        for (auto &pierceShader: pierceShaders) {
+            auto &pierceShaderInput = tileContext->pierceInput;
+            pierceShaderInput.intersectionInfo.assign(infos.begin(), infos.end());
+            pierceShaderInput.rayPayload = rayPayload;
+            auto pixel = pierceShader.second.pierceShader->shade(id, pipelineInfo, &pierceShaderInput,
+                                                                 &pierceShader.second.shaderResources,
+                                                                 &rayResource, &newRays);
+            addColor(&accumulation[id * 4], &pixel);
+        }
+
+        IntersectionInfo closest = {false, std::numeric_limits<double>::max(), ray.origin,
+                                    ray.direction, 0, 0, 0, 0, 0};
+        bool hitAny = false;
+        for (auto info: infos) {
+            if (info->hit) {
+                hitAny = true;
+                if (closest.distance > info->distance) {
+                    closest = *info;
+                }
+            }
+        }
+
+        if (closest.hit) {
+            for (auto &hitShader: hitShaders) {
+                HitShaderInput hitShaderInput = {&closest, rayPayload};
+                auto pixel = hitShader.second.hitShader->shade(id, pipelineInfo, &hitShaderInput,
+                                                               &hitShader.second.shaderResources,
+                                                               &rayResource, &newRays);
+                addColor(&accumulation[id * 4], &pixel);
+            }
+        }
+
+        if (closest.hit) {
+            for (auto &occlusionShader: occlusionShaders) {
+                OcclusionShaderInput occlusionShaderInput = {ray.origin, ray.direction, rayPayload};
+                auto pixel = occlusionShader.second.occlusionShader->shade(id, pipelineInfo,
+                                                                           &occlusionShaderInput,
+                                                                           &occlusionShader.second.shaderResources,
+                                                                           &rayResource,
+                                                                           &newRays);
+                addColor(&accumulation[id * 4], &pixel);
+            }
+        }
+
+        if (!hitAny) {
+            for (auto &missShader: missShaders) {
+                MissShaderInput missShaderInput = {ray.origin, ray.direction, rayPayload};
+                auto pixel = missShader.second.missShader->shade(id, pipelineInfo, &missShaderInput,
+                                                                 &missShader.second.shaderResources,
+                                                                 &rayResource, &newRays);
+                addColor(&accumulation[id * 4], &pixel);
+            }
+        }
+
+        rayContainers.pop_back();
+        pushChildRays(tileContext, id, rayResource, rayPayload, &newRays, payloadStride);
+    }
+}
+
+void PipelineImplement::traceFirst(TileContext *tileContext) {
+    float *accumulation = frameBuffer->getAccumulation();
+    auto &rayContainers = tileContext->rayContainers;
+
+    while (!rayContainers.empty()) {
+        if (rayContainers.size() <= tileContext->primaryCount) {
+            // generated rays were already traced and shaded together with the rest of the tile
+            popPrimaryRay(tileContext, payloadStride);
+            continue;
+        }
+
+        int id = rayContainers.back().rayID;
+        auto rayResource = rayContainers.back().rayResource;
+        void *rayPayload = popPayload(tileContext, payloadStride);
+        Ray ray{};
+        ray.origin = rayContainers.back().rayOrigin;
+        ray.direction = rayContainers.back().rayDirection;
+        ray.dirfrac.x = 1.0 / ray.direction.x;
+        ray.dirfrac.y = 1.0 / ray.direction.y;
+        ray.dirfrac.z = 1.0 / ray.direction.z;
+
+        IntersectionInfo info = {false, std::numeric_limits<double>::max(), ray.origin, ray.direction,
+                                 0, 0, 0, 0, 0};
+        compiledGeometry->intersectFirst(&info, &ray);
+
+        auto &newRays = tileContext->newRays;
+        newRays.rays.clear();
+
+        if (info.hit) {
+            for (auto &hitShader: hitShaders) {
+                HitShaderInput hitShaderInput = {&info, rayPayload};
+                auto pixel = hitShader.second.hitShader->shade(id, pipelineInfo, &hitShaderInput,
+                                                               &hitShader.second.shaderResources,
+                                                               &rayResource, &newRays);
+                addColor(&accumulation[id * 4], &pixel);
+            }
+
+            for (auto &occlusionShader: occlusionShaders) {
+                OcclusionShaderInput occlusionShaderInput = {ray.origin, ray.direction, rayPayload};
+                auto pixel = occlusionShader.second.occlusionShader->shade(id, pipelineInfo,
+                                                                           &occlusionShaderInput,
+                                                                           &occlusionShader.second.shaderResources,
+                                                                           &rayResource,
+                                                                           &newRays);
+                addColor(&accumulation[id * 4], &pixel);
+            }
+        } else {
+            for (auto &missShader: missShaders) {
+                MissShaderInput missShaderInput = {ray.origin, ray.direction, rayPayload};
+                auto pixel = missShader.second.missShader->shade(id, pipelineInfo, &missShaderInput,
+                                                                 &missShader.second.shaderResources,
+                                                                 &rayResource, &newRays);
+                addColor(&accumulation[id * 4], &pixel);
+            }
+        }
+
+        rayContainers.pop_back();
+        pushChildRays(tileContext, id, rayResource, rayPayload, &newRays, payloadStride);
+    }
+}
+
+void PipelineImplement::traceAny(TileContext *tileContext) {
+    float *accumulation = frameBuffer->getAccumulation();
+    auto &rayContainers = tileContext->rayContainers;
+
+    while (!rayContainers.empty()) {
+        if (rayContainers.size() <= tileContext->primaryCount) {
+            // generated rays were already traced and shaded together with the rest of the tile
+            popPrimaryRay(tileContext, payloadStride);
+            continue;
+        }
+
+        int id = rayContainers.back().rayID;
+        auto rayResource = rayContainers.back().rayResource;
+        void *rayPayload = popPayload(tileContext, payloadStride);
+        Ray ray{};
+        ray.origin = rayContainers.back().rayOrigin;
+        ray.direction = rayContainers.back().rayDirection;
+        ray.dirfrac.x = 1.0 / ray.direction.x;
+        ray.dirfrac.y = 1.0 / ray.direction.y;
+        ray.dirfrac.z = 1.0 / ray.direction.z;
+
+        IntersectionInfo info = {false, std::numeric_limits<double>::max(), ray.origin, ray.direction,
+                                 0, 0, 0, 0, 0};
+        compiledGeometry->intersectAny(&info, &ray);
+
+        auto &newRays = tileContext->newRays;
+        newRays.rays.clear();
+
+        if (info.hit) {
+            for (auto &occlusionShader: occlusionShaders) {
+                OcclusionShaderInput occlusionShaderInput = {ray.origin, ray.direction, rayPayload};
+                auto pixel = occlusionShader.second.occlusionShader->shade(id, pipelineInfo,
+                                                                           &occlusionShaderInput,
+                                                                           &occlusionShader.second.shaderResources,
+                                                                           &rayResource,
+                                                                           &newRays);
+                addColor(&accumulation[id * 4], &pixel);
+            }
+        } else {
+            for (auto &missShader: missShaders) {
+                MissShaderInput missShaderInput = {ray.origin, ray.direction, rayPayload};
+                auto pixel = missShader.second.missShader->shade(id, pipelineInfo, &missShaderInput,
+                                                                 &missShader.second.shaderResources,
+                                                                 &rayResource, &newRays);
+                addColor(&accumulation[id * 4], &pixel);
+            }
+        }
+
+        rayContainers.pop_back();
+        pushChildRays(tileContext, id, rayResource, rayPayload, &newRays, payloadStride);
+    }
 }
 
 void
 PipelineImplement::addShader(RayGeneratorShaderId shaderId, RayGeneratorShaderContainer *rayGeneratorShaderContainer) {
     rayGeneratorShaders[shaderId] = *rayGeneratorShaderContainer;
+    accumulationInvalid = true;
 }
 
 void PipelineImplement::addShader(HitShaderId shaderId, HitShaderContainer *hitShaderContainer) {
     hitShaders[shaderId] = *hitShaderContainer;
+    accumulationInvalid = true;
 }
 
 void PipelineImplement::addShader(OcclusionShaderId shaderId, OcclusionShaderContainer *occlusionShaderContainer) {
     occlusionShaders[shaderId] = *occlusionShaderContainer;
+    accumulationInvalid = true;
 }
 
 void PipelineImplement::addShader(PierceShaderId shaderId, PierceShaderContainer *pierceShaderContainer) {
     pierceShaders[shaderId] = *pierceShaderContainer;
+    accumulationInvalid = true;
 }
 
 void PipelineImplement::addShader(MissShaderId shaderId, MissShaderContainer *missShaderContainer) {
     missShaders[shaderId] = *missShaderContainer;
+    accumulationInvalid = true;
 }
 
 bool PipelineImplement::removeShader(RayGeneratorShaderId shaderId) {
     if (rayGeneratorShaders.count(shaderId) != 0) {
         rayGeneratorShaders.erase(shaderId);
+        accumulationInvalid = true;
         return true;
     }
     return false;
@@ -382,6 +1414,7 @@ bool PipelineImplement::removeShader(RayGeneratorShaderId shaderId) {
 bool PipelineImplement::removeShader(HitShaderId shaderId) {
     if (hitShaders.count(shaderId) != 0) {
         hitShaders.erase(shaderId);
+        accumulationInvalid = true;
         return true;
     }
     return false;
@@ -390,6 +1423,7 @@ bool PipelineImplement::removeShader(HitShaderId shaderId) {
 bool PipelineImplement::removeShader(OcclusionShaderId shaderId) {
     if (occlusionShaders.count(shaderId) != 0) {
         occlusionShaders.erase(shaderId);
+        accumulationInvalid = true;
         return true;
     }
     return false;
@@ -398,6 +1432,7 @@ bool PipelineImplement::removeShader(OcclusionShaderId shaderId) {
 bool PipelineImplement::removeShader(PierceShaderId shaderId) {
     if (pierceShaders.count(shaderId) != 0) {
         pierceShaders.erase(shaderId);
+        accumulationInvalid = true;
         return true;
     }
     return false;
@@ -406,6 +1441,7 @@ bool PipelineImplement::removeShader(PierceShaderId shaderId) {
 bool PipelineImplement::removeShader(MissShaderId shaderId) {
     if (missShaders.count(shaderId) != 0) {
         missShaders.erase(shaderId);
+        accumulationInvalid = true;
         return true;
     }
     return false;
@@ -414,6 +1450,7 @@ bool PipelineImplement::removeShader(MissShaderId shaderId) {
 bool PipelineImplement::updateShader(RayGeneratorShaderId shaderId, std::vector<ShaderResource *> *shaderResources) {
     if (rayGeneratorShaders.count(shaderId) != 0) {
         rayGeneratorShaders[shaderId].shaderResources = *shaderResources;
+        accumulationInvalid = true;
         return true;
     }
     return false;
@@ -422,6 +1459,7 @@ bool PipelineImplement::updateShader(RayGeneratorShaderId shaderId, std::vector<
 bool PipelineImplement::updateShader(HitShaderId shaderId, std::vector<ShaderResource *> *shaderResources) {
     if (hitShaders.count(shaderId) != 0) {
         hitShaders[shaderId].shaderResources = *shaderResources;
+        accumulationInvalid = true;
         return true;
     }
     return false;
@@ -430,6 +1468,7 @@ bool PipelineImplement::updateShader(HitShaderId shaderId, std::vector<ShaderRes
 bool PipelineImplement::updateShader(OcclusionShaderId shaderId, std::vector<ShaderResource *> *shaderResources) {
     if (occlusionShaders.count(shaderId) != 0) {
         occlusionShaders[shaderId].shaderResources = *shaderResources;
+        accumulationInvalid = true;
         return true;
     }
     return false;
@@ -438,6 +1477,7 @@ bool PipelineImplement::updateShader(OcclusionShaderId shaderId, std::vector<Sha
 bool PipelineImplement::updateShader(PierceShaderId shaderId, std::vector<ShaderResource *> *shaderResources) {
     if (pierceShaders.count(shaderId) != 0) {
         pierceShaders[shaderId].shaderResources = *shaderResources;
+        accumulationInvalid = true;
         return true;
     }
     return false;
@@ -446,13 +1486,14 @@ bool PipelineImplement::updateShader(PierceShaderId shaderId, std::vector<Shader
 bool PipelineImplement::updateShader(MissShaderId shaderId, std::vector<ShaderResource *> *shaderResources) {
     if (missShaders.count(shaderId) != 0) {
         missShaders[shaderId].shaderResources = *shaderResources;
+        accumulationInvalid = true;
         return true;
     }
     return false;
 }
 
 Texture *PipelineImplement::getResult() {
-    return result;
+    return frameBuffer->getResult();
 }
 
 void PipelineImplement::setEngine(EngineNode *engine) {
@@ -5,9 +5,15 @@
 #ifndef RAYTRACECORE_PIPELINEIMPLEMENT_H
 #define RAYTRACECORE_PIPELINEIMPLEMENT_H
 
+#include <atomic>
+#include <chrono>
 #include <limits>
 #include <vector>
 #include "RayTraceEngine/Shader.h"
+#include "RayTraceEngine/Pipeline.h"
+#include "Utils/Allocator/AlignedAllocator.h"
+#include "Utils/Allocator/BlockArena.h"
+#include "Pipeline/RayResourcePool.h"
 
 class DataManagementUnitV2;
 
@@ -27,6 +33,10 @@ class Object;
 
 struct PipelineInfo;
 struct DBVHNode;
+
+class CompiledDBVH;
+class FrameBuffer;
+class TaskScheduler;
 struct Texture;
 struct Vector3D;
 
@@ -80,6 +90,147 @@ struct MissShaderPackage {
     MissShaderId id;
 };
 
+/**
+ * A ray waiting to be traced.
+ * rayID:           Id of the ray family, equivalent to the pixel id.
+ * rayOrigin:       Origin of the ray.
+ * rayDirection:    Direction of the ray.
+ * rayResource:     Data attached to the ray by the shaders.
+ */
+struct RayContainer {
+    int rayID;
+    Vector3D rayOrigin;
+    Vector3D rayDirection;
+    RayResource *rayResource;
+};
+
+/**
+ * Inline payloads of a sequence of rays, one slot of the payload stride per ray. The storage is aligned to the largest
+ * payload alignment, so that every slot is aligned as well.
+ */
+typedef std::vector<unsigned char, AlignedAllocator<unsigned char, 64>> PayloadBuffer;
+
+/**
+ * Scratch memory of a single worker thread, reused for every tile the worker renders.
+ * rayIDs:          Ids of the ray families generated in a single batch.
+ * rays:            Output of the ray generator shaders, one entry per ray family of the batch.
+ * rayContainers:   Rays of the current pixel that still have to be traced.
+ * intersections:   Every intersection of the current ray, stored in intersectionArena.
+ * pierceInput:     Input of the current pierce shader, refilled from intersections for every shader.
+ * intersectionArena:   Storage of the intersections, reset for every ray.
+ * rayResourcePool:     Resources of finished rays, reused for the resources of new ones.
+ * payloads:        Payloads of rayContainers, one slot per ray in the same order.
+ * generatedPayloads:   Initial payloads written by the ray generator shaders, one slot per entry of rays.
+ * payload:         Payload of the ray that is currently shaded, its slot in payloads is reused by its children.
+ * newRays:         Child rays spawned by the shaders of the current ray.
+ * primaryIntersections:    Intersections of the rays generated for the tile, traced before shading, in the order of the
+ *                          rays in rays.
+ * primaryOffsets:  Index of the first intersection of every entry of rays in primaryIntersections.
+ * primaryPierceInputs:     Every intersection of every generated ray in the same order, only filled when pierce shaders
+ *                          are bound.
+ * primaryOrder:    Order of the generated rays after compaction, rays that hit the geometry first, rays that missed it
+ *                  last. The following primary buffers are stored in this order.
+ * primarySlots:    Compacted index of every generated ray, in the order of primaryIntersections.
+ * primaryIDs:      Id of the ray family of every generated ray.
+ * primaryPayloads: Payloads of the generated rays, one slot per ray, modified by their shaders.
+ * primaryResources:    Data attached to the generated rays by their shaders.
+ * primaryRays:     Child rays spawned by the shaders of every generated ray.
+ * primaryOutputs:  Colors written by the shader of the current batch.
+ * hitInputs:       Input of the hit shaders for the generated rays that hit the geometry.
+ * occlusionInputs: Input of the occlusion shaders for the generated rays that hit the geometry.
+ * missInputs:      Input of the miss shaders for the generated rays that missed the geometry.
+ * pierceInputs:    Input of the pierce shaders for all generated rays.
+ * primaryCount:    Number of rays at the bottom of rayContainers that were already shaded together with the tile.
+ * primaryOffset:   Index in primarySlots of the first of these rays.
+ */
+struct TileContext {
+    std::vector<uint64_t> rayIDs;
+    std::vector<RayGeneratorOutput> rays;
+    std::vector<RayContainer> rayContainers;
+    std::vector<IntersectionInfo *> intersections;
+    PierceShaderInput pierceInput;
+    BlockArena<IntersectionInfo> intersectionArena;
+    RayResourcePool rayResourcePool;
+    PayloadBuffer payloads;
+    PayloadBuffer generatedPayloads;
+    PayloadBuffer payload;
+    RayGeneratorOutput newRays;
+    std::vector<IntersectionInfo> primaryIntersections;
+    std::vector<uint64_t> primaryOffsets;
+    std::vector<PierceShaderInput> primaryPierceInputs;
+    std::vector<uint64_t> primaryOrder;
+    std::vector<uint64_t> primarySlots;
+    std::vector<uint64_t> primaryIDs;
+    PayloadBuffer primaryPayloads;
+    std::vector<RayResource *> primaryResources;
+    std::vector<RayGeneratorOutput> primaryRays;
+    std::vector<ShaderOutput> primaryOutputs;
+    std::vector<HitShaderInput> hitInputs;
+    std::vector<OcclusionShaderInput> occlusionInputs;
+    std::vector<MissShaderInput> missInputs;
+    std::vector<PierceShaderInput> pierceInputs;
+    uint64_t primaryCount{};
+    uint64_t primaryOffset{};
+};
+
+/**
+ * One generation of rays in wavefront mode, stored as a structure of arrays so that bulk traversal only streams through
+ * the components it reads.
+ * rayIDs:          Id of the ray family of every ray, equivalent to the pixel id.
+ * originX:         Origin components of the rays, as well as originY and originZ.
+ * directionX:      Direction components of the rays, as well as directionY and directionZ.
+ * rayResources:    Data attached to the rays by the shaders.
+ * payloads:        Inline payloads of the rays, one slot per ray.
+ */
+struct RayBuffer {
+    std::vector<uint64_t> rayIDs;
+    std::vector<double> originX, originY, originZ;
+    std::vector<double> directionX, directionY, directionZ;
+    std::vector<RayResource *> rayResources;
+    PayloadBuffer payloads;
+};
+
+/**
+ * Scratch memory of the wavefront mode, reused for every generation and every run. After tracing, the rays of a
+ * generation are compacted, so that every shader batch works on a contiguous range of them.
+ * rays:                Rays of the current generation, rays that hit the geometry first, rays that missed it last.
+ * nextRays:            Rays spawned by the shaders of the current generation.
+ * intersections:       Closest intersection of every ray, any intersection if only occlusion and miss shaders are bound.
+ * pierceInputs:        Every intersection of every ray, only filled when pierce shaders are bound.
+ * hitInputs:           Input of the hit shaders for the rays that hit the geometry.
+ * occlusionInputs:     Input of the occlusion shaders for the rays that hit the geometry.
+ * missInputs:          Input of the miss shaders for the rays that missed the geometry.
+ * hitCount:            Number of rays that hit the geometry.
+ * missCount:           Number of rays that missed the geometry.
+ * order:               Order of the rays after compaction.
+ * compactedIntersections:  Target of the compaction of intersections, swapped with it afterwards.
+ * compactedPierceInputs:   Target of the compaction of pierceInputs, swapped with it afterwards.
+ * newRays:             Rays spawned by the shaders of every ray, turned into the next generation after shading.
+ * shaderOutputs:       Colors written by the shader of the current batch.
+ * colors:              Colors summed over all shaders of every ray, three channels per ray.
+ * intersectionArenas:  Storage of the entries of pierceInputs, one arena per worker thread, reset for every generation.
+ * rayResourcePool:     Resources of finished rays, reused for the resources of new ones.
+ */
+struct WavefrontContext {
+    RayBuffer rays;
+    RayBuffer nextRays;
+    std::vector<IntersectionInfo> intersections;
+    std::vector<PierceShaderInput> pierceInputs;
+    std::vector<HitShaderInput> hitInputs;
+    std::vector<OcclusionShaderInput> occlusionInputs;
+    std::vector<MissShaderInput> missInputs;
+    uint64_t hitCount{};
+    uint64_t missCount{};
+    std::vector<uint64_t> order;
+    std::vector<IntersectionInfo> compactedIntersections;
+    std::vector<PierceShaderInput> compactedPierceInputs;
+    std::vector<RayGeneratorOutput> newRays;
+    std::vector<ShaderOutput> shaderOutputs;
+    std::vector<float> colors;
+    std::vector<BlockArena<IntersectionInfo>> intersectionArenas;
+    RayResourcePool rayResourcePool;
+};
+
 /**
  * Contains all the information needed that defines a pipeline.
  * PipelineImplement Model:
@@ -102,8 +253,86 @@ private:
 
 
     DBVHNode *geometry;
+    CompiledDBVH *compiledGeometry;
+    bool geometryChanged;
+
+    FrameBuffer *frameBuffer;
+
+    uint64_t sampleCount;
+    // number of tiles, or waves in wavefront mode, of the next sample that are already accumulated
+    uint64_t sampleProgress;
+    int samplesPerRun;
+    bool accumulate;
+    int priority;
+    bool accumulationInvalid;
+
+    // a positive target frame time in milliseconds lets run() lower the resolution that is rendered, see adjustRenderScale
+    double targetFrameTime;
+    // ratio of the rendered to the output resolution along each axis
+    double renderScale;
+    // estimated time in milliseconds a run spends per rendered pixel
+    double pixelTime;
+
+    // size of the inline payload of a ray padded to its alignment, zero if the pipeline declares no payload
+    uint64_t payloadStride;
+
+    // set from another thread to stop an execution at the next tile
+    const std::atomic_bool *cancellation;
+
+    bool isCancelled();
+
+    std::vector<TileContext> tileContexts;
 
-    Texture *result;
+    PipelineMode mode;
+    WavefrontContext wavefrontContext;
+
+    void prepare(bool resetAccumulation);
+
+    void renderSamples(uint64_t targetSampleCount, std::chrono::steady_clock::time_point deadline);
+
+    void renderTile(int tileX, int tileY, TileContext *tileContext);
+
+    void resolve();
+
+    /**
+     * Derives the render scale of the next run from the duration of the last one, the resolution is only changed if
+     * the scale differs noticeably since that discards the accumulated samples.
+     * @param frameTime     Duration of the last run in milliseconds.
+     */
+    void adjustRenderScale(double frameTime);
+
+    /**
+     * Sets the rendered resolution to the output resolution times the render scale.
+     */
+    void applyRenderScale();
+
+    void renderWave(int firstPixel, int lastPixel);
+
+    void generateWavefront(int firstPixel, int lastPixel);
+
+    void traceWavefront();
+
+    void shadeWavefront();
+
+    /**
+     * Traces the rays generated for a tile as packets, neighbouring pixels share their traversal of the geometry. Rays
+     * of pipelines with pierce shaders are traced one by one, since they need every intersection.
+     * @param tileContext   Context of the tile, receives the intersections in primaryIntersections.
+     */
+    void tracePrimaryRays(TileContext *tileContext);
+
+    /**
+     * Traces the rays generated for a tile and shades them in batches per shader, their colors are accumulated right
+     * away and their child rays are kept in primaryRays until the rays are taken from the stack of the tile.
+     * @param tileContext   Context of the tile, its rays are already generated.
+     */
+    void shadePrimaryRays(TileContext *tileContext);
+
+    void traceAll(TileContext *tileContext);
+
+    void traceFirst(TileContext *tileContext);
+
+    void traceAny(TileContext *tileContext);
 
 public:
     PipelineImplement(EngineNode *engine, int width, int height, Vector3D *cameraPosition, Vector3D *cameraDirection,
@@ -117,12 +346,32 @@ public:
 
     int run();
 
+    bool runProgressive(double timeBudget, uint64_t targetSampleCount);
+
+    static void runAll(std::vector<PipelineImplement *> *pipelines, TaskScheduler *taskScheduler);
+
+    void setCancellation(const std::atomic_bool *cancelled);
+
     Texture *getResult();
 
     void setResolution(int width, int height);
 
     void setCamera(Vector3D pos, Vector3D dir, Vector3D up);
 
+    void setMode(PipelineMode pipelineMode);
+
+    void setSampling(int samples, bool accumulateSamples);
+
+    void setPriority(int pipelinePriority);
+
+    void setTargetFrameTime(double frameTime);
+
+    void setRayPayload(uint64_t size, uint64_t alignment);
+
+    void resetAccumulation();
+
+    uint64_t getSampleCount();
+
     void addShader(RayGeneratorShaderId shaderId, RayGeneratorShaderContainer *rayGeneratorShaderContainer);
 
     void addShader(HitShaderId shaderId, HitShaderContainer *hitShaderContainer);
@@ -155,6 +404,8 @@ public:
 
     DBVHNode *getGeometry();
 
+    void invalidateGeometry();
+
     Object *getGeometryAsObject();
 
     void setEngine(EngineNode *engine);
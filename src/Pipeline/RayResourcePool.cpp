@@ -0,0 +1,55 @@
+//
+// Created by Sebastian on 18.10.2026.
+//
+
+#include "Pipeline/RayResourcePool.h"
+#include "RayTraceEngine/Shader.h"
+
+// number of released resources of a single type kept for reuse, the rest is deleted
+static const uint64_t MAX_POOLED_RESOURCES = 1024;
+
+RayResourcePool::~RayResourcePool() {
+    for (auto &resources: released) {
+        for (auto resource: resources.second) {
+            delete resource;
+        }
+    }
+}
+
+RayResource *RayResourcePool::copy(RayResource *resource) {
+    if (resource == nullptr) return nullptr;
+
+    auto type = std::type_index(typeid(*resource));
+    auto entry = released.find(type);
+    if (entry != released.end() && !entry->second.empty()) {
+        auto reused = entry->second.back();
+        if (reused->copyFrom(resource)) {
+            entry->second.pop_back();
+            return reused;
+        }
+
+        // the type cannot be reused, which the pool only learns on the first attempt
+        for (auto pooled: entry->second) {
+            delete pooled;
+        }
+        released.erase(entry);
+        notReusable.insert(type);
+    }
+    return resource->clone();
+}
+
+void RayResourcePool::release(RayResource *resource) {
+    if (resource == nullptr) return;
+
+    auto type = std::type_index(typeid(*resource));
+    if (notReusable.count(type) != 0) {
+        delete resource;
+        return;
+    }
+    auto &resources = released[type];
+    if (resources.size() >= MAX_POOLED_RESOURCES) {
+        delete resource;
+        return;
+    }
+    resources.push_back(resource);
+}
@@ -0,0 +1,51 @@
+//
+// Created by Sebastian on 18.10.2026.
+//
+
+#ifndef RAYTRACEENGINE_RAYRESOURCEPOOL_H
+#define RAYTRACEENGINE_RAYRESOURCEPOOL_H
+
+#include <typeindex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+class RayResource;
+
+/**
+ * Per thread store of released ray resources. Copies of a resource are made by reusing a released resource of the same
+ * type through RayResource::copyFrom, only if none is available or the type does not support reuse a new one is
+ * cloned. Released resources of types that do not support reuse are deleted right away.
+ * released:        Released resources by type, owned by the pool.
+ * notReusable:     Types whose copyFrom declined to copy.
+ */
+class RayResourcePool {
+private:
+    std::unordered_map<std::type_index, std::vector<RayResource *>> released;
+    std::unordered_set<std::type_index> notReusable;
+
+public:
+    RayResourcePool() = default;
+
+    RayResourcePool(const RayResourcePool &other) = delete;
+
+    RayResourcePool(RayResourcePool &&other) noexcept = default;
+
+    RayResourcePool &operator=(const RayResourcePool &other) = delete;
+
+    ~RayResourcePool();
+
+    /**
+     * @param resource  The resource to be copied, may be nullptr.
+     * @return          A copy of the resource owned by the caller, nullptr if the resource is nullptr.
+     */
+    RayResource *copy(RayResource *resource);
+
+    /**
+     * Hands the ownership of a resource to the pool.
+     * @param resource  The resource to be released, may be nullptr.
+     */
+    void release(RayResource *resource);
+};
+
+#endif //RAYTRACEENGINE_RAYRESOURCEPOOL_H
@@ -20,10 +20,34 @@ int RayEngine::runPipeline(PipelineId id) {
     return dataManagementUnit->runPipeline(id);
 }
 
+int RayEngine::runPipeline(PipelineId id, double timeBudget, uint64_t targetSampleCount) {
+    return dataManagementUnit->runPipeline(id, timeBudget, targetSampleCount);
+}
+
+PipelineExecutionHandle RayEngine::runPipelineAsync(PipelineId id) {
+    return dataManagementUnit->runPipelineAsync(id);
+}
+
+int RayEngine::waitPipelineExecution(PipelineExecutionHandle handle) {
+    return dataManagementUnit->waitPipelineExecution(handle);
+}
+
+bool RayEngine::isPipelineExecutionFinished(PipelineExecutionHandle handle) {
+    return dataManagementUnit->isPipelineExecutionFinished(handle);
+}
+
+void RayEngine::cancelPipelineExecution(PipelineExecutionHandle handle) {
+    dataManagementUnit->cancelPipelineExecution(handle);
+}
+
 int RayEngine::runAll() {
     return dataManagementUnit->runAllPipelines();
 }
 
+void RayEngine::setThreadCount(unsigned int threadCount) {
+    dataManagementUnit->setThreadCount(threadCount);
+}
+
 PipelineId RayEngine::createPipeline(PipelineDescription *pipelineDescription) {
     return dataManagementUnit->createPipeline(pipelineDescription);
 }
@@ -147,6 +171,14 @@ bool RayEngine::removePipelineObject(PipelineId pipelineId, InstanceId objectIns
     return dataManagementUnit->removePipelineObject(pipelineId, objectInstanceId);
 }
 
+bool RayEngine::beginPipelineTransaction(PipelineId pipelineId) {
+    return dataManagementUnit->beginPipelineTransaction(pipelineId);
+}
+
+bool RayEngine::commitPipelineTransaction(PipelineId pipelineId) {
+    return dataManagementUnit->commitPipelineTransaction(pipelineId);
+}
+
 bool RayEngine::removePipelineShader(PipelineId pipelineId, RayGeneratorShaderId shaderId) {
     return dataManagementUnit->removePipelineShader(pipelineId, shaderId);
 }
@@ -173,6 +205,30 @@ RayEngine::updatePipelineCamera(PipelineId id, int resolutionX, int resolutionY,
     dataManagementUnit->updatePipelineCamera(id, resolutionX, resolutionY, cameraPosition, cameraDirection, cameraUp);
 }
 
+void RayEngine::updatePipelineMode(PipelineId id, PipelineMode mode) {
+    dataManagementUnit->updatePipelineMode(id, mode);
+}
+
+void RayEngine::updatePipelineSampling(PipelineId id, int samplesPerRun, bool accumulate) {
+    dataManagementUnit->updatePipelineSampling(id, samplesPerRun, accumulate);
+}
+
+void RayEngine::updatePipelinePriority(PipelineId id, int priority) {
+    dataManagementUnit->updatePipelinePriority(id, priority);
+}
+
+void RayEngine::updatePipelineFrameTime(PipelineId id, double targetFrameTime) {
+    dataManagementUnit->updatePipelineFrameTime(id, targetFrameTime);
+}
+
+void RayEngine::resetPipelineAccumulation(PipelineId id) {
+    dataManagementUnit->resetPipelineAccumulation(id);
+}
+
+uint64_t RayEngine::getPipelineSampleCount(PipelineId id) {
+    return dataManagementUnit->getPipelineSampleCount(id);
+}
+
 Texture *RayEngine::getPipelineResult(PipelineId id) {
     return dataManagementUnit->getPipelineResult(id);
 }
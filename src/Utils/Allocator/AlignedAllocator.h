@@ -5,6 +5,55 @@
 #ifndef DBVH_ALIGNEDALLOCATOR_H
 #define DBVH_ALIGNEDALLOCATOR_H
 
+#include <cstddef>
+#include <new>
 
+/**
+ * Pads a value to its own cache line, so that values owned by different threads do not share one.
+ * data:    The wrapped value.
+ */
+template<class T>
+struct alignas(64) AlignedWrapper {
+    T data;
+};
+
+/**
+ * Allocator for standard containers that places their storage on an alignment boundary, usually a cache line.
+ * @tparam T            Type of the stored elements.
+ * @tparam Alignment    Alignment of the storage in bytes, has to be a power of two.
+ */
+template<class T, std::size_t Alignment = 64>
+class AlignedAllocator {
+public:
+    using value_type = T;
+
+    template<class U>
+    struct rebind {
+        using other = AlignedAllocator<U, Alignment>;
+    };
+
+    AlignedAllocator() noexcept = default;
+
+    template<class U>
+    AlignedAllocator(const AlignedAllocator<U, Alignment> &other) noexcept {}
+
+    T *allocate(std::size_t count) {
+        return static_cast<T *>(::operator new(count * sizeof(T), std::align_val_t(Alignment)));
+    }
+
+    void deallocate(T *pointer, std::size_t count) noexcept {
+        ::operator delete(pointer, std::align_val_t(Alignment));
+    }
+
+    template<class U>
+    bool operator==(const AlignedAllocator<U, Alignment> &other) const noexcept {
+        return true;
+    }
+
+    template<class U>
+    bool operator!=(const AlignedAllocator<U, Alignment> &other) const noexcept {
+        return false;
+    }
+};
 
 #endif //DBVH_ALIGNEDALLOCATOR_H
@@ -0,0 +1,44 @@
+//
+// Created by Sebastian on 18.10.2026.
+//
+
+#ifndef RAYTRACEENGINE_BLOCKARENA_H
+#define RAYTRACEENGINE_BLOCKARENA_H
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * Bump allocator for short lived values of a single thread. Values are handed out from fixed size blocks, so their
+ * addresses stay valid until the arena is reset, and a reset only rewinds the arena, its blocks are reused afterwards.
+ * Values are not reinitialized, they keep whatever the previous user wrote into them.
+ * @tparam T            Type of the allocated values, has to be default constructible.
+ * @tparam BlockSize    Number of values per block.
+ */
+template<class T, std::size_t BlockSize = 256>
+class BlockArena {
+private:
+    std::vector<std::vector<T>> blocks;
+    std::size_t block = 0;
+    std::size_t used = 0;
+
+public:
+    T *allocate() {
+        if (used == BlockSize) {
+            block++;
+            used = 0;
+        }
+        if (block == blocks.size()) blocks.emplace_back(BlockSize);
+        return &blocks[block][used++];
+    }
+
+    /**
+     * Releases all values at once, pointers handed out before must not be used afterwards.
+     */
+    void reset() {
+        block = 0;
+        used = 0;
+    }
+};
+
+#endif //RAYTRACEENGINE_BLOCKARENA_H
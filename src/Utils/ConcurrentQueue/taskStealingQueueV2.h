@@ -6,241 +6,114 @@
 #define DBVH_TASKSTEALINGQUEUEV2_H
 
 #include <atomic>
+#include <cstdint>
+#include <cstdlib>
 #include <thread>
 #include "../Allocator/AlignedAllocator.h"
 
-std::atomic_uint64_t count = 0;
-
 namespace Atzubi {
     template<class T>
     class TaskStealingQueueV2 {
     private:
-        static const uint16_t blockSize = 32;
+        static const uint16_t initialCapacity = 32;
 
+        /**
+         * Double ended queue guarded by a spin lock. The owner pushes and pops at the head, other users steal from the
+         * tail. Items are kept in a ring buffer that doubles its capacity when full.
+         */
         class Deque {
         private:
-            struct Block {
-                T data[blockSize];
-                Block *next = nullptr;
-                Block *previous = nullptr;
-            };
-
-            std::atomic_flag headLock{};
-            Block *blockHead;
+            std::atomic_flag lock{};
+            T *buffer;
+            uint64_t capacity;
             uint64_t head;
-            uint64_t localEmptyTail;
-            uint64_t localFullTail;
-            uint64_t headBlockSize;
+            uint64_t tail;
 
+            void acquire() {
+                while (lock.test_and_set(std::memory_order_acquire)) std::this_thread::yield();
+            }
 
-            alignas(64) std::atomic_flag tailLock{};
-            Block *blockTail;
-            uint64_t tail;
-            uint64_t localEmptyHead;
-            uint64_t localFullHead;
-            uint64_t tailBlockSize;
+            void release() {
+                lock.clear(std::memory_order_release);
+            }
 
-            uint64_t size;
+            void grow() {
+                auto *newBuffer = new T[capacity << 1];
+                for (uint64_t i = head; i != tail; i++) {
+                    newBuffer[i & ((capacity << 1) - 1)] = buffer[i & (capacity - 1)];
+                }
+                delete[] buffer;
+                buffer = newBuffer;
+                capacity <<= 1;
+            }
 
         public:
             Deque() {
+                capacity = initialCapacity;
                 head = 0;
                 tail = 0;
-                localEmptyHead = blockSize - 1;
-                localEmptyTail = 0;
-                localFullHead = 0;
-                localFullTail = 0;
-                headBlockSize = blockSize;
-                tailBlockSize = blockSize;
-                size = blockSize;
-
-                headLock.clear(std::memory_order_relaxed);
-                tailLock.clear(std::memory_order_relaxed);
-
-                blockHead = new Block;
-
-                blockHead->next = blockHead;
-                blockHead->previous = blockHead;
-
-                blockTail = blockHead;
+                buffer = new T[capacity];
+                lock.clear(std::memory_order_relaxed);
             }
 
             ~Deque() {
-                blockHead->previous->next = nullptr;
-                Block *buffer;
-                while (blockHead->next != nullptr) {
-                    buffer = blockHead->next;
-                    delete blockHead;
-                    blockHead = buffer;
-                }
-                delete blockHead;
+                delete[] buffer;
             }
 
             bool enqueue(T item) {
-                while (tailLock.test_and_set(std::memory_order_acquire)) std::this_thread::yield();
-                if (tail != localEmptyHead) {
-                    blockTail->data[tail & (blockSize - 1)] = item;
-                    tail++;
-                    if ((tail & (blockSize - 1)) == 0) {
-                        blockTail = blockTail->next;
-                    }
-                    tailLock.clear(std::memory_order_release);
-                    return true;
-                } else {
-                    while (headLock.test_and_set(std::memory_order_acquire)) std::this_thread::yield();
-                    size = headBlockSize + tailBlockSize - size;
-                    headBlockSize = size;
-                    tailBlockSize = size;
-                    if (size - ((localEmptyHead + 1) - head) >= blockSize << 2) {
-                        uint64_t midEmpty =
-                                ((((size - ((localEmptyHead + 1) - head)) / blockSize) >> 1) - 1) * blockSize;
-                        localEmptyHead += midEmpty;
-                        localEmptyTail -= midEmpty;
-                        blockTail->data[tail & (blockSize - 1)] = item;
-                        ++tail;
-                        if ((tail & (blockSize - 1)) == 0) {
-                            blockTail = blockTail->next;
-                        }
-                        headLock.clear(std::memory_order_release);
-                        tailLock.clear(std::memory_order_release);
-                        return true;
-                    }
-                    headLock.clear(std::memory_order_release);
-                    blockTail->data[blockSize - 1] = item;
-                    ++tail;
-                    Block *buffer = blockTail->next;
-                    blockTail->next = new Block;
-                    blockTail->next->next = buffer;
-                    blockTail->next->next->previous = blockTail->next;
-                    blockTail->next->previous = blockTail;
-                    blockTail = blockTail->next;
-                    tailBlockSize += blockSize;
-                    localEmptyHead += blockSize;
-                    tailLock.clear(std::memory_order_release);
-                    return true;
-                }
+                acquire();
+                if (tail - head == capacity) grow();
+                buffer[tail & (capacity - 1)] = item;
+                tail++;
+                release();
+                return true;
             }
 
             bool push(T item) {
-                while (headLock.test_and_set(std::memory_order_acquire)) std::this_thread::yield();
-                if (head != localEmptyTail) {
-                    if ((head & (blockSize - 1)) == 0) {
-                        blockHead = blockHead->next;
-                    }
-                    head--;
-                    blockHead->data[head & (blockSize - 1)] = item;
-                    headLock.clear(std::memory_order_release);
-                    return true;
-                } else {
-                    headLock.clear(std::memory_order_release);
-                    while (tailLock.test_and_set(std::memory_order_acquire)) std::this_thread::yield();
-                    size = headBlockSize + tailBlockSize - size;
-                    headBlockSize = size;
-                    tailBlockSize = size;
-                    if (size - (tail - localEmptyTail) >= blockSize << 2) {
-                        uint64_t midEmpty =
-                                ((((size - (tail - (localEmptyTail))) / blockSize + 1) >> 1) - 1) * blockSize;
-                        localEmptyHead += midEmpty;
-                        localEmptyTail -= midEmpty;
-                        if ((head & (blockSize - 1)) == 0) {
-                            blockHead = blockHead->next;
-                        }
-                        head--;
-                        blockHead->data[head & (blockSize - 1)] = item;
-                        tailLock.clear(std::memory_order_release);
-                        headLock.clear(std::memory_order_release);
-                        return true;
-                    }
-                    tailLock.clear(std::memory_order_release);
-                    while (headLock.test_and_set(std::memory_order_acquire)) std::this_thread::yield();
-                    Block *buffer = blockHead->previous;
-                    blockHead->previous = new Block;
-                    blockHead->previous->previous = buffer;
-                    blockHead->previous->previous->next = blockHead->previous;
-                    blockHead->previous->next = blockHead;
-                    blockHead = blockHead->previous;
-                    headBlockSize += blockSize;
-                    localEmptyTail -= blockSize;
-                    blockHead->data[blockSize - 1] = item;
-                    head--;
-                    headLock.clear(std::memory_order_release);
-                    return true;
-                }
+                acquire();
+                if (tail - head == capacity) grow();
+                head--;
+                buffer[head & (capacity - 1)] = item;
+                release();
+                return true;
             }
 
             bool pop(T &item) {
-                while (headLock.test_and_set(std::memory_order_acquire)) std::this_thread::yield();
-                if (head != localFullTail) {
-                    item = blockHead->data[head & (blockSize - 1)];
-                    head++;
-                    if ((head & (blockSize - 1)) == 0) {
-                        blockHead = blockHead->next;
-                    }
-                    headLock.clear(std::memory_order_release);
-                    return true;
-                } else {
-                    headLock.clear(std::memory_order_release);
-                    while (tailLock.test_and_set(std::memory_order_acquire)) std::this_thread::yield();
-                    if (tail - head > 0) {
-                        item = blockHead->data[head & (blockSize - 1)];
-                        head++;
-                        if ((head & (blockSize - 1)) == 0) {
-                            blockHead = blockHead->next;
-                        }
-                        localFullTail = head + ((tail - head) >> 1);
-                        localFullHead = head + ((tail - head+1) >> 1);
-                        tailLock.clear(std::memory_order_release);
-                        return true;
-                    }else{
-                        //TODO: deallocate memory
-
-                        tailLock.clear(std::memory_order_release);
-                        return false;
-                    }
+                acquire();
+                if (tail == head) {
+                    release();
+                    return false;
                 }
+                item = buffer[head & (capacity - 1)];
+                head++;
+                release();
+                return true;
             }
 
             bool steal(T &item) {
-                while (tailLock.test_and_set(std::memory_order_acquire)) std::this_thread::yield();
-                if (tail != localFullHead) {
-                    if ((tail & (blockSize - 1)) == 0) {
-                        blockTail = blockTail->previous;
-                    }
-                    tail--;
-                    item = blockTail->data[tail & (blockSize - 1)];
-                    tailLock.clear(std::memory_order_release);
-                    return true;
-                } else {
-                    while (headLock.test_and_set(std::memory_order_acquire)) std::this_thread::yield();
-                    if (tail - head > 0) {
-                        if ((tail & (blockSize - 1)) == 0) {
-                            blockTail = blockTail->previous;
-                        }
-                        tail--;
-                        item = blockTail->data[tail & (blockSize - 1)];
-                        localFullTail = head + ((tail - head) >> 1);
-                        localFullHead = head + ((tail - head+1) >> 1);
-                        headLock.clear(std::memory_order_release);
-                        tailLock.clear(std::memory_order_release);
-                        return true;
-                    }else{
-                        //TODO: deallocate memory
-
-                        headLock.clear(std::memory_order_release);
-                        tailLock.clear(std::memory_order_release);
-                        return false;
-                    }
+                acquire();
+                if (tail == head) {
+                    release();
+                    return false;
                 }
+                tail--;
+                item = buffer[tail & (capacity - 1)];
+                release();
+                return true;
             }
 
             uint64_t getSize() {
-                return tail - head;
+                acquire();
+                uint64_t size = tail - head;
+                release();
+                return size;
             }
         };
 
         Deque **deque;
         uint16_t **randomList;
-        AlignedWrapper<uint16_t> *randPos;
+        // atomic, since threads outside of the pool share the first id and therefore its steal position
+        AlignedWrapper<std::atomic<uint16_t>> *randPos;
         uint16_t queueCount;
 
         std::atomic_flag registerLock{};
@@ -259,11 +132,9 @@ namespace Atzubi {
                 delete deque[i];
                 delete[] randomList[i];
             }
-            delete deque;
-            delete randomList;
+            delete[] deque;
+            delete[] randomList;
             delete[] randPos;
-
-            std::cout << count << std::endl;
         }
 
         int registerUser() {
@@ -275,23 +146,26 @@ namespace Atzubi {
                 deque[i] = buffer[i];
             }
             deque[queueCount] = new Deque();
-            delete buffer;
+            delete[] buffer;
 
-            delete randomList;
+            for (int i = 0; i < queueCount; i++) {
+                delete[] randomList[i];
+            }
+            delete[] randomList;
             randomList = new uint16_t *[queueCount + 1];
-            delete randPos;
-            randPos = new AlignedWrapper<uint16_t>[queueCount + 1];
+            delete[] randPos;
+            randPos = new AlignedWrapper<std::atomic<uint16_t>>[queueCount + 1];
             for (int i = 0; i < queueCount + 1; i++) {
-                randPos[i].data = 0;
+                randPos[i].data.store(0, std::memory_order_relaxed);
                 randomList[i] = new uint16_t[queueCount];
                 for (int j = 0; j < queueCount; j++) {
                     uint16_t rand;
                     bool newRand = false;
                     while (!newRand) {
-                        rand = random() % (queueCount + 1);
-                        newRand = true;
+                        rand = std::rand() % (queueCount + 1);
+                        newRand = rand != i;
                         for (int k = 0; k < j; k++) {
-                            if (randomList[i][k] == rand || rand == i) {
+                            if (randomList[i][k] == rand) {
                                 newRand = false;
                             }
                         }
@@ -320,8 +194,9 @@ namespace Atzubi {
                 return true;
             } else {
                 for (int i = 0; i < queueCount - 1; i++) {
-                    randPos[id].data = (randPos[id].data + 1) % (queueCount - 1);
-                    if (deque[randomList[id][randPos[id].data]]->steal(item)) {
+                    uint16_t position = (randPos[id].data.load(std::memory_order_relaxed) + 1) % (queueCount - 1);
+                    randPos[id].data.store(position, std::memory_order_relaxed);
+                    if (deque[randomList[id][position]]->steal(item)) {
                         return true;
                     }
                 }
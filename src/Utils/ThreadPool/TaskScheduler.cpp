@@ -0,0 +1,146 @@
+//
+// Created by Sebastian on 18.10.2026.
+//
+
+#include <algorithm>
+
+#include "Utils/ThreadPool/TaskScheduler.h"
+#include "Utils/ConcurrentQueue/taskStealingQueueV2.h"
+
+/**
+ * A queued unit of work.
+ * function:    The work to be done.
+ * taskGroup:   The group that is notified once the work is done.
+ */
+struct Task {
+    std::function<void()> function;
+    TaskGroup *taskGroup;
+};
+
+/**
+ * Identifies the scheduler a thread is working for and the deque it owns.
+ */
+struct WorkerIdentity {
+    const TaskScheduler *taskScheduler;
+    unsigned int workerId;
+};
+
+static thread_local WorkerIdentity workerIdentity = {nullptr, 0};
+
+TaskScheduler::TaskScheduler(unsigned int threadCount) {
+    if (threadCount == 0) {
+        threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+    this->threadCount = threadCount;
+
+    queuedTasks = 0;
+    sleepingWorkers = 0;
+    stop = false;
+
+    // every user of the queue has to be registered before any of them starts working on it
+    queue = new Atzubi::TaskStealingQueueV2<Task *>();
+    for (unsigned int i = 0; i < threadCount; i++) {
+        queue->registerUser();
+    }
+
+    for (unsigned int i = 1; i < threadCount; i++) {
+        workers.emplace_back(&TaskScheduler::work, this, i);
+    }
+}
+
+TaskScheduler::~TaskScheduler() {
+    {
+        std::lock_guard<std::mutex> lock(parkLock);
+        stop = true;
+    }
+    workAvailable.notify_all();
+    for (auto &worker: workers) {
+        worker.join();
+    }
+    delete queue;
+}
+
+unsigned int TaskScheduler::getThreadCount() const {
+    return threadCount;
+}
+
+unsigned int TaskScheduler::getWorkerId() const {
+    if (workerIdentity.taskScheduler == this) {
+        return workerIdentity.workerId;
+    }
+    return 0;
+}
+
+void TaskScheduler::spawn(TaskGroup *taskGroup, std::function<void()> task) {
+    taskGroup->pendingTasks.fetch_add(1, std::memory_order_relaxed);
+
+    // counted before the push, so that a worker popping the task right away cannot wrap the count around, this also
+    // pairs with the parking worker, which announces itself before checking for queued tasks
+    queuedTasks.fetch_add(1);
+    queue->push(new Task{std::move(task), taskGroup}, getWorkerId());
+    if (sleepingWorkers.load() != 0) {
+        std::lock_guard<std::mutex> lock(parkLock);
+        workAvailable.notify_one();
+    }
+}
+
+void TaskScheduler::wait(TaskGroup *taskGroup) {
+    unsigned int workerId = getWorkerId();
+    while (taskGroup->pendingTasks.load(std::memory_order_acquire) != 0) {
+        if (!runTask(workerId)) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+bool TaskScheduler::poll(TaskGroup *taskGroup) {
+    if (threadCount == 1 && taskGroup->pendingTasks.load(std::memory_order_acquire) != 0) {
+        runTask(getWorkerId());
+    }
+    return taskGroup->pendingTasks.load(std::memory_order_acquire) == 0;
+}
+
+void TaskScheduler::parallelFor(uint64_t taskCount,
+                                const std::function<void(uint64_t task, unsigned int workerId)> &function) {
+    if (threadCount == 1) {
+        for (uint64_t task = 0; task < taskCount; task++) {
+            function(task, 0);
+        }
+        return;
+    }
+
+    // tasks are spawned in reverse so that the spawning thread works through them front to back, while the other
+    // workers steal from the far end
+    TaskGroup taskGroup;
+    for (uint64_t task = taskCount; task > 0; task--) {
+        spawn(&taskGroup, [this, &function, task] {
+            function(task - 1, getWorkerId());
+        });
+    }
+    wait(&taskGroup);
+}
+
+bool TaskScheduler::runTask(unsigned int workerId) {
+    Task *task;
+    if (!queue->pop(task, workerId)) return false;
+
+    queuedTasks.fetch_sub(1, std::memory_order_relaxed);
+    task->function();
+    task->taskGroup->pendingTasks.fetch_sub(1, std::memory_order_release);
+    delete task;
+    return true;
+}
+
+void TaskScheduler::work(unsigned int workerId) {
+    workerIdentity = {this, workerId};
+
+    while (true) {
+        if (runTask(workerId)) continue;
+
+        std::unique_lock<std::mutex> lock(parkLock);
+        sleepingWorkers.fetch_add(1);
+        workAvailable.wait(lock, [&] { return stop || queuedTasks.load() != 0; });
+        sleepingWorkers.fetch_sub(1);
+        if (stop) return;
+    }
+}
@@ -0,0 +1,111 @@
+//
+// Created by Sebastian on 18.10.2026.
+//
+
+#ifndef RAYTRACEENGINE_TASKSCHEDULER_H
+#define RAYTRACEENGINE_TASKSCHEDULER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Atzubi {
+    template<class T>
+    class TaskStealingQueueV2;
+}
+
+struct Task;
+
+/**
+ * A set of tasks that can be waited on together.
+ * pendingTasks:    Number of tasks of the group that have been spawned but not finished yet.
+ */
+struct TaskGroup {
+    std::atomic_uint64_t pendingTasks{0};
+};
+
+/**
+ * Engine wide work stealing task scheduler. Every worker thread owns a deque of the task stealing queue, tasks spawned
+ * by a worker go to its own deque and idle workers steal from the others. Threads that are not workers of the scheduler
+ * share an additional external deque. Workers that find no work park on a condition variable.
+ * threadCount:     Number of threads working on tasks, including one external thread waiting on a task group.
+ * workers:         The long-lived worker threads.
+ * queue:           Work stealing queue holding the spawned tasks, deque 0 is the external deque.
+ * queuedTasks:     Number of tasks that are currently queued but not yet taken by any thread.
+ * sleepingWorkers: Number of workers that are currently parked.
+ */
+class TaskScheduler {
+private:
+    unsigned int threadCount;
+    std::vector<std::thread> workers;
+    Atzubi::TaskStealingQueueV2<Task *> *queue;
+
+    std::mutex parkLock;
+    std::condition_variable workAvailable;
+    std::atomic_uint64_t queuedTasks;
+    std::atomic_uint32_t sleepingWorkers;
+    bool stop;
+
+    void work(unsigned int workerId);
+
+    bool runTask(unsigned int workerId);
+
+public:
+    /**
+     * Starts the worker threads.
+     * @param threadCount   Number of threads working on tasks, including the thread waiting on a task group. 0 uses
+     *                      all hardware threads.
+     */
+    explicit TaskScheduler(unsigned int threadCount);
+
+    /**
+     * Stops and joins all worker threads. All task groups have to be waited on before.
+     */
+    ~TaskScheduler();
+
+    /**
+     * @return  Number of threads working on tasks, including the thread waiting on a task group.
+     */
+    [[nodiscard]] unsigned int getThreadCount() const;
+
+    /**
+     * @return  The id of the calling thread, smaller than getThreadCount(). Worker threads have unique ids, all other
+     *          threads share id 0. Can be used to index per thread scratch memory inside of tasks.
+     */
+    [[nodiscard]] unsigned int getWorkerId() const;
+
+    /**
+     * Queues a task. Tasks may spawn further tasks.
+     * @param taskGroup The group the task belongs to.
+     * @param task      The work to be done.
+     */
+    void spawn(TaskGroup *taskGroup, std::function<void()> task);
+
+    /**
+     * Waits until all tasks of a group are finished. The waiting thread executes queued tasks in the meantime, so it is
+     * safe to wait from inside of a task.
+     * @param taskGroup The group to be waited on.
+     */
+    void wait(TaskGroup *taskGroup);
+
+    /**
+     * Checks whether all tasks of a group are finished without waiting. Without worker threads queued tasks only make
+     * progress while a thread executes them, so in that case the calling thread executes one of them first.
+     * @param taskGroup The group to be checked.
+     * @return          True if all tasks of the group are finished.
+     */
+    bool poll(TaskGroup *taskGroup);
+
+    /**
+     * Executes a number of independent tasks and returns once all of them are done.
+     * @param taskCount Number of tasks, tasks are numbered from 0 to taskCount - 1.
+     * @param function  Called once per task with the task number and the id of the executing thread.
+     */
+    void parallelFor(uint64_t taskCount, const std::function<void(uint64_t task, unsigned int workerId)> &function);
+};
+
+#endif //RAYTRACEENGINE_TASKSCHEDULER_H